@@ -0,0 +1,107 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-01
+    License: MIT
+*/
+
+#pragma once
+#include <string_view>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Minimal harness, results are collected and printed as JSON at exit so they can be diffed between releases.
+namespace Benchmark
+{
+    struct Result_t { std::string Name; uint64_t Iterations; double Nanoseconds, Allocations, Items, Bytes; };
+    inline std::vector<Result_t> Results{};
+    inline std::string_view Filter{};
+
+    // Incremented by the replaced global operator new, see Benchmain.cpp.
+    inline std::atomic<uint64_t> Allocations{};
+
+    // Budget per case, the body is repeated in growing batches until it's been measured for this long.
+    constexpr auto Mintime = std::chrono::milliseconds(250);
+
+    // Items and Bytes are per operation and only used for throughput.
+    template<typename F> void Run(std::string_view Name, F &&Body, double Items = 1, double Bytes = 0)
+    {
+        if(!Filter.empty() && Name.find(Filter) == std::string_view::npos) return;
+
+        // Warm-up, this is where arenas and caches get populated.
+        Body();
+
+        uint64_t Iterations{}, Batch{ 1 };
+        std::chrono::nanoseconds Elapsed{};
+        const auto Initialallocations = Allocations.load(std::memory_order_relaxed);
+
+        while(Elapsed < Mintime)
+        {
+            const auto Start = std::chrono::steady_clock::now();
+            for(uint64_t i = 0; i < Batch; ++i) Body();
+            Elapsed += std::chrono::steady_clock::now() - Start;
+
+            Iterations += Batch;
+            Batch *= 2;
+        }
+
+        const auto Nanoseconds = double(Elapsed.count()) / Iterations;
+        const auto Allocated = double(Allocations.load(std::memory_order_relaxed) - Initialallocations) / Iterations;
+        Results.push_back({ std::string(Name), Iterations, Nanoseconds, Allocated, Items, Bytes });
+
+        std::fprintf(stderr, "%-48.*s %14.1f ns/op %10.1f allocs/op\n", int(Name.size()), Name.data(), Nanoseconds, Allocated);
+    }
+
+    // Setup is untimed and runs even when the case is filtered out, so later cases can build on the state it leaves.
+    template<typename S, typename F> requires std::is_invocable_v<F &>
+    void Run(std::string_view Name, S &&Setup, F &&Body, double Items = 1, double Bytes = 0)
+    {
+        Setup();
+        Run(Name, std::forward<F>(Body), Items, Bytes);
+    }
+
+    // Machine-readable output, throughput is derived from the per-op time.
+    inline void Print(std::FILE *Stream)
+    {
+        std::fprintf(Stream, "{\n    \"context\": { \"module\": \"%s\", \"pointer_size\": %zu, \"debug\": %s },\n    \"benchmarks\": [\n",
+                     MODULENAME, sizeof(void *),
+                     #if defined(NDEBUG)
+                     "false"
+                     #else
+                     "true"
+                     #endif
+                     );
+
+        for(size_t i = 0; i < Results.size(); ++i)
+        {
+            const auto &Result = Results[i];
+            const auto Persecond = 1e9 / Result.Nanoseconds;
+
+            std::fprintf(Stream, "        { \"name\": \"%s\", \"iterations\": %" PRIu64 ", \"ns_per_op\": %.2f, \"allocs_per_op\": %.2f, "
+                                 "\"items_per_second\": %.2f, \"bytes_per_second\": %.2f }%s\n",
+                         Result.Name.c_str(), Result.Iterations, Result.Nanoseconds, Result.Allocations,
+                         Result.Items * Persecond, Result.Bytes * Persecond, i + 1 < Results.size() ? "," : "");
+        }
+
+        std::fprintf(Stream, "    ]\n}\n");
+    }
+
+    // Keep the optimizer from removing the measured work.
+    template<typename T> inline void Consume(const T &Value)
+    {
+        #if defined(_MSC_VER)
+        static volatile const void *Sink; Sink = &Value;
+        #else
+        asm volatile("" : : "r,m"(Value) : "memory");
+        #endif
+    }
+}
+
+// Groups of benchmarks, defined per file.
+void Corebenchmarks();
+void Utilitybenchmarks();
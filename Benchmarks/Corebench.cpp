@@ -0,0 +1,605 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-01
+    License: MIT
+*/
+
+#include "Benchmark.hpp"
+#include "../Tests/Fixtures.hpp"
+#include <Stdinclude.hpp>
+#include <Core/Traversal.hpp>
+#include <Core/Animation.hpp>
+#include <Core/Timers.hpp>
+#include <Core/Blueprint.hpp>
+#include <Core/Lists.hpp>
+#include <Utilities/Variadicstring.hpp>
+#include <Utilities/Simplehook.hpp>
+#include <Utilities/Profiler.hpp>
+#include <filesystem>
+#include <barrier>
+#include <cstdlib>
+#include <random>
+
+#if defined(HAS_PUGIXML)
+#include <pugixml.hpp>
+#endif
+
+// Blueprint.cpp, so the readers can be run without layout or the asset-cache.
+void Releaseclasses(Array<Class_t, Maxclasses> *Properties);
+Class_t *Addclass(Array<Class_t, Maxclasses> *Properties);
+
+// Stand-in for a recorded session, sweeps across the window with periodic clicks.
+static std::vector<Mouseinput_t> Mousetrace(uint32_t Eventcount, point2_t Windowsize)
+{
+    std::vector<Mouseinput_t> Trace(Eventcount);
+    std::mt19937 Generator(1337);
+
+    for(uint32_t i = 0; i < Eventcount; ++i)
+    {
+        const auto Progress = float(i) / Eventcount;
+        Trace[i].Position.x = int16_t(std::fmod(Progress * 3.0f, 1.0f) * Windowsize.x + Generator() % 8);
+        Trace[i].Position.y = int16_t(std::fmod(Progress * 7.0f, 1.0f) * Windowsize.y + Generator() % 8);
+        Trace[i].Pressed.isLeftclicked = i % 50 == 0;
+        Trace[i].Released.isLeftclicked = i % 50 == 5;
+    }
+
+    return Trace;
+}
+
+// The original recursive walk, kept as the baseline for the traversal kernels.
+static void Recursivewalk(Array<Element_t, Maxnodes> &Nodes, uint32_t &Visited)
+{
+    std::function<void(Nodeid_t)> Lambda = [&](Nodeid_t Piviot)
+    {
+        const auto &This = Nodes[Piviot];
+        ++Visited;
+
+        if(This.Child_1) Lambda(This.Child_1);
+        if(This.Child_2) Lambda(This.Child_2);
+        if(This.Child_3) Lambda(This.Child_3);
+        if(This.Child_4) Lambda(This.Child_4);
+    };
+    Lambda(0);
+}
+
+#if defined(HAS_PUGIXML)
+// The DOM-walk the streaming reader replaced, kept as its baseline.
+static bool Readmarkup_pugixml(std::string_view Filepath, Array<Element_t, Maxnodes> *Nodes, Array<Class_t, Maxclasses> *Properties,
+                               std::pmr::vector<Blueprint::Callbacknames_t> *Callbackhashes)
+{
+    pugi::set_memory_management_functions([](size_t Size) { return Activecontext->Framearena.allocate(Size, alignof(std::max_align_t)); }, [](void *) {});
+
+    pugi::xml_document Document;
+    if(!Document.load_file(std::string(Filepath).c_str())) return false;
+
+    Hashmap::pmr::Flat<uint8_t> Classindex{ &Activecontext->Framearena };
+    for(const auto &Class : Document.children("Class"))
+    {
+        const auto Index = uint8_t(Properties->Size);
+        const auto pClass = Addclass(Properties);
+        Classindex[Hash::FNV1a_32(Class.attribute("Name").as_string())] = Index;
+
+        const auto Size = Class.child("Size");
+        pClass->insert_or_assign(Hash::FNV1a_32("Size"), vec2_t{ Size.attribute("Width").as_float() / 100, Size.attribute("Height").as_float() / 100 });
+
+        const auto Offset = Class.child("Offset");
+        pClass->insert_or_assign(Hash::FNV1a_32("Offset"), vec2_t{ Offset.attribute("Left").as_float() / 100, Offset.attribute("Top").as_float() / 100 });
+
+        const auto Background = Class.child("Background");
+        pClass->insert_or_assign(Hash::FNV1a_32("Background"), Attributes::Background{
+                                     Byteswap(Background.attribute("Colour").as_uint()), Byteswap(Background.attribute("Border").as_uint()),
+                                     Background.attribute("Radius").as_float(), Background.attribute("Borderwidth").as_float(1.0f),
+                                     Activecontext->Parsearena.Copy(Background.attribute("Image").as_string()) });
+
+        const auto Text = Class.child("Text");
+        pClass->insert_or_assign(Hash::FNV1a_32("Text"), Attributes::Text{
+                                     Activecontext->Parsearena.Copy(Text.child_value()), Activecontext->Parsearena.Copy(Text.attribute("Font").as_string()),
+                                     Text.attribute("Size").as_float(), Byteswap(Text.attribute("Colour").as_uint(0x000000FF)) });
+    }
+
+    const auto Addnode = [&](const pugi::xml_node &Node) -> Nodeid_t
+    {
+        auto [Index, Entry] = Nodes->add();
+        Entry->StyleID = Classindex[Hash::FNV1a_32(Node.attribute("Class").as_string())];
+        Callbackhashes->push_back({ Hash::FNV1a_32(Node.child_value("onFrame")), Hash::FNV1a_32(Node.child_value("onState")) });
+        return Index;
+    };
+
+    struct Frame_t { pugi::xml_node Next; Nodeid_t Index; };
+    Traversal::Stack<Frame_t> Pending(uint32_t(Nodes->Data.size()));
+    for(const auto &Root : Document.children("Node"))
+    {
+        Pending.push({ Root.child("Node"), Addnode(Root) });
+        while(!Pending.empty())
+        {
+            auto &Top = Pending.top();
+            if(!Top.Next) { Pending.pop(); continue; }
+
+            const auto Child = Top.Next;
+            Top.Next = Child.next_sibling("Node");
+
+            const auto Index = Addnode(Child);
+            const auto Entry = &(*Nodes)[Top.Index];
+            if(!Entry->Child_1) Entry->Child_1 = Index;
+            else if(!Entry->Child_2) Entry->Child_2 = Index;
+            else if(!Entry->Child_3) Entry->Child_3 = Index;
+            else if(!Entry->Child_4) Entry->Child_4 = Index;
+
+            Pending.push({ Child.child("Node"), Index });
+        }
+    }
+
+    return true;
+}
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+// Detour targets for the hot-path benches, the original is only ever called through a pointer so it stays out-of-line.
+static Simplehook::Trampolinehook Trampolined;
+static Simplehook::Stomphook Stomped;
+static uint32_t Hookable(uint32_t Value) { return (Value ^ (Value >> 15)) * 2654435761U; }
+static uint32_t Trampolinedetour(uint32_t Value) { return Trampolined.Callorigin<uint32_t (*)(uint32_t)>()(Value) + 1; }
+static uint32_t Stompdetour(uint32_t Value)
+{
+    // Without a trampoline the original is only reachable by taking the hook out.
+    Stomped.Removehook();
+    const auto Result = Hookable(Value) + 1;
+    Stomped.Installhook();
+    return Result;
+}
+#endif
+
+void Corebenchmarks()
+{
+    constexpr point2_t Windowsize{ 1280, 720 };
+    constexpr vec4_t Boundingbox{ 0.0f, 0.0f, float(Windowsize.x), float(Windowsize.y) };
+
+    const auto Context = std::make_unique<Context_t>();
+    const Context_t::Bind_t Bound(*Context);
+    auto &Classes = Context->Classes;
+    auto &Nodes = Context->Nodetree;
+    auto &Callbacks = Context->Callbacks;
+
+    const auto Pixels = std::make_unique<uint32_t[]>(Windowsize.x * Windowsize.y);
+    Surface_t Surface{ Pixels.get(), Windowsize.x, Windowsize.y };
+    const auto Trace = Mousetrace(1000, Windowsize);
+
+    uint32_t Statechanges{};
+    Context->Namedcallbacks[Hash::FNV1a_32("Bench::onState")] = [&](Element_t &, const void *) -> bool
+    {
+        ++Statechanges;
+        return false;
+    };
+
+    const auto Directory = std::filesystem::temp_directory_path() / "Appcore_bench";
+    std::filesystem::create_directories(Directory);
+
+    for(const uint32_t Nodecount : { 100U, 1000U, 10000U, 100000U })
+    {
+        const auto Filepath = (Directory / va("Synthetic_%u.xml", Nodecount)).string();
+        FS::Writefile(Filepath, Fixtures::Syntheticblueprint(Nodecount, "Bench"));
+
+        // Always re-parse, then let the asset-cache serve it.
+        Benchmark::Run(va("Parseblueprint/uncached/%u", Nodecount), [&]() { Assetcache::isEnabled = false; }, [&]()
+        {
+            Context->Framearena.Reset();
+            if(!Parseblueprint(Boundingbox, Filepath, &Nodes, &Classes, &Callbacks)) std::abort();
+        }, Nodecount);
+        Benchmark::Run(va("Parseblueprint/cached/%u", Nodecount), [&]() { Assetcache::isEnabled = true; }, [&]()
+        {
+            Context->Framearena.Reset();
+            if(!Parseblueprint(Boundingbox, Filepath, &Nodes, &Classes, &Callbacks)) std::abort();
+        }, Nodecount);
+
+        // Just the markup into the arrays, the 100k blueprint is a few MB.
+        if(Nodecount == 100000)
+        {
+            const auto Filesize = double(std::filesystem::file_size(Filepath));
+            const auto Readmarkup = [&](auto &&Reader)
+            {
+                Releaseclasses(&Classes);
+                Context->Parsearena.Reset();
+                Context->Framearena.Reset();
+                Nodes.Size = 0;
+
+                std::pmr::vector<Blueprint::Callbacknames_t> Callbackhashes{ &Context->Framearena };
+                if(!Reader(Filepath, &Nodes, &Classes, &Callbackhashes)) std::abort();
+                Benchmark::Consume(Callbackhashes.size());
+            };
+
+            Benchmark::Run(va("Readmarkup/streaming/%u", Nodecount), [&]()
+            {
+                Readmarkup([](auto... Args) { return Blueprint::Readmarkup(Args...); });
+            }, Nodecount, Filesize);
+            #if defined(HAS_PUGIXML)
+            Benchmark::Run(va("Readmarkup/pugixml/%u", Nodecount), [&]() { Readmarkup(Readmarkup_pugixml); }, Nodecount, Filesize);
+            #endif
+        }
+
+        // The benchmarks below work on this tree laid out in the box, whichever of the above ran.
+        const auto Parsetree = [&]()
+        {
+            Context->Framearena.Reset();
+            if(!Parseblueprint(Boundingbox, Filepath, &Nodes, &Classes, &Callbacks)) std::abort();
+        };
+        Benchmark::Run(va("Layoutnodes/%u", Nodecount), Parsetree, [&]()
+        {
+            Context->Framearena.Reset();
+            Layoutnodes(Boundingbox, &Nodes, &Classes);
+        }, Nodecount);
+        Benchmark::Run(va("Relayoutnodes/%u", Nodecount), [&]()
+        {
+            Relayoutnodes(Boundingbox, &Nodes, &Classes);
+        }, Nodecount);
+
+        // Per-node cost is ns_per_op divided by the node-count.
+        Benchmark::Run(va("Traversal/recursive_function/%u", Nodecount), [&]()
+        {
+            uint32_t Visited{};
+            Recursivewalk(Nodes, Visited);
+            Benchmark::Consume(Visited);
+        }, Nodecount);
+        Benchmark::Run(va("Traversal/preorder/%u", Nodecount), [&]()
+        {
+            uint32_t Visited{};
+            Context->Framearena.Reset();
+            for(const auto Visit : Traversal::Preorder(Nodes)) Visited += Visit.Index;
+            Benchmark::Consume(Visited);
+        }, Nodecount);
+        Benchmark::Run(va("Traversal/postorder/%u", Nodecount), [&]()
+        {
+            uint32_t Visited{};
+            Context->Framearena.Reset();
+            for(const auto Visit : Traversal::Postorder(Nodes)) Visited += Visit.Index;
+            Benchmark::Consume(Visited);
+        }, Nodecount);
+        Benchmark::Run(va("Traversal/levelorder/%u", Nodecount), [&]()
+        {
+            uint32_t Visited{};
+            Context->Framearena.Reset();
+            for(const auto Visit : Traversal::Levelorder(Nodes)) Visited += Visit.Index;
+            Benchmark::Consume(Visited);
+        }, Nodecount);
+
+        // One op is the whole trace.
+        Benchmark::Run(va("Processinput/trace/%u", Nodecount), [&]()
+        {
+            for(const auto &Input : Trace)
+            {
+                Context->Framearena.Reset();
+                Processinput(Input, Nodes, Callbacks);
+            }
+            Benchmark::Consume(Statechanges);
+        }, double(Trace.size()));
+
+        Benchmark::Run(va("Rendernodes/%u", Nodecount), [&]()
+        {
+            Context->Framearena.Reset();
+            Rendernodes(Surface, Nodes, Classes);
+            Benchmark::Consume(Surface.Pixels[0]);
+        }, 1, double(Surface.Width * Surface.Height * sizeof(uint32_t)));
+
+        // Closer to a real window, only the root's children are interactive so the rest is served from layers.
+        std::vector<uint8_t> Savedstate(Nodes.Size);
+        for(uint32_t i = 0; i < Nodes.Size; ++i)
+        {
+            Savedstate[i] = Nodes[i].onState;
+            if(i > 4) Nodes[i].onState = 0;
+        }
+        Benchmark::Run(va("Rendernodes/static_subtrees/%u", Nodecount), [&]()
+        {
+            Context->Framearena.Reset();
+            Rendernodes(Surface, Nodes, Classes);
+            Benchmark::Consume(Surface.Pixels[0]);
+        }, 1, double(Surface.Width * Surface.Height * sizeof(uint32_t)));
+        for(uint32_t i = 0; i < Nodes.Size; ++i) Nodes[i].onState = Savedstate[i];
+
+        // One op is a frame of an interactive resize, the window shrinks a few pixels each time so no layer can be reused.
+        uint32_t Dragstep{};
+        Benchmark::Run(va("Resize/drag/%u", Nodecount), [&]()
+        {
+            const auto Step = int32_t(Dragstep++ % 64) * 4;
+            Surface_t Resized{ Pixels.get(), Windowsize.x - Step, Windowsize.y - Step };
+
+            Context->Framearena.Reset();
+            Relayoutnodes({ 0.0f, 0.0f, float(Resized.Width), float(Resized.Height) }, &Nodes, &Classes);
+            Rendernodes(Resized, Nodes, Classes);
+            Benchmark::Consume(Resized.Pixels[0]);
+        });
+        Relayoutnodes(Boundingbox, &Nodes, &Classes);
+
+        // Every node labelled, after the warm-up it's all cached layouts and blitting from the atlas.
+        // There's no font in the tree, so this only runs when one is provided through BENCH_FONT.
+        if(const auto Font = std::getenv("BENCH_FONT"))
+        {
+            const auto Labelpath = (Directory / va("Synthetic_%u_labels.xml", Nodecount)).string();
+            FS::Writefile(Labelpath, Fixtures::Syntheticblueprint(Nodecount, "Bench", Font));
+
+            Context->Framearena.Reset();
+            if(!Parseblueprint(Boundingbox, Labelpath, &Nodes, &Classes, &Callbacks)) std::abort();
+            Benchmark::Run(va("Rendernodes/labels/%u", Nodecount), [&]()
+            {
+                Context->Framearena.Reset();
+                Rendernodes(Surface, Nodes, Classes);
+                Benchmark::Consume(Surface.Pixels[0]);
+            }, Nodecount, double(Surface.Width * Surface.Height * sizeof(uint32_t)));
+        }
+    }
+
+    // Independent UIs, e.g. server-side thumbnails; one frame per context, each on its own worker.
+    const auto Contextpath = (Directory / "Synthetic_1000.xml").string();
+    for(const uint32_t Contextcount : { 1U, std::max(2U, std::thread::hardware_concurrency()) })
+    {
+        std::vector<std::unique_ptr<Context_t>> Contexts(Contextcount);
+        for(auto &Instance : Contexts)
+        {
+            Instance = std::make_unique<Context_t>();
+            const Context_t::Bind_t Instancebound(*Instance);
+            Instance->Resizesurface(Windowsize);
+            if(!Parseblueprint(Boundingbox, Contextpath, &Instance->Nodetree, &Instance->Classes, &Instance->Callbacks)) std::abort();
+        }
+
+        std::barrier Start(Contextcount + 1), Done(Contextcount + 1);
+        std::atomic<bool> isRunning{ true };
+        std::vector<std::thread> Workers{};
+        for(auto &Instance : Contexts)
+        {
+            Workers.emplace_back([&, Instance = Instance.get()]()
+            {
+                const Context_t::Bind_t Instancebound(*Instance);
+                while(true)
+                {
+                    Start.arrive_and_wait();
+                    if(!isRunning) break;
+
+                    Instance->Framearena.Reset();
+                    Rendernodes(Instance->Surface, Instance->Nodetree, Instance->Classes);
+                    Done.arrive_and_wait();
+                }
+            });
+        }
+
+        Benchmark::Run(va("Context/render/%u", Contextcount), [&]()
+        {
+            Start.arrive_and_wait();
+            Done.arrive_and_wait();
+        }, Contextcount);
+
+        isRunning = false;
+        Start.arrive_and_wait();
+        for(auto &Worker : Workers) Worker.join();
+    }
+
+    // The pool only depends on how many items fit, so a thousand and a million items are the same tree.
+    uint32_t Binds{};
+    Context->Namedcallbacks[Hash::FNV1a_32("Bench::onBind")] = [&](Element_t &, const void *) -> bool { ++Binds; return false; };
+    for(const uint32_t Itemcount : { 1000U, 1000000U })
+    {
+        const auto Listpath = (Directory / va("Synthetic_list_%u.xml", Itemcount)).string();
+        FS::Writefile(Listpath, Fixtures::Listblueprint(Itemcount, "Bench"));
+
+        Context->Framearena.Reset();
+        if(!Parseblueprint(Boundingbox, Listpath, &Nodes, &Classes, &Callbacks) || Lists::Containers().size() != 1) std::abort();
+        const auto List = Lists::Containers()[0];
+
+        // One op is a frame of smooth scrolling, most slots keep their item.
+        float Step = 0.37f;
+        Benchmark::Run(va("Lists/scroll/%u", Itemcount), [&]()
+        {
+            if(!Lists::Scroll(Nodes, List, Step)) Lists::Scroll(Nodes, List, Step = -Step);
+            Context->Framearena.Reset();
+            Rendernodes(Surface, Nodes, Classes);
+            Benchmark::Consume(Surface.Pixels[0]);
+        });
+
+        // Jumping, e.g. dragging a scrollbar; every slot is re-bound.
+        std::mt19937 Generator(1337);
+        Benchmark::Run(va("Lists/jump/%u", Itemcount), [&]()
+        {
+            Lists::Scroll(Nodes, List, float(Generator() % Itemcount), false);
+            Context->Framearena.Reset();
+            Rendernodes(Surface, Nodes, Classes);
+            Benchmark::Consume(Binds);
+        });
+    }
+
+    // Correctness is covered by Appcore_tests, these are just the conversions.
+    std::vector<vec4_t> Areas(1024);
+    std::vector<point4_t> Packed(Areas.size());
+    {
+        std::mt19937 Generator(1337);
+        std::uniform_real_distribution<float> Coordinate(-8000.0f, 8000.0f);
+        for(auto &Area : Areas) for(auto &Value : Area.Raw) Value = Coordinate(Generator);
+    }
+    Benchmark::Run("Geometry/pack/1024", [&]()
+    {
+        for(size_t i = 0; i < Areas.size(); ++i) Packed[i] = Fixedpoint::Pack(Areas[i]);
+        Benchmark::Consume(Packed[0].x0);
+    }, double(Areas.size()));
+    Benchmark::Run("Geometry/unpack/1024", [&]()
+    {
+        float Sum{};
+        for(const auto &Value : Packed) Sum += Fixedpoint::Unpack(Value).x1;
+        Benchmark::Consume(Sum);
+    }, double(Packed.size()));
+
+    // 1k concurrent area-tweens across the curves on nodes in the store, long enough that none finish while measuring.
+    constexpr uint32_t Tweencount = 1000;
+    constexpr vec4_t Tweentarget{ 0.0f, 0.0f, 100.0f, 100.0f };
+    const auto Animatednodes = [&]()
+    {
+        Animation::Clear();
+        Nodes.Size = 0;
+        for(uint32_t i = 0; i < Tweencount; ++i) Nodes.add();
+    };
+    Benchmark::Run("Animation/tweens/1000", [&]()
+    {
+        Animatednodes();
+        for(uint32_t i = 0; i < Tweencount; ++i) Animation::Tweenarea(Nodes[i], Tweentarget, 1e6f, Animation::Easing_t(i % Animation::Easingcount));
+    }, [&]()
+    {
+        Animation::Advance(1.0f / 60, Classes);
+        Benchmark::Consume(vec4_t(Nodes[0].Area).x1);
+    }, Tweencount);
+    Animation::Clear();
+
+    // The same tweens as hand-written onFrame callbacks, called per node like the main-loop used to.
+    struct Handtween_t { vec4_t From, Delta; float Elapsed, Rate; Animation::Easing_t Easing; };
+    std::vector<Handtween_t> Handtweens(Tweencount);
+    const Callback_t Tween = [&](Element_t &This, const void *Argument) -> bool
+    {
+        auto &State = Handtweens[&This - Nodes.Data.data()];
+        State.Elapsed += *(const float *)Argument;
+
+        const auto t = std::min(State.Elapsed * State.Rate, 1.0f);
+        float Eased = t;
+        if(State.Easing == Animation::Easein) Eased = t * t * t;
+        if(State.Easing == Animation::Easeout) Eased = 1.0f - (1.0f - t) * (1.0f - t) * (1.0f - t);
+        if(State.Easing == Animation::Easeinout) Eased = t * t * (3.0f - 2.0f * t);
+
+        vec4_t Area;
+        for(int i = 0; i < 4; ++i) Area.Raw[i] = State.From.Raw[i] + State.Delta.Raw[i] * Eased;
+        This.Area = Area;
+        return false;
+    };
+    Benchmark::Run("Animation/onframe_callbacks/1000", [&]()
+    {
+        Animatednodes();
+        for(uint32_t i = 0; i < Tweencount; ++i)
+            Handtweens[i] = { {}, Tweentarget, 0.0f, 1e-6f, Animation::Easing_t(i % Animation::Easingcount) };
+    }, [&]()
+    {
+        const auto Deltatime = 1.0f / 60;
+        for(uint32_t i = 0; i < Tweencount; ++i) Tween(Nodes[i], &Deltatime);
+        Benchmark::Consume(vec4_t(Nodes[0].Area).x1);
+    }, Tweencount);
+
+    // Tooltip-style churn, most timers are cancelled before they fire.
+    uint32_t Timerfired{};
+    Context->Namedcallbacks[Hash::FNV1a_32("Bench::Timer")] = [&](Element_t &, const void *) -> bool { return ++Timerfired; };
+    std::vector<Element_t> Elements(1000);
+    std::vector<Timers::Timerid_t> Timerids(Elements.size());
+    std::mt19937 Generator(1337);
+    Timers::Clear();
+    Benchmark::Run("Timers/schedule_cancel/1000", [&]()
+    {
+        for(uint32_t i = 0; i < Elements.size(); ++i)
+            Timerids[i] = Timers::Schedule(Hash::FNV1a_32("Bench::Timer"), Elements[i], 10 + Generator() % 60000);
+        for(const auto Timer : Timerids) Timers::Cancel(Timer);
+    }, double(Elements.size()));
+
+    // Carets and refreshes, 1k repeating timers between 50ms and 5s at 60 frames per second.
+    for(uint32_t i = 0; i < Elements.size(); ++i)
+        Timers::Schedule(Hash::FNV1a_32("Bench::Timer"), Elements[i], 50 + Generator() % 4950, 50 + Generator() % 4950);
+    auto Virtualtime = Timers::Clock();
+    Benchmark::Run("Timers/advance/1000", [&]()
+    {
+        Virtualtime += 16;
+        Benchmark::Consume(Timers::Advance(Virtualtime));
+    }, double(Elements.size()));
+    Timers::Clear();
+    Context->Namedcallbacks.erase(Hash::FNV1a_32("Bench::Timer"));
+
+    // Pre-hashed keys like the blueprint's names, half the lookups miss.
+    std::vector<uint32_t> Keys(4096);
+    for(uint32_t i = 0; i < Keys.size(); ++i) Keys[i] = Hash::FNV1a_32(va("Class_%u", i));
+    std::shuffle(Keys.begin(), Keys.end(), Generator);
+    const auto Lookups = [&](auto &Map)
+    {
+        uint32_t Found{};
+        for(uint32_t i = 0; i < Keys.size(); ++i)
+            Found += Map.find(i & 1 ? Keys[i] : Keys[i] ^ 0x5A5A5A5A) != Map.end();
+        return Found;
+    };
+
+    Benchmark::Run("Hashmap/flat/insert/4096", [&]()
+    {
+        Hashmap::Flat<uint32_t> Map;
+        for(const auto Key : Keys) Map[Key] = Key;
+        Benchmark::Consume(Map.size());
+    }, double(Keys.size()));
+    Benchmark::Run("Hashmap/unordered_map/insert/4096", [&]()
+    {
+        std::unordered_map<uint32_t, uint32_t> Map;
+        for(const auto Key : Keys) Map[Key] = Key;
+        Benchmark::Consume(Map.size());
+    }, double(Keys.size()));
+
+    Hashmap::Flat<uint32_t> Flatmap;
+    std::unordered_map<uint32_t, uint32_t> Nodemap;
+    for(const auto Key : Keys) { Flatmap[Key] = Key; Nodemap[Key] = Key; }
+    Benchmark::Run("Hashmap/flat/find/4096", [&]() { Benchmark::Consume(Lookups(Flatmap)); }, double(Keys.size()));
+    Benchmark::Run("Hashmap/unordered_map/find/4096", [&]() { Benchmark::Consume(Lookups(Nodemap)); }, double(Keys.size()));
+
+    // Hook-style patching, a few bytes in each of 1k pages; the batch coalesces them into one call each way.
+    const auto Pagesize = Memprotect::Pagesize();
+    std::vector<uint8_t> Pagebuffer((1024 + 1) * Pagesize);
+    const auto Pages = (uint8_t *)((std::uintptr_t(Pagebuffer.data()) + Pagesize - 1) & ~(Pagesize - 1));
+    Benchmark::Run("Memprotect/unprotectrange/1024", [&]()
+    {
+        for(uint32_t i = 0; i < 1024; ++i)
+        {
+            const auto Protection = Memprotect::Unprotectrange(Pages + i * Pagesize, 14);
+            Memprotect::Protectrange(Pages + i * Pagesize, 14, Protection);
+        }
+    }, 1024);
+    Benchmark::Run("Memprotect/batch/1024", [&]()
+    {
+        Memprotect::Batch_t Batch;
+        for(uint32_t i = 0; i < 1024; ++i) Batch.Add(Pages + i * Pagesize, 14);
+        if(!Batch.Unprotect()) std::abort();
+        Batch.Protect();
+    }, 1024);
+
+    // Heavy instrumentation, 1k stubs installed and removed; the pages are data so nothing ever jumps through them.
+    std::vector<Simplehook::Stomphook> Hooks(1024);
+    Benchmark::Run("Simplehook/installhook/1024", [&]()
+    {
+        for(uint32_t i = 0; i < 1024; ++i) Hooks[i].Installhook(Pages + i * Pagesize, (void *)&Corebenchmarks);
+        for(auto &Hook : Hooks) Hook.Removehook();
+    }, 1024);
+    Benchmark::Run("Simplehook/transaction/1024", [&]()
+    {
+        Simplehook::Transaction_t Transaction;
+        for(uint32_t i = 0; i < 1024; ++i) Transaction.Installhook(Hooks[i], Pages + i * Pagesize, (void *)&Corebenchmarks);
+        if(!Transaction.Commit()) std::abort();
+
+        for(auto &Hook : Hooks) Transaction.Removehook(Hook);
+        if(!Transaction.Commit()) std::abort();
+    }, 1024);
+
+    #if defined(_M_X64) || defined(__x86_64__)
+    // Calling the original from inside a detour, per call.
+    uint32_t (*volatile Hookedfunction)(uint32_t) = &Hookable;
+    const auto Callhooked = [&]()
+    {
+        uint32_t Sum{};
+        for(uint32_t i = 0; i < 1024; ++i) Sum += Hookedfunction(i);
+        Benchmark::Consume(Sum);
+    };
+    Benchmark::Run("Simplehook/call/direct/1024", Callhooked, 1024);
+
+    if(!Trampolined.Installhook((void *)&Hookable, (void *)&Trampolinedetour)) std::abort();
+    Benchmark::Run("Simplehook/call/trampoline/1024", Callhooked, 1024);
+    Trampolined.Removehook();
+
+    Stomped.Installhook((void *)&Hookable, (void *)&Stompdetour);
+    Benchmark::Run("Simplehook/call/rehook/1024", Callhooked, 1024);
+    Stomped.Removehook();
+
+    // Entry and exit recorded per call, the log is rewound so it never reaches its cap.
+    if(!Profiler::Addfunction((void *)&Hookable, "Hookable")) std::abort();
+    Benchmark::Run("Profiler/call/1024", [&]() { Callhooked(); Profiler::Clear(); }, 1024);
+    Profiler::Removeall();
+    Profiler::Clear();
+    #endif
+
+    #if !defined(_WIN32)
+    // What every Unprotectrange used to pay.
+    Benchmark::Run("Memprotect/refresh", [&]()
+    {
+        std::scoped_lock Guard(Memprotect::Regions::Lock);
+        Memprotect::Regions::Refresh();
+    });
+    #endif
+}
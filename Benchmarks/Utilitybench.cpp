@@ -0,0 +1,35 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-01
+    License: MIT
+*/
+
+#include "Benchmark.hpp"
+#include <Utilities/FNV1Hash.hpp>
+#include <Utilities/Base64.hpp>
+#include <Utilities/Logging.hpp>
+
+void Utilitybenchmarks()
+{
+    // Deterministic input, the content doesn't matter for any of these.
+    std::string Input(4096, '\0');
+    for(size_t i = 0; i < Input.size(); ++i) Input[i] = char('a' + ((i * 2654435761u) >> 24) % 26);
+    const std::string_view Small(Input.data(), 64), Large(Input);
+
+    Benchmark::Run("FNV1a_32/64B", [&]() { Benchmark::Consume(Hash::FNV1a_32(Small)); }, 1, double(Small.size()));
+    Benchmark::Run("FNV1a_32/4KB", [&]() { Benchmark::Consume(Hash::FNV1a_32(Large)); }, 1, double(Large.size()));
+    Benchmark::Run("FNV1a_64/64B", [&]() { Benchmark::Consume(Hash::FNV1a_64(Small)); }, 1, double(Small.size()));
+    Benchmark::Run("FNV1a_64/4KB", [&]() { Benchmark::Consume(Hash::FNV1a_64(Large)); }, 1, double(Large.size()));
+
+    const auto Encoded = Base64::Encode(Large);
+    Benchmark::Run("Base64::Encode/4KB", [&]() { Benchmark::Consume(Base64::Encode(Large)); }, 1, double(Large.size()));
+    Benchmark::Run("Base64::Decode/4KB", [&]() { Benchmark::Consume(Base64::Decode(Encoded)); }, 1, double(Encoded.size()));
+
+    Benchmark::Run("va/short", [&]() { Benchmark::Consume(va("%s: %d", "Frame", 42)); });
+    Benchmark::Run("va/long", [&]() { Benchmark::Consume(va("%s %s", Large.data(), "overflows the default buffer")); });
+
+    // Just the formatting, the lines are discarded so the file-system isn't measured.
+    Logging::Sink = [](std::basic_string_view<char>) {};
+    Benchmark::Run("Logging::Print", [&]() { Logging::Print('I', "Benchmark message, nothing to see here."); });
+    Logging::Sink = Logging::toDefault;
+}
@@ -5,319 +5,147 @@
 */
 
 #include <Stdinclude.hpp>
-
-namespace Global
-{
-    bool shouldReload{ false };
-    bool isDirty{ true };
-    uint32_t Errorno;
-
-    // TODO(tcn): Move this somewhere.
-    std::unordered_map<uint32_t, Callback_t> Callbacks;
-}
-
-namespace Attributes
-{
-    struct Background { uint32_t Colour, Border; std::string Image; };
-}
-
-// Create a centred window chroma-keyed on 0xFFFFFF.
-void *Createwindow(point2_t Windowsize, RECT Desktop)
-{
-    // Register the window.
-    WNDCLASSEXA Windowclass{};
-    Windowclass.lpfnWndProc = DefWindowProc;
-    Windowclass.cbSize = sizeof(WNDCLASSEXA);
-    Windowclass.lpszClassName = "Desktop_cpp";
-    Windowclass.hInstance = GetModuleHandleA(NULL);
-    Windowclass.hCursor = LoadCursor(NULL, IDC_ARROW);
-    Windowclass.style = CS_HREDRAW | CS_VREDRAW | CS_OWNDC;
-    if(NULL == RegisterClassExA(&Windowclass)) return nullptr;
-
-    // Pre-calculate the window-offsets.
-    const auto Desktopwidth = Desktop.right - Desktop.left;
-    const auto Desktopheight = Desktop.bottom - Desktop.top;
-    const auto Desktopcenterx = Desktop.left + Desktopwidth * 0.5f;
-    const auto Desktopcentery = Desktop.top + Desktopheight * 0.5f;
-
-    // HACK(tcn): We create the window with a size of 0 to prevent rendering of the first frame (black).
-    auto Windowhandle = CreateWindowExA(WS_EX_LAYERED | WS_EX_APPWINDOW | WS_EX_TOPMOST, "Desktop_cpp", NULL, WS_POPUP, 0, 0, 0, 0, NULL, NULL, Windowclass.hInstance, NULL);
-    if(Windowhandle == 0) return nullptr;
-
-    // Use a pixel-value of {0xFF, 0xFF, 0xFF} to mean transparent, because we should not use pure white anyway.
-    if(FALSE == SetLayeredWindowAttributes(Windowhandle, 0xFFFFFF, 0, LWA_COLORKEY)) return nullptr;
-
-    // Resize the window to the requested size.
-    SetWindowPos(Windowhandle, NULL,
-                 std::lround(Desktopcenterx - Windowsize.x * 0.5),
-                 std::lround(Desktopcentery - Windowsize.y * 0.5),
-                 Windowsize.x, Windowsize.y,
-                 SWP_NOSENDCHANGING);
-    ShowWindow(Windowhandle, SW_SHOWNORMAL);
-    return Windowhandle;
-}
-
-// Get input and other such interrupts.
-inline bool Hittest(point2_t Point, vec4_t Area)
+#include <Core/Animation.hpp>
+#include <Core/Timers.hpp>
+#include <Platform/Platform.hpp>
+#include <Utilities/Logging.hpp>
+#include <Utilities/Profiler.hpp>
+#include <Utilities/Histogram.hpp>
+
+// The window main() drives, for the callbacks below.
+static Platform::Window_t *Mainwindow{};
+
+// Everything main() registers, a compiled blueprint fails to build if it names anything else.
+struct Namedcallback_t { const char *Name; bool (*Callback)(Element_t &This, const void *Argument); };
+constexpr Namedcallback_t Namedcallbacks[]
 {
-    return Point.x >= Area.x0 && Point.x <= Area.x1 && Point.y >= Area.y0 && Point.y <= Area.y1;
-}
-void Processmessages(const void *Windowhandle, Array<Element_t, UINT8_MAX> &Nodetree, Array<Callback_t, UINT8_MAX> &Callbacks)
-{
-    MSG Event{};
-
-    // Non-blocking polling for messages.
-    while(PeekMessageA(&Event, (HWND)Windowhandle, NULL, NULL, PM_REMOVE) > 0)
+    { "Toolbar::onState", [](Element_t &, const void *Param) -> bool
     {
-        // Process mouse events first as they are the most common.
-        if(Event.message >= WM_MOUSEFIRST && Event.message <= WM_MOUSELAST)
-        {
-            // Coordinates relative to the window.
-            const point2_t Mouse{ GET_X_LPARAM(Event.lParam), GET_Y_LPARAM(Event.lParam) };
-            Array<uint8_t, UINT8_MAX> Hit, Miss;
-
-            // Recursive check of the nodes following the root.
-            std::function<void(uint8_t, bool)> Lambda = [&](uint8_t Piviot, bool Missed) -> void
-            {
-                const auto &This = Nodetree[Piviot];
-                if(!Missed) Missed = !Hittest(Mouse, This.Area);
-
-                if(This.Child_1) Lambda(This.Child_1, Missed);
-                if(This.Child_2) Lambda(This.Child_2, Missed);
-                if(This.Child_3) Lambda(This.Child_3, Missed);
-                if(This.Child_4) Lambda(This.Child_4, Missed);
-
-                if(Missed) Miss.add(Piviot);
-                else Hit.add(Piviot);
-            };
-            Lambda(0, false);
-
-            // Clear the state of missed elements.
-            for(size_t i = 0; i < Miss.Size; ++i)
-            {
-                auto &Node = Nodetree[Miss[i]];
-
-                if(Node.State.isHoveredover)
-                {
-                    auto Copy = Node.State;
-                    Copy.isHoveredover = false;
-                    Copy.isLeftclicked &= Event.message == WM_LBUTTONUP;
-                    Copy.isRightclicked &= Event.message == WM_RBUTTONUP;
-                    Copy.isMiddleclicked &= Event.message == WM_MBUTTONUP;
-                    if(Node.onState) Callbacks[Node.onState](Node, &Copy);
-
-                    Node.State = Copy;
-                }
-            }
-
-            // Notify the set elements.
-            for(size_t i = 0; i < Hit.Size; ++i)
-            {
-                auto &Node = Nodetree[Hit[i]];
-                auto Copy = Node.State;
-
-                Copy.isHoveredover = true;
-                Copy.isLeftclicked |= Event.message == WM_LBUTTONDOWN;
-                Copy.isRightclicked |= Event.message == WM_RBUTTONDOWN;
-                Copy.isMiddleclicked |= Event.message == WM_MBUTTONDOWN;
-                if(Node.onState) Callbacks[Node.onState](Node, &Copy);
-
-                Node.State = Copy;
-            }
-
-            continue;
-        }
-
-        // If Windows wants us to redraw, we oblige.
-        if(Event.message == WM_PAINT) Global::isDirty = true;
-
-        // If we should quit, break the loop without processing the rest of the queue.
-        if(Event.message == WM_SYSCOMMAND && Event.wParam == SC_CLOSE)
-        {
-            Global::Errorno = 1;
-            return;
-        }
-
-        // If we couldn't handle the event, let Windows do it.
-        DispatchMessageA(&Event);
-    }
-}
+        const auto Newstate = static_cast<const Elementstate_t *>(Param);
+        if(Newstate->isLeftclicked) Mainwindow->Beginmove();
+        return Newstate->isLeftclicked;
+    } },
+};
 
-// Parse the markup into arrays.
-bool Parseblueprint(vec4_t Boundingbox, std::string_view Filepath, Array<Element_t, UINT8_MAX> *Nodes,
-                    Array<Class_t, UINT8_MAX> *Properties, Array<Callback_t, UINT8_MAX> *Callbacks)
+#if defined(HAS_COMPILEDBLUEPRINT)
+// The generated header checks the names it uses against these.
+constexpr auto Registeredcallbacks = []()
 {
-    // Parse the XML document.
-    pugi::xml_document Document;
-    if(!Document.load_file(Filepath.data())) return false;
+    std::array<uint32_t, std::size(Namedcallbacks)> Hashes{};
+    for(size_t i = 0; i < Hashes.size(); ++i) Hashes[i] = Hash::FNV1a_32(Namedcallbacks[i].Name);
+    return Hashes;
+}();
+#include <Mainwindow.blueprint.hpp>
+#endif
 
-    // Ensure that the arrays are 'empty'.
-    Nodes->Size = Properties->Size = 0;
-    Callbacks->Size = 1;
+// Entrypoint.
+int main(int argc, char **argv)
+{
+    point2_t Windowsize{ 1280, 720 };
 
-    // Temporary storage for hashes.
-    std::unordered_map<uint32_t, uint8_t> Classindex{};
+    // This thread drives a single UI, the blueprint's stores are too large for the stack.
+    const auto Context = std::make_shared<Context_t>();
+    const Context_t::Bind_t Bound(*Context);
+    auto &Nodetree = Context->Nodetree;
+    auto &Classes = Context->Classes;
+    auto &Callbacks = Context->Callbacks;
 
-    // Initialize the class system.
-    for(const auto &Class : Document.children("Class"))
-    {
-        auto [Index, pClass] = Properties->add();
-        Classindex[Hash::FNV1a_32(Class.attribute("Name").as_string())] = Index;
-
-        const auto Size = Class.child("Size");
-        pClass->insert_or_assign(Hash::FNV1a_32("Size"), vec2_t{
-            Size.attribute("Width").as_float() / 100,
-            Size.attribute("Height").as_float() / 100 });
-
-        const auto Offset = Class.child("Offset");
-        pClass->insert_or_assign(Hash::FNV1a_32("Offset"), vec2_t{
-            Offset.attribute("Left").as_float() / 100,
-            Offset.attribute("Top").as_float() / 100 });
-
-        const auto Background = Class.child("Background");
-        pClass->insert_or_assign(Hash::FNV1a_32("Background"), Attributes::Background{
-                                     _byteswap_ulong(Background.attribute("Colour").as_uint()),
-                                     _byteswap_ulong(Background.attribute("Border").as_uint()),
-                                     Background.attribute("Image").as_string() });
-    }
+    // As we are single-threaded (in release), boost our priority.
+    #if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+    #endif
 
-    // Build the node-tree recursively.
-    std::function<uint8_t(const pugi::xml_node &)> Buildnode = [&](const pugi::xml_node &Node) -> uint8_t
+    // Offscreen for profiling, e.g. --headless 600 to run 600 frames as fast as possible.
+    // Input can be recorded with --record Session.trace and fed back offscreen with --replay Session.trace [--realtime].
+    bool isHeadless{}, isRealtime{};
+    uint64_t Framelimit{};
+    std::string_view Recordpath{}, Replaypath{};
+    for(int i = 1; i < argc; ++i)
     {
-        auto [Index, Entry] = Nodes->add();
-        Entry->StyleID = Classindex[Hash::FNV1a_32(Node.attribute("Class").as_string())];
-
-        const auto Register = [&](auto Iterator) -> uint8_t
+        const std::string_view Argument{ argv[i] };
+        if(Argument == "--headless")
         {
-            if(Iterator == Global::Callbacks.end()) return 0;
-
-            // Skip the dummy function.
-            for(uint32_t i = 1; i < Callbacks->Size; ++i)
-            {
-                // HACK(tcn): Apparently std::function::target() does not like lambdas..
-                if(0 == std::memcmp(&(*Callbacks)[i], &Iterator->second, sizeof(Callback_t)))
-                {
-                    return i & 0xFF;
-                }
-            }
-
-            auto [i, _] = Callbacks->add(Iterator->second);
-            return i & 0xFF;
-        };
-        Entry->onFrame = Register(Global::Callbacks.find(Hash::FNV1a_32(Node.child_value("onFrame"))));
-        Entry->onState = Register(Global::Callbacks.find(Hash::FNV1a_32(Node.child_value("onState"))));
-
-        for(const auto &Child : Node.children("Node"))
-        {
-            if(!Entry->Child_1) { Entry->Child_1 = Buildnode(Child); continue; }
-            if(!Entry->Child_2) { Entry->Child_2 = Buildnode(Child); continue; }
-            if(!Entry->Child_3) { Entry->Child_3 = Buildnode(Child); continue; }
-            if(!Entry->Child_4) { Entry->Child_4 = Buildnode(Child); continue; }
-
-            assert(false);
+            isHeadless = true;
+            if(i + 1 < argc && std::isdigit(uint8_t(argv[i + 1][0]))) Framelimit = std::strtoull(argv[++i], nullptr, 10);
         }
-
-        return Index;
-    };
-    for(const auto &Node : Document.children("Node"))
-    {
-        Buildnode(Node);
+        else if(Argument == "--record" && i + 1 < argc) Recordpath = argv[++i];
+        else if(Argument == "--replay" && i + 1 < argc) Replaypath = argv[++i];
+        else if(Argument == "--realtime") isRealtime = true;
     }
 
-    // Calculate the dimensions of the items.
-    std::function<void(uint8_t, vec4_t)> Initialize = [&](uint8_t Piviot, vec4_t Box)
+    std::unique_ptr<Platform::Window_t> Window{};
+    Platform::Replay_t *Replay{};
+    if(!Replaypath.empty())
     {
-        auto This = &(*Nodes)[Piviot];
-        const auto Width = Box.x1 - Box.x0;
-        const auto Height = Box.y1 - Box.y0;
-        const auto Attributes = (*Properties)[This->StyleID];
-        const auto Size = Attributes.find(Hash::FNV1a_32("Size"));
-        const auto Offset = Attributes.find(Hash::FNV1a_32("Offset"));
-
-        This->Area = {};
-        if(Size != Attributes.end())
-        {
-            This->Area.x1 = Width * std::any_cast<vec2_t>(Size->second).x;
-            This->Area.y1 = Height * std::any_cast<vec2_t>(Size->second).y;
-        }
-        if(Offset != Attributes.end())
+        auto Trace = Platform::Loadtrace(Replaypath, isRealtime);
+        if(!Trace)
         {
-            This->Area.x0 += Box.x0 + Width * std::any_cast<vec2_t>(Offset->second).x;
-            This->Area.x1 += Box.x0 + Width * std::any_cast<vec2_t>(Offset->second).x;
-            This->Area.y0 += Box.y0 + Height * std::any_cast<vec2_t>(Offset->second).y;
-            This->Area.y1 += Box.y0 + Height * std::any_cast<vec2_t>(Offset->second).y;
+            Logging::Print('E', va("Could not load the trace %.*s", int(Replaypath.size()), Replaypath.data()));
+            return 1;
         }
 
-        if(This->Child_1) Initialize(This->Child_1, This->Area);
-        if(This->Child_2) Initialize(This->Child_2, This->Area);
-        if(This->Child_3) Initialize(This->Child_3, This->Area);
-        if(This->Child_4) Initialize(This->Child_4, This->Area);
-    };
-    Initialize(0, Boundingbox);
-
-    return true;
-}
-
-// Entrypoint.
-int __cdecl main(int, char **)
-{
-    RECT Desktoparea{};
-    point2_t Windowsize{ 1280, 720 };
-
-    // As we are single-threaded (in release), boost our priority.
-    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
-
-    // Create the window based on our environment.
-    SystemParametersInfoA(SPI_GETWORKAREA, 0, &Desktoparea, 0);
-    const auto Windowhandle = Createwindow(Windowsize, Desktoparea);
-
-    // Initialize GDI with Windows's default parameters.
-    Gdiplus::GdiplusStartupInput Input{}; ULONG_PTR T;
-    Gdiplus::GdiplusStartup(&T, &Input, nullptr);
+        Replay = Trace.get();
+        Timers::Usevirtualclock();
+        Windowsize = Trace->Size;
+        Window = std::move(Trace);
+    }
+    else if(isHeadless) Window = std::make_unique<Platform::Headless_t>(Windowsize);
+    else Window = Platform::Createwindow(Windowsize);
 
-    // TODO(tcn): Move this somewhere..
-    Global::Callbacks[Hash::FNV1a_32("Toolbar::onState")] = [&](Element_t &This, const void *Param) -> bool
+    if(!Window)
     {
-        auto Newstate = static_cast<const Elementstate_t *>(Param);
-
-        if(Newstate->isLeftclicked)
-        {
-            POINT Point;
-            ReleaseCapture();
-            GetCursorPos(&Point);
-            SendMessageA((HWND)Windowhandle, WM_NCLBUTTONDOWN, HTCAPTION, MAKEWPARAM(Point.x, Point.y));
-        }
+        Logging::Print('E', "Could not create a window, no display? Try --headless.");
+        return 1;
+    }
+    if(!Recordpath.empty()) Window = std::make_unique<Platform::Recorder_t>(std::move(Window), Recordpath);
+
+    // Per mouse-event, the time spent in Processinput and the time until the frame it caused was presented.
+    const bool isTracing = Replay || !Recordpath.empty();
+    Histogram_t Dispatchlatency{}, Presentlatency{};
+    std::vector<Platform::Timepoint_t> Dispatched{};
+
+    // Opt-in function timing for release builds, e.g. APPCORE_PROFILE="+0x1a2b0,+0x1c040" with offsets from nm.
+    // Names are looked up with dlsym/GetProcAddress, so only exported symbols resolve and then by their mangled name.
+    #if defined(_M_X64) || defined(__x86_64__)
+    const auto Profiledfunctions = std::getenv("APPCORE_PROFILE");
+    if(Profiledfunctions) Logging::Print('I', va("Profiling %zu functions", Profiler::Addsymbols(Profiledfunctions)));
+    #endif
 
-        return Newstate->isLeftclicked;
-    };
+    Mainwindow = Window.get();
+    for(const auto &[Name, Callback] : Namedcallbacks) Context->Namedcallbacks[Hash::FNV1a_32(Name)] = Callback;
 
     // Parse our markup.
-    Array<Class_t, UINT8_MAX> Classes;
-    Array<Element_t, UINT8_MAX> Nodetree;
-    Array<Callback_t, UINT8_MAX> Callbacks;
+    #if defined(HAS_COMPILEDBLUEPRINT)
+    Loadblueprint({ 0.0f, 0.0f, float(Windowsize.x), float(Windowsize.y) },
+                  Blueprint::Mainwindow::Compiled, &Nodetree, &Classes, &Callbacks);
+    #else
     Parseblueprint({ 0.0f, 0.0f, float(Windowsize.x), float(Windowsize.y) },
                    "../Assets/Mainwindow.xml", &Nodetree, &Classes, &Callbacks);
+    #endif
 
-    // Developer only.
-    #if !defined(NDEBUG)
-    std::thread([]()
+    // Tweens cover the common animations, only the nodes that still want a per-frame callback are visited.
+    std::vector<Nodeid_t> Framecallbacks{};
+    const auto Collectcallbacks = [&]()
     {
-        FILETIME Blueprint{}, Style{};
+        Framecallbacks.clear();
+        for(uint32_t i = 0; i < Nodetree.Size; ++i)
+            if(Nodetree[i].onFrame) Framecallbacks.push_back(i);
+    };
+    Collectcallbacks();
+
+    // Developer only, compiled blueprints can't be reloaded.
+    #if !defined(NDEBUG) && !defined(HAS_COMPILEDBLUEPRINT)
+    std::thread([Context]()
+    {
+        uint32_t Blueprint{};
 
         while(true)
         {
-            if(auto Filehandle = CreateFileA("../Assets/Mainwindow.xml", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL))
+            const auto Modified = FS::Filestats("../Assets/Mainwindow.xml").Modified;
+            if(Modified != Blueprint)
             {
-                FILETIME Localresult{};
-                GetFileTime(Filehandle, NULL, NULL, &Localresult);
-
-                if(*(uint64_t *)&Localresult != *(uint64_t *)&Blueprint)
-                {
-                    Blueprint = Localresult;
-                    Global::shouldReload = true;
-                }
-
-                CloseHandle(Filehandle);
+                Blueprint = Modified;
+                Context->shouldReload = true;
             }
 
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -325,113 +153,153 @@ int __cdecl main(int, char **)
     }).detach();
     #endif
 
+    Context->Resizesurface(Windowsize);
+
+    // Window-managers can send a size per pixel of a drag, only the latest is laid out and at most once per frame.
+    constexpr auto Frametime = std::chrono::milliseconds(1000 / 60);
+    auto Pendingsize{ Windowsize };
+    Platform::Timepoint_t Lastlayout{};
+
     // Main loop.
+    uint64_t Framecount{};
     while(true)
     {
         // Track the frame-time, should be less than 33ms.
-        static auto Lastframe{ std::chrono::high_resolution_clock::now() };
-        const auto Thisframe{ std::chrono::high_resolution_clock::now() };
+        static auto Lastframe{ Platform::Now() };
+        const auto Thisframe{ Platform::Now() };
 
-        // Process window-messages.
-        Processmessages(Windowhandle, Nodetree, Callbacks);
+        // Scratch-memory from the last frame is no longer referenced.
+        Context->Framearena.Reset();
 
-        // And update the state as needed.
-        const auto Deltatime = std::chrono::duration<float>(Thisframe - Lastframe).count();
-        for(size_t i = 0; i < Nodetree.Size; ++i)
-        {
-            auto &Node = Nodetree[i];
-            if(Node.onFrame) Callbacks[Node.onFrame](Node, (void *)&Deltatime);
-        }
-
-        // Render the previous frame.
-        if(Global::isDirty)
+        // Process window-messages.
+        for(const auto &Event : Window->Poll())
         {
-            // Notify Windows, the window needs repainting.
-            InvalidateRect((HWND)Windowhandle, NULL, FALSE);
-
-            // Grab a handle to the window.
-            PAINTSTRUCT Updateinformation{};
-            auto Devicecontext = BeginPaint((HWND)Windowhandle, &Updateinformation);
-            auto Memorycontext = CreateCompatibleDC(Devicecontext);
-
-            // Create a surface that we can draw to.
-            auto Surface = CreateCompatibleBitmap(Devicecontext, Windowsize.x, Windowsize.y);
-            auto Backup = (HBITMAP)SelectObject(Memorycontext, Surface);
-
-            // Create a graphics object and clear the surface to white (chroma-key for transparent).
-            auto Drawingcontext = std::make_unique<Gdiplus::Graphics>(Memorycontext);
-            Drawingcontext->Clear(Gdiplus::Color::White);
-
-            // Render each of the nodes to the window.
-            for(size_t i = 0; i < Nodetree.Size; ++i)
+            if(Event.Type == Platform::Event_t::Mouse)
             {
-                // Background attributes.
-                const auto Background = std::any_cast<Attributes::Background>
-                    (Classes[Nodetree[i].StyleID][Hash::FNV1a_32("Background")]);
-
-                // Not allowed to be initialized without a colour.. Silly..
-                static auto Brush{ new Gdiplus::SolidBrush(Gdiplus::Color()) };
-                static auto Pen{ new Gdiplus::Pen(Gdiplus::Color()) };
-
-                // Render order: Solid, Overlay, Outline.
-                if(Background.Colour)
-                {
-                    Brush->SetColor(Background.Colour);
-                    Drawingcontext->FillRectangle(Brush,
-                                                  Nodetree[i].Area.x0,
-                                                  Nodetree[i].Area.y0,
-                                                  Nodetree[i].Area.x1 - Nodetree[i].Area.x0,
-                                                  Nodetree[i].Area.y1 - Nodetree[i].Area.y0);
-                }
-                if(!Background.Image.empty())
+                if(!isTracing) Processinput(Event.Input, Nodetree, Callbacks);
+                else
                 {
-                    // TODO(tcn): Need a buffer system..
-                }
-                if(Background.Border)
-                {
-                    Pen->SetColor(Background.Border);
-
-                    // HACK(tcn): Drawingcontext->DrawLines will allocate a separate buffer, so we draw each line directly.
-                    Drawingcontext->DrawLine(Pen, Nodetree[i].Area.x0, Nodetree[i].Area.y0, Nodetree[i].Area.x1 - 1, Nodetree[i].Area.y0);
-                    Drawingcontext->DrawLine(Pen, Nodetree[i].Area.x1 - 1, Nodetree[i].Area.y0, Nodetree[i].Area.x1 - 1, Nodetree[i].Area.y1 - 1);
-                    Drawingcontext->DrawLine(Pen, Nodetree[i].Area.x1 - 1, Nodetree[i].Area.y1 - 1, Nodetree[i].Area.x0, Nodetree[i].Area.y1 - 1);
-                    Drawingcontext->DrawLine(Pen, Nodetree[i].Area.x0, Nodetree[i].Area.y1 - 1, Nodetree[i].Area.x0, Nodetree[i].Area.y0);
+                    const auto Start = Platform::Now();
+                    Processinput(Event.Input, Nodetree, Callbacks);
+                    Dispatchlatency.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(Platform::Now() - Start).count());
+                    Dispatched.push_back(Start);
                 }
             }
+            if(Event.Type == Platform::Event_t::Paint) Context->isDirty = true;
+            if(Event.Type == Platform::Event_t::Resize) Pendingsize = Event.Size;
+            if(Event.Type == Platform::Event_t::Close) Context->Errorno = 1;
+        }
 
-            // Present to the window.
-            BitBlt(Devicecontext, 0, 0, Windowsize.x, Windowsize.y, Memorycontext, 0, 0, SRCCOPY);
+        // Only the layout-stage is re-run, the blueprint and its classes are unchanged.
+        const bool isResizing = Pendingsize.x != Windowsize.x || Pendingsize.y != Windowsize.y;
+        if(isResizing && Thisframe - Lastlayout >= Frametime)
+        {
+            Windowsize = Pendingsize;
+            Context->Resizesurface(Windowsize);
+            Relayoutnodes({ 0.0f, 0.0f, float(Windowsize.x), float(Windowsize.y) }, &Nodetree, &Classes);
+            Lastlayout = Thisframe;
+            Context->isDirty = true;
+        }
+
+        // And update the state as needed, the frame is only redrawn if a tween moved or restyled something.
+        // Capped, as the loop may have slept for a long time and a new tween shouldn't finish on its first frame.
+        // Replays use the recorded frame-time, so the tweens, timers and callbacks see the same steps as the session did.
+        const auto Deltatime = std::min(Replay ? Replay->Deltatime : std::chrono::duration<float>(Thisframe - Lastframe).count(), 0.1f);
+        Timers::Advance(Replay ? Replay->Elapsedmicroseconds / 1000 : Timers::Clock());
+        const bool isAnimating = Animation::Advance(Deltatime, Classes);
+        if(!Animation::Changed().empty()) Context->isDirty = true;
+        for(const auto Index : Framecallbacks)
+        {
+            auto &Node = Nodetree[Index];
+            Callbacks[Node.onFrame](Node, (void *)&Deltatime);
+        }
 
-            // Restore the surface and do cleanup.
-            SelectObject(Memorycontext, Backup);
-            DeleteDC(Memorycontext);
-            DeleteObject(Surface);
+        // Render the previous frame.
+        if(Context->isDirty)
+        {
+            // Render each of the nodes to our own surface.
+            Rendernodes(Context->Surface, Nodetree, Classes);
 
-            // Notify Windows, we are done painting.
-            EndPaint((HWND)Windowhandle, &Updateinformation);
+            // Present to the window.
+            Window->Present(Context->Surface);
 
             // This frame is cleeeean.
-            Global::isDirty = false;
+            Context->isDirty = false;
+        }
+
+        // Input that didn't change anything is done once the frame is.
+        if(!Dispatched.empty())
+        {
+            const auto Presented = Platform::Now();
+            for(const auto &Start : Dispatched) Presentlatency.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(Presented - Start).count());
+            Dispatched.clear();
         }
 
         // Process any errors later.
-        if(Global::Errorno) break;
+        if(Context->Errorno) break;
+        if(Framelimit && ++Framecount == Framelimit) break;
 
         // Developer, reloading.
-        if(Global::shouldReload)
+        if(Context->shouldReload)
         {
             Parseblueprint({ 0.0f, 0.0f, float(Windowsize.x), float(Windowsize.y) },
                            "../Assets/Mainwindow.xml", &Nodetree, &Classes, &Callbacks);
-            Global::shouldReload = false;
-            Global::isDirty = true;
+            Collectcallbacks();
+            Context->shouldReload = false;
+            Context->isDirty = true;
         }
 
-        // Sleep until the next frame.
-        std::this_thread::sleep_until(Lastframe + std::chrono::milliseconds(1000 / 60));
+        // Sleep until the next frame or timer, or until there's input; idle windows only wake for timers.
+        auto Deadline = Thisframe + Frametime;
+        if(!isAnimating && Framecallbacks.empty() && !isResizing)
+        {
+            #if defined(NDEBUG)
+            Deadline = Thisframe + std::chrono::hours(1);
+            #else
+            Deadline = Thisframe + std::chrono::milliseconds(100);
+            #endif
+        }
+        if(const auto Nexttimer = Timers::Nextdeadline(); Nexttimer != UINT64_MAX && !Replay)
+            Deadline = std::min(Deadline, Platform::Timepoint_t(std::chrono::milliseconds(Nexttimer)));
+
+        Window->Wait(Deadline);
         Lastframe = Thisframe;
     }
 
     // Check errors.
 
+    // Microseconds, the buckets are within 12.5% of the value.
+    if(isTracing)
+    {
+        for(const auto &[Name, Histogram] : { std::pair{ "Dispatch", &Dispatchlatency }, std::pair{ "Present", &Presentlatency } })
+        {
+            Logging::Print('I', va("%-8s latency over %llu events: mean %.2f us, p50 %.2f us, p90 %.2f us, p99 %.2f us, p99.9 %.2f us, max %.2f us", Name,
+                                   static_cast<unsigned long long>(Histogram->Count), Histogram->Mean() / 1e3, Histogram->Percentile(0.5) / 1e3,
+                                   Histogram->Percentile(0.9) / 1e3, Histogram->Percentile(0.99) / 1e3, Histogram->Percentile(0.999) / 1e3, Histogram->Max / 1e3));
+
+            for(uint32_t i = 0; i < std::size(Histogram->Buckets); ++i)
+            {
+                if(!Histogram->Buckets[i]) continue;
+                Logging::Print('I', va("    <= %10.2f us %10llu", Histogram_t::Upperbound(i) / 1e3, static_cast<unsigned long long>(Histogram->Buckets[i])));
+            }
+        }
+    }
+
+    // Flame-graph input next to the log, and the totals in it.
+    #if defined(_M_X64) || defined(__x86_64__)
+    if(Profiledfunctions)
+    {
+        Profiler::Removeall();
+        const auto Report = Profiler::Collect();
+        Profiler::Writecollapsed(LOGPATH "/" MODULENAME ".folded", Report);
+
+        for(const auto &Function : Report.Functions)
+        {
+            Logging::Print('I', va("%-40.*s %10llu calls %12.3f ms inclusive %12.3f ms exclusive", int(Function.Name.size()), Function.Name.data(),
+                                   static_cast<unsigned long long>(Function.Calls), Function.Inclusive / 1e6, Function.Exclusive / 1e6));
+        }
+    }
+    #endif
+
     return 0;
 }
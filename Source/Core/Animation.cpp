@@ -0,0 +1,303 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-05
+    License: MIT
+*/
+
+#include <Stdinclude.hpp>
+#include <Core/Animation.hpp>
+
+namespace Animation
+{
+    // A track is a single float, so an area or a colour is four of them; replaced ones are dead until the next advance retires them.
+    enum Channel_t : uint8_t { Areax0, Areay0, Areax1, Areay1, Colour0, Colour1, Colour2, Colour3, Opacity, Channelcount, Dead = 0xFF };
+
+    // Structure of arrays, one set per easing-curve so advancing them has no per-track branches.
+    // A tween's tracks are added, replaced and retired together and in order, so an area or colour is always four consecutive tracks.
+    struct Tracks_t
+    {
+        std::vector<float> From, Delta, Elapsed, Rate, Value;
+        std::vector<Nodeid_t> Node;
+        std::vector<uint8_t> Channel;
+        uint32_t Deadcount{};
+    };
+    inline size_t Blocksize(uint8_t Channel) { return Channel == Areax0 || Channel == Colour0 ? 4 : 1; }
+    // Per context, as the tracks refer to its node-store.
+    struct State_t
+    {
+        Tracks_t Tracks[Easingcount]{};
+
+        // Keyed by node, only animated nodes have one.
+        Hashmap::Flat<Style_t> Styles{};
+
+        // Where each property's track is, packed as easing and position, so new tweens can replace it.
+        Hashmap::Flat<uint32_t> Locations{};
+
+        // The nodes the last advance moved or restyled, and per node the advance that last reported it so it's only listed once.
+        std::vector<Nodeid_t> Changed{};
+        std::vector<uint32_t> Reported{};
+        uint32_t Advances{};
+
+        // Colours start from the class, which isn't known until the next advance.
+        uint32_t Pendingcolours{};
+    };
+    static State_t &State() { return Modulestate<State_t>(Activecontext->Modules.Animation); }
+    inline uint32_t Locationkey(Nodeid_t Node, uint8_t Channel) { return Node << 4 | Channel; }
+    inline Nodeid_t Nodeid(const Element_t &Node) { return Nodeid_t(&Node - Activecontext->Nodetree.Data.data()); }
+
+    // A NaN origin means it's resolved on the next advance, the target is kept in Delta until then.
+    static void Addtrack(Element_t &Element, uint8_t Channel, float From, float To, float Duration, Easing_t Easing)
+    {
+        auto &[Tracks, Styles, Locations, Changed, Reported, Advances, Pendingcolours] = State();
+        Easing = Easing < Easingcount ? Easing : Linear;
+
+        const auto Node = Nodeid(Element);
+        assert(Node < Activecontext->Nodetree.Size);
+
+        auto &Style = Styles.try_emplace(Node, Style_t{ 0, 1.0f, 0, false }).first->second;
+        auto &Set = Tracks[Easing];
+        Style.Activetracks++;
+
+        // The old track keeps its slot until the next advance, so the others don't move.
+        const auto [Location, isNew] = Locations.try_emplace(Locationkey(Node, Channel), uint32_t(Easing) << 24 | uint32_t(Set.Node.size()));
+        if(!isNew)
+        {
+            auto &Previous = Tracks[Location->second >> 24];
+            const auto Position = Location->second & 0xFFFFFF;
+
+            if(std::isnan(Previous.From[Position])) Pendingcolours--;
+            Previous.Channel[Position] = Dead;
+            Previous.Deadcount++;
+            Style.Activetracks--;
+            Location->second = uint32_t(Easing) << 24 | uint32_t(Set.Node.size());
+        }
+
+        Set.From.push_back(From);
+        Set.Delta.push_back(std::isnan(From) ? To : To - From);
+        Set.Elapsed.push_back(0.0f);
+        Set.Rate.push_back(1.0f / std::max(Duration, 1e-6f));
+        Set.Value.push_back(std::isnan(From) ? To : From);
+        Set.Node.push_back(Node);
+        Set.Channel.push_back(Channel);
+        if(std::isnan(From)) Pendingcolours++;
+    }
+
+    void Tweenarea(Element_t &Node, const vec4_t &Target, float Duration, Easing_t Easing)
+    {
+        const vec4_t Area = Node.Area;
+        for(uint8_t i = 0; i < 4; ++i) Addtrack(Node, Areax0 + i, Area.Raw[i], Target.Raw[i], Duration, Easing);
+    }
+    void Tweencolour(Element_t &Node, uint32_t Target, float Duration, Easing_t Easing)
+    {
+        const auto Style = Find(Node);
+        for(uint8_t i = 0; i < 4; ++i)
+        {
+            const auto From = Style && Style->hasColour ? float((Style->Colour >> (i * 8)) & 0xFF) : NAN;
+            Addtrack(Node, Colour0 + i, From, float((Target >> (i * 8)) & 0xFF), Duration, Easing);
+        }
+    }
+    void Tweenopacity(Element_t &Node, float Target, float Duration, Easing_t Easing)
+    {
+        const auto Style = Find(Node);
+        Addtrack(Node, Opacity, Style ? Style->Opacity : 1.0f, std::clamp(Target, 0.0f, 1.0f), Duration, Easing);
+    }
+
+    // The curves, evaluated four tracks at a time where possible.
+    template<Easing_t Easing> inline float Ease(float t)
+    {
+        if constexpr (Easing == Easein) return t * t * t;
+        if constexpr (Easing == Easeout) { const auto u = 1.0f - t; return 1.0f - u * u * u; }
+        if constexpr (Easing == Easeinout) return t * t * (3.0f - 2.0f * t);
+        return t;
+    }
+    #if defined(HAS_SSE2)
+    template<Easing_t Easing> inline __m128 Ease(__m128 t)
+    {
+        const auto One = _mm_set1_ps(1.0f);
+        if constexpr (Easing == Easein) return _mm_mul_ps(_mm_mul_ps(t, t), t);
+        if constexpr (Easing == Easeout) { const auto u = _mm_sub_ps(One, t); return _mm_sub_ps(One, _mm_mul_ps(_mm_mul_ps(u, u), u)); }
+        if constexpr (Easing == Easeinout) return _mm_mul_ps(_mm_mul_ps(t, t), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_add_ps(t, t)));
+        return t;
+    }
+    #endif
+
+    // Value = From + Delta * Ease(min(Elapsed * Rate, 1)), true if any track finished.
+    template<Easing_t Easing> static bool Step(Tracks_t &Set, float Deltatime)
+    {
+        const auto Count = Set.Node.size();
+        bool hasFinished{};
+        size_t i = 0;
+
+        #if defined(HAS_SSE2)
+        const auto Step = _mm_set1_ps(Deltatime), One = _mm_set1_ps(1.0f);
+        auto Finished = _mm_setzero_ps();
+        for(; i + 4 <= Count; i += 4)
+        {
+            const auto Elapsed = _mm_add_ps(_mm_loadu_ps(&Set.Elapsed[i]), Step);
+            const auto Progress = _mm_mul_ps(Elapsed, _mm_loadu_ps(&Set.Rate[i]));
+            const auto Value = _mm_add_ps(_mm_loadu_ps(&Set.From[i]), _mm_mul_ps(_mm_loadu_ps(&Set.Delta[i]), Ease<Easing>(_mm_min_ps(Progress, One))));
+
+            _mm_storeu_ps(&Set.Elapsed[i], Elapsed);
+            _mm_storeu_ps(&Set.Value[i], Value);
+            Finished = _mm_or_ps(Finished, _mm_cmpge_ps(Progress, One));
+        }
+        hasFinished = _mm_movemask_ps(Finished);
+        #endif
+
+        for(; i < Count; ++i)
+        {
+            Set.Elapsed[i] += Deltatime;
+            Set.Value[i] = Set.From[i] + Set.Delta[i] * Ease<Easing>(std::min(Set.Elapsed[i] * Set.Rate[i], 1.0f));
+            hasFinished |= Set.Elapsed[i] * Set.Rate[i] >= 1.0f;
+        }
+
+        return hasFinished;
+    }
+
+    // A block is the tracks of one tween, stored to the node as a whole; true if that changed anything.
+    static bool Writeback(const Tracks_t &Set, size_t First, Element_t &Element, Hashmap::Flat<Style_t> &Styles)
+    {
+        const auto Channel = Set.Channel[First];
+        if(Channel == Areax0)
+        {
+            const auto Previous = Element.Area;
+            vec4_t Area;
+            std::memcpy(Area.Raw, &Set.Value[First], sizeof(Area.Raw));
+            Element.Area = Area;
+            return std::memcmp(&Previous, &Element.Area, sizeof(Previous)) != 0;
+        }
+
+        auto &Style = Styles.find(Set.Node[First])->second;
+        const auto Previous = Style;
+        if(Channel == Opacity) Style.Opacity = Set.Value[First];
+        else
+        {
+            uint32_t Colour{};
+            for(size_t i = 0; i < 4; ++i) Colour |= uint32_t(std::clamp(Set.Value[First + i] + 0.5f, 0.0f, 255.0f)) << (i * 8);
+            Style.Colour = Colour;
+            Style.hasColour = true;
+        }
+        return Previous.Opacity != Style.Opacity || Previous.Colour != Style.Colour || Previous.hasColour != Style.hasColour;
+    }
+
+    bool Advance(float Deltatime, Array<Class_t, Maxclasses> &Classes)
+    {
+        auto &[Tracks, Styles, Locations, Changed, Reported, Advances, Pendingcolours] = State();
+        Changed.clear();
+        if(Locations.empty()) return false;
+
+        auto &Nodetree = Activecontext->Nodetree;
+        Reported.resize(Nodetree.Size);
+        Advances++;
+        if(Pendingcolours)
+        {
+            for(uint8_t Easing = 0; Easing < Easingcount; ++Easing)
+            {
+                auto &Set = Tracks[Easing];
+                for(size_t i = 0; i < Set.Node.size(); ++i)
+                {
+                    if(!std::isnan(Set.From[i]) || Set.Channel[i] == Dead) continue;
+
+                    const auto Background = std::get_if<Attributes::Background>(&Classes[Nodetree[Set.Node[i]].StyleID][Hash::FNV1a_32("Background")]);
+                    Set.From[i] = float(((Background ? Background->Colour : 0) >> ((Set.Channel[i] - Colour0) * 8)) & 0xFF);
+                    Set.Delta[i] -= Set.From[i];
+                }
+            }
+            Pendingcolours = 0;
+        }
+
+        bool isRetiring[Easingcount]{};
+        isRetiring[Linear] = Step<Linear>(Tracks[Linear], Deltatime) || Tracks[Linear].Deadcount;
+        isRetiring[Easein] = Step<Easein>(Tracks[Easein], Deltatime) || Tracks[Easein].Deadcount;
+        isRetiring[Easeout] = Step<Easeout>(Tracks[Easeout], Deltatime) || Tracks[Easeout].Deadcount;
+        isRetiring[Easeinout] = Step<Easeinout>(Tracks[Easeinout], Deltatime) || Tracks[Easeinout].Deadcount;
+
+        // Write the values back a block of tracks at a time, only nodes that actually changed are reported.
+        for(auto &Set : Tracks)
+        {
+            for(size_t First = 0; First < Set.Node.size(); First += Blocksize(Set.Channel[First]))
+            {
+                const auto Node = Set.Node[First];
+                if(Set.Channel[First] == Dead) continue;
+
+                if(Writeback(Set, First, Nodetree[Node], Styles) && Reported[Node] != Advances)
+                {
+                    Reported[Node] = Advances;
+                    Changed.push_back(Node);
+                }
+            }
+        }
+
+        // Retire the finished and replaced tracks, in order so the rest keep their blocks.
+        bool hasFinished{};
+        for(uint8_t Easing = 0; Easing < Easingcount; ++Easing)
+        {
+            auto &Set = Tracks[Easing];
+            if(!isRetiring[Easing]) continue;
+
+            size_t Kept{};
+            for(size_t i = 0; i < Set.Node.size(); ++i)
+            {
+                if(Set.Channel[i] == Dead) continue;
+                if(Set.Elapsed[i] * Set.Rate[i] >= 1.0f)
+                {
+                    Styles.find(Set.Node[i])->second.Activetracks--;
+                    Locations.erase(Locationkey(Set.Node[i], Set.Channel[i]));
+                    hasFinished = true;
+                    continue;
+                }
+
+                if(Kept != i)
+                {
+                    Set.From[Kept] = Set.From[i]; Set.Delta[Kept] = Set.Delta[i];
+                    Set.Elapsed[Kept] = Set.Elapsed[i]; Set.Rate[Kept] = Set.Rate[i];
+                    Set.Value[Kept] = Set.Value[i]; Set.Node[Kept] = Set.Node[i]; Set.Channel[Kept] = Set.Channel[i];
+                    Locations[Locationkey(Set.Node[Kept], Set.Channel[Kept])] = uint32_t(Easing) << 24 | uint32_t(Kept);
+                }
+                Kept++;
+            }
+
+            Set.From.resize(Kept); Set.Delta.resize(Kept); Set.Elapsed.resize(Kept); Set.Rate.resize(Kept);
+            Set.Value.resize(Kept); Set.Node.resize(Kept); Set.Channel.resize(Kept);
+            Set.Deadcount = 0;
+        }
+
+        // Finished and back where the class has it, nothing left to override.
+        if(hasFinished)
+        {
+            for(auto Iterator = Styles.begin(); Iterator != Styles.end();)
+            {
+                const auto &Style = Iterator->second;
+                if(!Style.Activetracks && !Style.hasColour && Style.Opacity >= 1.0f) Iterator = Styles.erase(Iterator);
+                else ++Iterator;
+            }
+        }
+
+        return true;
+    }
+
+    std::span<const Nodeid_t> Changed()
+    {
+        return State().Changed;
+    }
+
+    const Style_t *Find(const Element_t &Node)
+    {
+        const auto &Styles = State().Styles;
+        if(Styles.empty()) return nullptr;
+
+        const auto Iterator = Styles.find(Nodeid(Node));
+        return Iterator == Styles.end() ? nullptr : &Iterator->second;
+    }
+
+    void Clear()
+    {
+        auto &[Tracks, Styles, Locations, Changed, Reported, Advances, Pendingcolours] = State();
+        for(auto &Set : Tracks) Set = {};
+        Styles.clear();
+        Locations.clear();
+        Changed.clear();
+        Reported.clear();
+        Pendingcolours = 0;
+    }
+}
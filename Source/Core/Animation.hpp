@@ -0,0 +1,34 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-05
+    License: MIT
+*/
+
+#pragma once
+#include <Stdinclude.hpp>
+#include <span>
+
+// Property tweens, stored per easing-curve as flat tracks and advanced together once per frame.
+namespace Animation
+{
+    enum Easing_t : uint8_t { Linear, Easein, Easeout, Easeinout, Easingcount };
+
+    // Start from the current value, replacing any tween already running on the same property.
+    // Area only moves the element itself, the children keep their layout; the node must be in the context's node-store.
+    void Tweenarea(Element_t &Node, const vec4_t &Target, float Duration, Easing_t Easing = Easeinout);
+    void Tweencolour(Element_t &Node, uint32_t Target, float Duration, Easing_t Easing = Easeinout);
+    void Tweenopacity(Element_t &Node, float Target, float Duration, Easing_t Easing = Easeinout);
+
+    // Step every tween, colours start from the element's class; returns true while any are running.
+    bool Advance(float Deltatime, Array<Class_t, Maxclasses> &Classes);
+
+    // The nodes whose area or style the last advance changed, nothing to redraw if it's empty.
+    std::span<const Nodeid_t> Changed();
+
+    // What the renderer applies on top of the class, only animated elements have one.
+    struct Style_t { uint32_t Colour; float Opacity; uint32_t Activetracks; bool hasColour; };
+    const Style_t *Find(const Element_t &Node);
+
+    // The node-store is being rebuilt, so every pointer into it is stale.
+    void Clear();
+}
@@ -0,0 +1,452 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-09-18
+    License: MIT
+*/
+
+#include <Stdinclude.hpp>
+#include <Core/Blueprint.hpp>
+#include <Core/Animation.hpp>
+#include <Core/Timers.hpp>
+#include <Core/Lists.hpp>
+#include <Utilities/Filesystem.hpp>
+#include <Utilities/Logging.hpp>
+#include <Utilities/Xmlreader.hpp>
+
+// Compiled blueprints are cached by the source, bump the version when the layout below changes.
+// Nodes are written as-is, so builds with another Element_t (e.g. COMPACT_GEOMETRY) get their own entries.
+constexpr uint32_t Blueprintkind = Hash::FNV1a_32("Blueprint_v5") ^ uint32_t(sizeof(Element_t));
+using Blueprint::Callbacknames_t;
+
+// Classes are allocated from the parse-arena, so the old ones must be released before it's reset.
+void Releaseclasses(Array<Class_t, Maxclasses> *Properties)
+{
+    for(uint32_t i = 0; i < Properties->Size; ++i)
+    {
+        std::destroy_at(&(*Properties)[i]);
+        std::construct_at(&(*Properties)[i]);
+    }
+
+    Properties->Size = 0;
+}
+// Every attribute is present but draws or does nothing, so readers don't need to check.
+Class_t *Addclass(Array<Class_t, Maxclasses> *Properties)
+{
+    auto [_, pClass] = Properties->add();
+    std::destroy_at(pClass);
+    std::construct_at(pClass, &Activecontext->Parsearena);
+
+    pClass->insert_or_assign(Hash::FNV1a_32("Size"), vec2_t{});
+    pClass->insert_or_assign(Hash::FNV1a_32("Offset"), vec2_t{});
+    pClass->insert_or_assign(Hash::FNV1a_32("Background"), Attributes::Background{ 0, 0, 0.0f, 1.0f, {} });
+    pClass->insert_or_assign(Hash::FNV1a_32("Text"), Attributes::Text{ {}, {}, 0.0f, Byteswap(0x000000FF) });
+    pClass->insert_or_assign(Hash::FNV1a_32("List"), Attributes::List{});
+    return pClass;
+}
+
+// Flat representation of the arrays, callbacks are stored by name as the array is rebuilt on load.
+// The buffer lives in the frame-arena, so reloading an edited blueprint doesn't touch the heap either.
+std::pmr::basic_string<uint8_t> Serializeblueprint(Array<Element_t, Maxnodes> &Nodes, Array<Class_t, Maxclasses> &Properties,
+                                                   const std::pmr::vector<Callbacknames_t> &Callbackhashes)
+{
+    std::pmr::basic_string<uint8_t> Buffer{ &Activecontext->Framearena };
+    Buffer.reserve(sizeof(uint32_t) * 2 + Nodes.Size * (sizeof(Element_t) + sizeof(Callbacknames_t)) + Properties.Size * 128);
+
+    const auto Write = [&](const auto &Value) { Buffer.append((const uint8_t *)&Value, sizeof(Value)); };
+    const auto Writestring = [&](std::string_view String)
+    {
+        Write(uint32_t(String.size()));
+        Buffer.append((const uint8_t *)String.data(), String.size());
+    };
+
+    Write(Nodes.Size);
+    for(uint32_t i = 0; i < Nodes.Size; ++i)
+    {
+        Write(Nodes[i]);
+        Write(Callbackhashes[i]);
+    }
+
+    Write(Properties.Size);
+    for(uint32_t i = 0; i < Properties.Size; ++i)
+    {
+        const auto Size = std::get<vec2_t>(Properties[i][Hash::FNV1a_32("Size")]);
+        const auto Offset = std::get<vec2_t>(Properties[i][Hash::FNV1a_32("Offset")]);
+        const auto Background = std::get<Attributes::Background>(Properties[i][Hash::FNV1a_32("Background")]);
+        const auto Text = std::get<Attributes::Text>(Properties[i][Hash::FNV1a_32("Text")]);
+        const auto List = std::get<Attributes::List>(Properties[i][Hash::FNV1a_32("List")]);
+
+        Write(Size); Write(Offset);
+        Write(Background.Colour); Write(Background.Border);
+        Write(Background.Radius); Write(Background.Borderwidth);
+        Writestring(Background.Image);
+        Writestring(Text.String); Writestring(Text.Font);
+        Write(Text.Size); Write(Text.Colour);
+        Write(List.Count); Write(List.Overscan); Write(List.onBind); Write(List.isEnabled);
+    }
+
+    return Buffer;
+}
+bool Deserializeblueprint(std::basic_string_view<uint8_t> Buffer, Array<Element_t, Maxnodes> *Nodes, Array<Class_t, Maxclasses> *Properties,
+                          std::pmr::vector<Callbacknames_t> *Callbackhashes)
+{
+    const auto Read = [&](auto &Value) -> bool
+    {
+        if(Buffer.size() < sizeof(Value)) return false;
+        std::memcpy(&Value, Buffer.data(), sizeof(Value));
+        Buffer.remove_prefix(sizeof(Value));
+        return true;
+    };
+    const auto Readstring = [&](std::string_view &String) -> bool
+    {
+        uint32_t Length{};
+        if(!Read(Length) || Buffer.size() < Length) return false;
+        String = Activecontext->Parsearena.Copy({ (const char *)Buffer.data(), Length });
+        Buffer.remove_prefix(Length);
+        return true;
+    };
+
+    uint32_t Nodecount{};
+    if(!Read(Nodecount) || Nodecount > Maxnodes) return false;
+    for(uint32_t i = 0; i < Nodecount; ++i)
+    {
+        auto [_, Entry] = Nodes->add();
+        if(!Read(*Entry) || !Read(Callbackhashes->emplace_back())) return false;
+    }
+
+    uint32_t Classcount{};
+    if(!Read(Classcount) || Classcount > Maxclasses) return false;
+    for(uint32_t i = 0; i < Classcount; ++i)
+    {
+        vec2_t Size, Offset;
+        Attributes::Background Background{};
+        Attributes::Text Text{};
+        Attributes::List List{};
+
+        if(!Read(Size) || !Read(Offset) || !Read(Background.Colour) || !Read(Background.Border)) return false;
+        if(!Read(Background.Radius) || !Read(Background.Borderwidth) || !Readstring(Background.Image)) return false;
+        if(!Readstring(Text.String) || !Readstring(Text.Font) || !Read(Text.Size) || !Read(Text.Colour)) return false;
+        if(!Read(List.Count) || !Read(List.Overscan) || !Read(List.onBind) || !Read(List.isEnabled)) return false;
+
+        const auto pClass = Addclass(Properties);
+        pClass->insert_or_assign(Hash::FNV1a_32("Size"), Size);
+        pClass->insert_or_assign(Hash::FNV1a_32("Offset"), Offset);
+        pClass->insert_or_assign(Hash::FNV1a_32("Background"), Background);
+        pClass->insert_or_assign(Hash::FNV1a_32("Text"), Text);
+        pClass->insert_or_assign(Hash::FNV1a_32("List"), List);
+    }
+
+    return Buffer.empty();
+}
+
+// Ensure that the arrays are 'empty', tweens and timers point into the old nodes.
+static void Resetblueprint(Array<Element_t, Maxnodes> *Nodes, Array<Class_t, Maxclasses> *Properties, Array<Callback_t, Maxcallbacks> *Callbacks)
+{
+    Animation::Clear();
+    Timers::Clear();
+    Lists::Clear();
+    Releaseclasses(Properties);
+    Activecontext->Parsearena.Reset();
+    Nodes->Size = 0;
+    Callbacks->Size = 1;
+}
+
+// The callbacks may have changed since the blueprint was compiled, so they're resolved by name on every load.
+static void Resolvecallbacks(Array<Element_t, Maxnodes> *Nodes, const std::pmr::vector<Callbacknames_t> &Callbackhashes,
+                             Array<Callback_t, Maxcallbacks> *Callbacks)
+{
+    // Resolve a callback by name, shared between nodes.
+    Array<uint32_t, Maxcallbacks> Registered; Registered.add();
+    const auto Register = [&](uint32_t Callbackhash) -> uint8_t
+    {
+        const auto Iterator = Activecontext->Namedcallbacks.find(Callbackhash);
+        if(Iterator == Activecontext->Namedcallbacks.end()) return 0;
+
+        // Skip the dummy function.
+        for(uint32_t i = 1; i < Registered.Size; ++i)
+        {
+            if(Registered[i] == Callbackhash)
+                return i & 0xFF;
+        }
+
+        Registered.add(Callbackhash);
+        auto [i, _] = Callbacks->add(Iterator->second);
+        return i & 0xFF;
+    };
+
+    for(uint32_t i = 0; i < Nodes->Size; ++i)
+    {
+        (*Nodes)[i].onFrame = Register(Callbackhashes[i].onFrame);
+        (*Nodes)[i].onState = Register(Callbackhashes[i].onState);
+    }
+}
+
+// The XML without the layout, shared with the build-time compiler.
+// One pass over the tokens, nodes are numbered as they open so they come out depth-first.
+bool Blueprint::Readmarkup(std::string_view Filepath, Array<Element_t, Maxnodes> *Nodes, Array<::Class_t, Maxclasses> *Properties,
+                           std::pmr::vector<Callbacknames_t> *Callbackhashes, Hashmap::Flat<std::string_view> *Callbacknames)
+{
+    const auto Buffer = FS::Readfile(Filepath, &Activecontext->Framearena);
+    if(Buffer.empty()) return false;
+
+    // Class-names to indices, nodes may reference classes declared after them.
+    Hashmap::pmr::Flat<uint8_t> Classindex{ &Activecontext->Framearena };
+    struct Fixup_t { Nodeid_t Index; uint32_t Classhash; };
+    std::pmr::vector<Fixup_t> Fixups{ &Activecontext->Framearena };
+
+    // The first of each child-element wins, the rest are ignored.
+    enum Kind_t : uint8_t { Root, Class, Node, Label, onFrame, onState, Skip };
+    struct Frame_t { std::string_view Name; uint32_t Index; Kind_t Kind; uint8_t Seen; };
+    std::pmr::vector<Frame_t> Pending{ &Activecontext->Framearena };
+    Pending.push_back({ {}, 0, Root, 0 });
+
+    const auto Unescape = [](std::string_view Raw) { return XML::Unescape(Raw, &Activecontext->Framearena); };
+    const auto Callbackname = [&](std::string_view Name) -> uint32_t
+    {
+        const auto Callbackhash = Hash::FNV1a_32(Name);
+        if(Callbacknames && !Name.empty()) Callbacknames->try_emplace(Callbackhash, Activecontext->Parsearena.Copy(Name));
+        return Callbackhash;
+    };
+    const auto Openclass = [&](std::string_view Raw) -> uint32_t
+    {
+        const auto Index = Properties->Size;
+        Addclass(Properties);
+
+        XML::Attribute_t Attribute;
+        std::string_view Name{};
+        while(XML::Nextattribute(Raw, Attribute))
+            if(Attribute.Name == "Name") { Name = Unescape(Attribute.Value); break; }
+
+        Classindex[Hash::FNV1a_32(Name)] = uint8_t(Index);
+        return Index;
+    };
+    const auto Openproperty = [&](uint32_t Index, uint32_t Property, std::string_view Raw)
+    {
+        auto &Entry = (*Properties)[Index][Property];
+        XML::Attribute_t Attribute;
+
+        while(XML::Nextattribute(Raw, Attribute))
+        {
+            const auto Namehash = Hash::FNV1a_32(Attribute.Name);
+            if(Property == Hash::FNV1a_32("Size"))
+            {
+                auto &Size = std::get<vec2_t>(Entry);
+                if(Namehash == Hash::FNV1a_32("Width")) Size.x = XML::Tofloat(Attribute.Value) / 100;
+                if(Namehash == Hash::FNV1a_32("Height")) Size.y = XML::Tofloat(Attribute.Value) / 100;
+            }
+            if(Property == Hash::FNV1a_32("Offset"))
+            {
+                auto &Offset = std::get<vec2_t>(Entry);
+                if(Namehash == Hash::FNV1a_32("Left")) Offset.x = XML::Tofloat(Attribute.Value) / 100;
+                if(Namehash == Hash::FNV1a_32("Top")) Offset.y = XML::Tofloat(Attribute.Value) / 100;
+            }
+            if(Property == Hash::FNV1a_32("Background"))
+            {
+                auto &Background = std::get<Attributes::Background>(Entry);
+                switch(Namehash)
+                {
+                    case Hash::FNV1a_32("Colour"): Background.Colour = Byteswap(XML::Touint(Attribute.Value)); break;
+                    case Hash::FNV1a_32("Border"): Background.Border = Byteswap(XML::Touint(Attribute.Value)); break;
+                    case Hash::FNV1a_32("Radius"): Background.Radius = XML::Tofloat(Attribute.Value); break;
+                    case Hash::FNV1a_32("Borderwidth"): Background.Borderwidth = XML::Tofloat(Attribute.Value); break;
+                    case Hash::FNV1a_32("Image"): Background.Image = Activecontext->Parsearena.Copy(Unescape(Attribute.Value)); break;
+                }
+            }
+            if(Property == Hash::FNV1a_32("Text"))
+            {
+                auto &Text = std::get<Attributes::Text>(Entry);
+                switch(Namehash)
+                {
+                    case Hash::FNV1a_32("Font"): Text.Font = Activecontext->Parsearena.Copy(Unescape(Attribute.Value)); break;
+                    case Hash::FNV1a_32("Size"): Text.Size = XML::Tofloat(Attribute.Value); break;
+                    case Hash::FNV1a_32("Colour"): Text.Colour = Byteswap(XML::Touint(Attribute.Value)); break;
+                }
+            }
+            if(Property == Hash::FNV1a_32("List"))
+            {
+                auto &List = std::get<Attributes::List>(Entry);
+                List.isEnabled = true;
+                switch(Namehash)
+                {
+                    case Hash::FNV1a_32("Count"): List.Count = XML::Touint(Attribute.Value); break;
+                    case Hash::FNV1a_32("Overscan"): List.Overscan = XML::Touint(Attribute.Value); break;
+                    case Hash::FNV1a_32("onBind"): List.onBind = Callbackname(Unescape(Attribute.Value)); break;
+                }
+            }
+        }
+    };
+    const auto Opennode = [&](std::string_view Raw, const Frame_t &Parent) -> uint32_t
+    {
+        auto [Index, Entry] = Nodes->add();
+        Callbackhashes->push_back({ Hash::FNV1a_32(""), Hash::FNV1a_32("") });
+
+        XML::Attribute_t Attribute;
+        std::string_view Classname{};
+        while(XML::Nextattribute(Raw, Attribute))
+            if(Attribute.Name == "Class") { Classname = Unescape(Attribute.Value); break; }
+
+        const auto Classhash = Hash::FNV1a_32(Classname);
+        if(const auto Iterator = Classindex.find(Classhash); Iterator != Classindex.end()) Entry->StyleID = Iterator->second;
+        else Fixups.push_back({ Nodeid_t(Index), Classhash });
+
+        if(Parent.Kind == Node)
+        {
+            const auto pParent = &(*Nodes)[Parent.Index];
+            if(!pParent->Child_1) pParent->Child_1 = Index;
+            else if(!pParent->Child_2) pParent->Child_2 = Index;
+            else if(!pParent->Child_3) pParent->Child_3 = Index;
+            else if(!pParent->Child_4) pParent->Child_4 = Index;
+            else assert(false);
+        }
+
+        return Index;
+    };
+
+    const auto Error = [&](const char *Reason)
+    {
+        Logging::Print('E', va("Could not read %.*s: %s", int(Filepath.size()), Filepath.data(), Reason));
+        return false;
+    };
+
+    XML::Reader_t Reader({ (const char *)Buffer.data(), Buffer.size() });
+    while(true)
+    {
+        const auto Token = Reader.Next();
+        if(Token.Kind == XML::Token_t::Malformed) return Error("malformed markup");
+        if(Token.Kind == XML::Token_t::End) break;
+
+        if(Token.Kind == XML::Token_t::Close)
+        {
+            if(Pending.size() == 1 || Pending.back().Name != Token.Name) return Error("mismatched closing tag");
+            Pending.pop_back();
+            continue;
+        }
+
+        // Only the first non-blank text of a label or callback counts.
+        auto &Parent = Pending.back();
+        if(Token.Kind == XML::Token_t::Text)
+        {
+            if(Parent.Seen || (Parent.Kind != Label && Parent.Kind != onFrame && Parent.Kind != onState)) continue;
+            if(Token.isEscaped && XML::Reader_t::Trim(Token.Content).empty()) continue;
+
+            const auto Value = Token.isEscaped ? Unescape(Token.Content) : Token.Content;
+            if(Parent.Kind == Label) std::get<Attributes::Text>((*Properties)[Parent.Index][Hash::FNV1a_32("Text")]).String = Activecontext->Parsearena.Copy(Value);
+            if(Parent.Kind == onFrame) (*Callbackhashes)[Parent.Index].onFrame = Callbackname(Value);
+            if(Parent.Kind == onState) (*Callbackhashes)[Parent.Index].onState = Callbackname(Value);
+            Parent.Seen = 1;
+            continue;
+        }
+
+        Frame_t Frame{ Token.Name, 0, Skip, 0 };
+        const auto Namehash = Hash::FNV1a_32(Token.Name);
+
+        // The arrays only assert on overflow, so check before adding anything.
+        if(Namehash == Hash::FNV1a_32("Node") && (Parent.Kind == Root || Parent.Kind == Node))
+        {
+            if(Nodes->Size == Maxnodes) return Error("too many nodes");
+            if(Parent.Kind == Node && (*Nodes)[Parent.Index].Child_4) return Error("a node can only have four children");
+        }
+        if(Namehash == Hash::FNV1a_32("Class") && Parent.Kind == Root && Properties->Size == Maxclasses) return Error("too many classes");
+        if(Parent.Kind == Root)
+        {
+            if(Namehash == Hash::FNV1a_32("Class")) Frame = { Token.Name, Openclass(Token.Content), Class, 0 };
+            if(Namehash == Hash::FNV1a_32("Node")) Frame = { Token.Name, Opennode(Token.Content, Parent), Node, 0 };
+        }
+        else if(Parent.Kind == Class)
+        {
+            const uint8_t Bit = Namehash == Hash::FNV1a_32("Size") ? 1 : Namehash == Hash::FNV1a_32("Offset") ? 2 :
+                                Namehash == Hash::FNV1a_32("Background") ? 4 : Namehash == Hash::FNV1a_32("Text") ? 8 :
+                                Namehash == Hash::FNV1a_32("List") ? 16 : 0;
+            if(Bit && !(Parent.Seen & Bit))
+            {
+                Parent.Seen |= Bit;
+                Openproperty(Parent.Index, Namehash, Token.Content);
+                if(Bit == 8) Frame = { Token.Name, Parent.Index, Label, 0 };
+            }
+        }
+        else if(Parent.Kind == Node)
+        {
+            const uint8_t Bit = Namehash == Hash::FNV1a_32("onFrame") ? 1 : Namehash == Hash::FNV1a_32("onState") ? 2 : 0;
+            if(Namehash == Hash::FNV1a_32("Node")) Frame = { Token.Name, Opennode(Token.Content, Parent), Node, 0 };
+            else if(Bit && !(Parent.Seen & Bit))
+            {
+                Parent.Seen |= Bit;
+                Frame = { Token.Name, Parent.Index, Bit == 1 ? onFrame : onState, 0 };
+            }
+        }
+
+        // Elements without content still count, but there's nothing to close.
+        if(!Token.isSelfclosing) Pending.push_back(Frame);
+    }
+
+    // Unknown classes fall back to the first one.
+    for(const auto &[Index, Classhash] : Fixups)
+    {
+        const auto Iterator = Classindex.find(Classhash);
+        (*Nodes)[Index].StyleID = Iterator == Classindex.end() ? 0 : Iterator->second;
+    }
+
+    if(Pending.size() != 1) return Error("unclosed tag");
+    return true;
+}
+
+// Parse the markup into arrays.
+bool Parseblueprint(vec4_t Boundingbox, std::string_view Filepath, Array<Element_t, Maxnodes> *Nodes,
+                    Array<Class_t, Maxclasses> *Properties, Array<Callback_t, Maxcallbacks> *Callbacks)
+{
+    // Callback names per node.
+    std::pmr::vector<Callbacknames_t> Callbackhashes{ &Activecontext->Framearena };
+    Resetblueprint(Nodes, Properties, Callbacks);
+
+    // Second launch and onwards should not need to touch the XML.
+    const auto Cached = Assetcache::Load(Filepath, Blueprintkind, &Activecontext->Framearena);
+    if(Cached.empty() || !Deserializeblueprint(Cached, Nodes, Properties, &Callbackhashes))
+    {
+        Releaseclasses(Properties);
+        Activecontext->Parsearena.Reset();
+        Nodes->Size = 0;
+        Callbackhashes.clear();
+
+        if(!Blueprint::Readmarkup(Filepath, Nodes, Properties, &Callbackhashes)) return false;
+        Assetcache::Store(Filepath, Blueprintkind, Serializeblueprint(*Nodes, *Properties, Callbackhashes));
+    }
+
+    Resolvecallbacks(Nodes, Callbackhashes, Callbacks);
+    if(!Lists::Build(Nodes, Properties)) return false;
+    Layoutnodes(Boundingbox, Nodes, Properties);
+    return true;
+}
+
+// The tables are already in the array-layout, so this is just copies.
+bool Loadblueprint(vec4_t Boundingbox, const Blueprint::Compiled_t &Compiled, Array<Element_t, Maxnodes> *Nodes,
+                   Array<Class_t, Maxclasses> *Properties, Array<Callback_t, Maxcallbacks> *Callbacks)
+{
+    if(Compiled.Nodes.size() > Maxnodes || Compiled.Styles.size() > Maxclasses) return false;
+
+    std::pmr::vector<Callbacknames_t> Callbackhashes{ &Activecontext->Framearena };
+    Callbackhashes.reserve(Compiled.Nodes.size());
+    Resetblueprint(Nodes, Properties, Callbacks);
+
+    for(const auto &Style : Compiled.Styles)
+    {
+        const auto pClass = Addclass(Properties);
+        pClass->insert_or_assign(Hash::FNV1a_32("Size"), Style.Size);
+        pClass->insert_or_assign(Hash::FNV1a_32("Offset"), Style.Offset);
+        pClass->insert_or_assign(Hash::FNV1a_32("Background"), Style.Background);
+        pClass->insert_or_assign(Hash::FNV1a_32("Text"), Style.Text);
+        pClass->insert_or_assign(Hash::FNV1a_32("List"), Style.List);
+    }
+
+    for(const auto &Node : Compiled.Nodes)
+    {
+        auto [_, Entry] = Nodes->add();
+        Entry->Child_1 = Node.Child_1; Entry->Child_2 = Node.Child_2;
+        Entry->Child_3 = Node.Child_3; Entry->Child_4 = Node.Child_4;
+        Entry->StyleID = Node.StyleID;
+        Callbackhashes.push_back(Node.Callbacks);
+    }
+
+    Resolvecallbacks(Nodes, Callbackhashes, Callbacks);
+    if(!Lists::Build(Nodes, Properties)) return false;
+    Layoutnodes(Boundingbox, Nodes, Properties);
+    return true;
+}
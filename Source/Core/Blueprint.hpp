@@ -0,0 +1,36 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-08
+    License: MIT
+*/
+
+#pragma once
+#include <Stdinclude.hpp>
+#include <span>
+
+// Blueprints compiled at build-time, see Tools/Blueprintcompiler.cpp; layout and callbacks are still resolved on load.
+namespace Blueprint
+{
+    struct Callbacknames_t { uint32_t onFrame, onState; };
+    struct Node_t { Nodeid_t Child_1, Child_2, Child_3, Child_4; uint8_t StyleID; Callbacknames_t Callbacks; };
+    struct Style_t { vec2_t Size, Offset; Attributes::Background Background; Attributes::Text Text; Attributes::List List; };
+    struct Compiled_t { std::span<const Node_t> Nodes; std::span<const Style_t> Styles; };
+
+    // The generated headers check the names they use against the including file's set.
+    template<size_t N> constexpr bool isRegistered(const std::array<uint32_t, N> &Registered, uint32_t Callbackhash)
+    {
+        for(const auto Hash : Registered) if(Hash == Callbackhash) return true;
+        return false;
+    }
+
+    // The markup before layout and callback-resolution, names are copied to the parse-arena if requested.
+    bool Readmarkup(std::string_view Filepath, Array<Element_t, Maxnodes> *Nodes, Array<Class_t, Maxclasses> *Properties,
+                    std::pmr::vector<Callbacknames_t> *Callbackhashes, Hashmap::Flat<std::string_view> *Callbacknames = nullptr);
+}
+
+// Fill the arrays from a compiled blueprint, no I/O or parsing.
+bool Loadblueprint(vec4_t Boundingbox,
+                   const Blueprint::Compiled_t &Compiled,
+                   Array<Element_t, Maxnodes> *Nodes,
+                   Array<Class_t, Maxclasses> *Properties,
+                   Array<Callback_t, Maxcallbacks> *Callbacks);
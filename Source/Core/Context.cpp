@@ -0,0 +1,25 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-01
+    License: MIT
+*/
+
+#include <Stdinclude.hpp>
+
+thread_local Context_t *Activecontext{};
+
+Context_t::Bind_t::Bind_t(Context_t &Context) : Previous(std::exchange(Activecontext, &Context)) {}
+Context_t::Bind_t::~Bind_t() { Activecontext = Previous; }
+
+// Only reallocated if it outgrows the capacity or shrinks to a quarter of it.
+void Context_t::Resizesurface(point2_t Size)
+{
+    const auto Required = size_t(Size.x) * Size.y;
+    if(Required > Pixelcapacity || Required < Pixelcapacity / 4)
+    {
+        Pixelcapacity = Required + Required / 2;
+        Pixels = std::make_unique<uint32_t[]>(Pixelcapacity);
+    }
+
+    Surface = { Pixels.get(), Size.x, Size.y };
+}
@@ -0,0 +1,105 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-01
+    License: MIT
+*/
+
+#include <Stdinclude.hpp>
+#include <Core/Traversal.hpp>
+#include <Core/Lists.hpp>
+
+// Hovered is the nodes under the pointer after the context's last event, topmost first; a move only has to look at these and the new ones.
+// The rest is scratch kept between events, so after the first few an event doesn't allocate.
+struct Inputstate_t { std::vector<Nodeid_t> Hovered, Pending, Hit, Sorted; };
+static Inputstate_t &State() { return Modulestate<Inputstate_t>(Activecontext->Modules.Input); }
+
+// The click-bits of Elementstate_t.
+constexpr uint8_t Buttonmask = 0b1110;
+
+// Get input and other such interrupts.
+#if defined(HAS_COMPACTGEOMETRY)
+inline bool Hittest(point2_t Point, const Area_t &Area)
+{
+    // Compared in fixed-point, so there's nothing to convert.
+    const int32_t x = int32_t(Point.x) * (1 << Fixedpoint::Fractionbits), y = int32_t(Point.y) * (1 << Fixedpoint::Fractionbits);
+    return x >= Area.Packed.x0 && x <= Area.Packed.x1 && y >= Area.Packed.y0 && y <= Area.Packed.y1;
+}
+#else
+inline bool Hittest(point2_t Point, const vec4_t &Area)
+{
+    return Point.x >= Area.x0 && Point.x <= Area.x1 && Point.y >= Area.y0 && Point.y <= Area.y1;
+}
+#endif
+void Processinput(const Mouseinput_t &Input, Array<Element_t, Maxnodes> &Nodetree, Array<Callback_t, Maxcallbacks> &Callbacks)
+{
+    auto &[Hovered, Pending, Hit, Sorted] = State();
+
+    // A node can only be hit if its parent is, so only hit subtrees are descended into.
+    // Later children are pushed last and popped first, so the reverse of this is children before parents and topmost first.
+    const auto Collecthits = [&]()
+    {
+        Hit.clear();
+        if(Nodetree.Size && Hittest(Input.Position, Nodetree[0].Area)) Pending.push_back(0);
+        while(!Pending.empty())
+        {
+            const auto Index = Pending.back();
+            Pending.pop_back();
+            Hit.push_back(Index);
+
+            const auto Slots = Traversal::Children(Nodetree[Index]);
+            for(auto Slot = Slots.rbegin(); Slot != Slots.rend(); ++Slot)
+                if(*Slot && Hittest(Input.Position, Nodetree[*Slot].Area)) Pending.push_back(*Slot);
+        }
+    };
+    Collecthits();
+
+    // Innermost first, a list at either end passes it outwards; the items moved, so what's under the pointer is found again.
+    if(Input.Wheel)
+    {
+        for(size_t i = Hit.size(); i-- > 0;)
+        {
+            if(Lists::Scroll(Nodetree, Hit[i], -Input.Wheel * Lists::Wheelstep))
+            {
+                Collecthits();
+                break;
+            }
+        }
+    }
+
+    // Rarely more than a path through the tree, so sorting beats a per-node flag that would need clearing.
+    Sorted.assign(Hit.begin(), Hit.end());
+    std::sort(Sorted.begin(), Sorted.end());
+
+    // Left since the last event, a press doesn't survive the pointer leaving.
+    // Entries from before a rebuild are skipped as the new nodes aren't hovered.
+    for(const auto Index : Hovered)
+    {
+        if(Index >= Nodetree.Size || std::binary_search(Sorted.begin(), Sorted.end(), Index)) continue;
+
+        auto &Node = Nodetree[Index];
+        if(!Node.State.isHoveredover) continue;
+
+        Elementstate_t Copy{};
+        if(Node.onState) Callbacks[Node.onState](Node, &Copy);
+        Node.State = Copy;
+    }
+
+    // Only actual transitions are dispatched, topmost first; once an element consumes the event the ones below still update but aren't told.
+    bool isConsumed{};
+    Hovered.clear();
+    for(size_t i = Hit.size(); i-- > 0;)
+    {
+        const auto Index = Hit[i];
+        auto &Node = Nodetree[Index];
+        Hovered.push_back(Index);
+
+        auto Copy = Node.State;
+        Copy.isHoveredover = true;
+        Copy.Raw |= Input.Pressed.Raw & Buttonmask;
+        Copy.Raw &= ~(Input.Released.Raw & Buttonmask);
+        if(Copy.Raw == Node.State.Raw) continue;
+
+        if(Node.onState && !isConsumed) isConsumed = Callbacks[Node.onState](Node, &Copy);
+        Node.State = Copy;
+    }
+}
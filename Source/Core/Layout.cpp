@@ -0,0 +1,77 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-01
+    License: MIT
+*/
+
+#include <Stdinclude.hpp>
+#include <Core/Traversal.hpp>
+#include <Core/Lists.hpp>
+
+// The context's last layout in a unit bounding box, areas are linear in the box so a resize only needs to rescale these.
+static std::vector<vec4_t> &Unitareas() { return Modulestate<std::vector<vec4_t>>(Activecontext->Modules.Layout); }
+
+// Calculate the dimensions of the items, parents are resolved before their children.
+void Layoutnodes(vec4_t Boundingbox, Array<Element_t, Maxnodes> *Nodes, Array<Class_t, Maxclasses> *Properties)
+{
+    // Resolve the classes once rather than per node, missing attributes are zero.
+    struct Resolved_t { vec2_t Size, Offset; };
+    std::array<Resolved_t, Maxclasses> Resolved{};
+    for(uint32_t i = 0; i < Properties->Size; ++i)
+    {
+        const auto &Attributes = (*Properties)[i];
+        const auto Size = Attributes.find(Hash::FNV1a_32("Size"));
+        const auto Offset = Attributes.find(Hash::FNV1a_32("Offset"));
+
+        if(Size != Attributes.end()) Resolved[i].Size = std::get<vec2_t>(Size->second);
+        if(Offset != Attributes.end()) Resolved[i].Offset = std::get<vec2_t>(Offset->second);
+    }
+
+    auto &Unitareas = ::Unitareas();
+    Unitareas.assign(Nodes->Size, vec4_t{});
+    for(const auto [Piviot, Parent] : Traversal::Preorder(*Nodes))
+    {
+        const auto Box = Parent == Traversal::None ? vec4_t{ 0.0f, 0.0f, 1.0f, 1.0f } : Unitareas[Parent];
+        const auto Width = Box.x1 - Box.x0;
+        const auto Height = Box.y1 - Box.y0;
+        const auto &[Size, Offset] = Resolved[(*Nodes)[Piviot].StyleID];
+
+        const auto x0 = Box.x0 + Width * Offset.x;
+        const auto y0 = Box.y0 + Height * Offset.y;
+        Unitareas[Piviot] = { x0, y0, x0 + Width * Size.x, y0 + Height * Size.y };
+    }
+
+    Relayoutnodes(Boundingbox, Nodes, Properties);
+}
+
+// Only the bounding box changed, so it's a scale and offset per node without touching the classes or the tree.
+void Relayoutnodes(vec4_t Boundingbox, Array<Element_t, Maxnodes> *Nodes, Array<Class_t, Maxclasses> *Properties)
+{
+    // Another node-store was laid out since.
+    const auto &Unitareas = ::Unitareas();
+    if(Unitareas.size() != Nodes->Size) return Layoutnodes(Boundingbox, Nodes, Properties);
+
+    const auto Width = Boundingbox.x1 - Boundingbox.x0;
+    const auto Height = Boundingbox.y1 - Boundingbox.y0;
+
+    // Packed straight from the registers, going through a vec4_t per node costs more than the layout itself.
+    #if defined(HAS_COMPACTGEOMETRY) && defined(HAS_SSE2)
+    const auto Origin = _mm_setr_ps(Boundingbox.x0, Boundingbox.y0, Boundingbox.x0, Boundingbox.y0);
+    const auto Extent = _mm_setr_ps(Width, Height, Width, Height);
+    for(uint32_t i = 0; i < Nodes->Size; ++i)
+    {
+        const auto Area = _mm_add_ps(Origin, _mm_mul_ps(Extent, _mm_loadu_ps(Unitareas[i].Raw)));
+        _mm_storel_epi64((__m128i *)(*Nodes)[i].Area.Packed.Raw, Fixedpoint::Pack(Area));
+    }
+    #else
+    for(uint32_t i = 0; i < Nodes->Size; ++i)
+    {
+        const auto &Unit = Unitareas[i];
+        (*Nodes)[i].Area = vec4_t{ Boundingbox.x0 + Width * Unit.x0, Boundingbox.y0 + Height * Unit.y0,
+                                   Boundingbox.x0 + Width * Unit.x1, Boundingbox.y0 + Height * Unit.y1 };
+    }
+    #endif
+
+    // Pooled items depend on the scroll-position rather than just the box.
+    Lists::Layout(*Nodes);
+}
@@ -0,0 +1,265 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-16
+    License: MIT
+*/
+
+#include <Stdinclude.hpp>
+#include <Core/Lists.hpp>
+#include <Core/Traversal.hpp>
+#include <Utilities/Logging.hpp>
+
+// Shared with the blueprint, every attribute starts out empty.
+Class_t *Addclass(Array<Class_t, Maxclasses> *Properties);
+
+namespace Lists
+{
+    constexpr uint32_t Unbound = UINT32_MAX;
+
+    // The template in pre-order, so a node's parent is always placed before it.
+    struct Templatenode_t { uint32_t Parent; vec2_t Size, Offset; };
+
+    // Slot k is a wrapper followed by a copy of the template, at First + k * Slotsize.
+    // Wrappers cover the list and chain the slots through Child_2, so there's no limit of four children.
+    struct List_t
+    {
+        Nodeid_t Node, First;
+        const Element_t *Pool;
+        uint32_t Slotsize, Poolsize;
+        uint32_t Count, Overscan, onBind;
+        float Pitch, Scroll;
+        std::pmr::vector<Templatenode_t> Template{ &Activecontext->Parsearena };
+        std::pmr::vector<uint32_t> Items{ &Activecontext->Parsearena };
+    };
+
+    // Per context, as the pools live in its node-store; the lists' own arrays are in the parse-arena with the blueprint.
+    struct State_t { std::vector<List_t> Lists; std::vector<Nodeid_t> Containers; std::vector<vec4_t> Scratch; };
+    static State_t &State() { return Modulestate<State_t>(Activecontext->Modules.Lists); }
+
+    static List_t *Find(Nodeid_t Node)
+    {
+        for(auto &List : State().Lists) if(List.Node == Node) return &List;
+        return nullptr;
+    }
+
+    // Items that fit in the list, the last one may only be partly visible.
+    inline float Visible(const List_t &List) { return 1.0f / List.Pitch; }
+    inline float Limit(const List_t &List) { return std::max(float(List.Count) - Visible(List), 0.0f); }
+
+    // Bind the visible range to the slots and lay them out, the cost is the pool's size whatever the item-count.
+    static void Place(Array<Element_t, Maxnodes> &Nodes, List_t &List)
+    {
+        const vec4_t Area = Nodes[List.Node].Area;
+        const auto Width = Area.x1 - Area.x0, Height = Area.y1 - Area.y0;
+
+        const auto Firstitem = uint32_t(std::max(int64_t(std::floor(List.Scroll)) - int64_t(List.Overscan), int64_t(0)));
+        const auto Lastitem = uint32_t(std::min(int64_t(std::ceil(List.Scroll + Visible(List))) + List.Overscan, int64_t(List.Count)));
+
+        auto &Scratch = State().Scratch;
+        Scratch.resize(List.Template.size());
+
+        for(uint32_t Slot = 0; Slot < List.Poolsize; ++Slot)
+        {
+            // Items go to the slot of their index modulo the pool, so the ones still visible keep theirs.
+            const auto Wrapper = List.First + Slot * List.Slotsize;
+            const auto Item = Firstitem + (Slot + List.Poolsize - Firstitem % List.Poolsize) % List.Poolsize;
+
+            // Unbound wrappers still chain the slots after them, so they need the area to be descended into.
+            Nodes[Wrapper].Area = Area;
+            if(Item >= Lastitem)
+            {
+                Nodes[Wrapper].Child_1 = 0;
+                List.Items[Slot] = Unbound;
+                continue;
+            }
+
+            Nodes[Wrapper].Child_1 = Wrapper + 1;
+
+            // The list's area moved down by whole items, then the same rules as Layoutnodes.
+            const auto Shift = Height * (float(Item) - List.Scroll) * List.Pitch;
+            for(uint32_t i = 0; i < List.Template.size(); ++i)
+            {
+                const auto &[Parent, Size, Offset] = List.Template[i];
+                const auto Box = Parent == Traversal::None ? vec4_t{ Area.x0, Area.y0 + Shift, Area.x1, Area.y1 + Shift } : Scratch[Parent];
+                const auto Boxwidth = Parent == Traversal::None ? Width : Box.x1 - Box.x0;
+                const auto Boxheight = Parent == Traversal::None ? Height : Box.y1 - Box.y0;
+
+                const auto x0 = Box.x0 + Boxwidth * Offset.x;
+                const auto y0 = Box.y0 + Boxheight * Offset.y;
+                Scratch[i] = { x0, y0, x0 + Boxwidth * Size.x, y0 + Boxheight * Size.y };
+                Nodes[Wrapper + 1 + i].Area = Scratch[i];
+            }
+
+            // A recycled copy starts over, whoever provides the content is told which item it shows now.
+            if(List.Items[Slot] != Item)
+            {
+                List.Items[Slot] = Item;
+                for(uint32_t i = 0; i < List.Template.size(); ++i) Nodes[Wrapper + 1 + i].State = {};
+
+                const auto Callback = Activecontext->Namedcallbacks.find(List.onBind);
+                if(List.onBind && Callback != Activecontext->Namedcallbacks.end()) Callback->second(Nodes[Wrapper + 1], &Item);
+            }
+        }
+    }
+
+    // Replace the templates with their pools, after the callbacks are resolved and before the layout.
+    bool Build(Array<Element_t, Maxnodes> *Nodes, Array<Class_t, Maxclasses> *Properties)
+    {
+        auto &[Lists, Containers, Scratch] = State();
+        Lists.clear();
+        Containers.clear();
+
+        const auto Resolve = [&](uint8_t StyleID, uint32_t Property) -> const Attribute_t *
+        {
+            const auto Iterator = (*Properties)[StyleID].find(Property);
+            return Iterator == (*Properties)[StyleID].end() ? nullptr : &Iterator->second;
+        };
+
+        // Lists inside a template would need a pool per copy, so they're just copied as a plain node.
+        const auto Originalcount = Nodes->Size;
+        std::pmr::vector<bool> isTemplate(Originalcount, false, &Activecontext->Framearena);
+        uint8_t Emptyclass{};
+
+        for(Nodeid_t Index = 0; Index < Originalcount; ++Index)
+        {
+            const auto Attribute = Resolve((*Nodes)[Index].StyleID, Hash::FNV1a_32("List"));
+            if(isTemplate[Index] || !Attribute || !std::get<Attributes::List>(*Attribute).isEnabled) continue;
+
+            const auto Templateroot = (*Nodes)[Index].Child_1;
+            if(!Templateroot) continue;
+
+            // Template-nodes with the position of their parent, in pre-order.
+            std::pmr::vector<Nodeid_t> Ids{ &Activecontext->Framearena };
+            List_t List{};
+            List.Node = Index;
+            for(const auto [Node, Parent] : Traversal::Preorder(*Nodes, Templateroot))
+            {
+                const auto Size = Resolve((*Nodes)[Node].StyleID, Hash::FNV1a_32("Size"));
+                const auto Offset = Resolve((*Nodes)[Node].StyleID, Hash::FNV1a_32("Offset"));
+                const auto Position = Parent == Traversal::None ? Traversal::None : uint32_t(std::find(Ids.begin(), Ids.end(), Parent) - Ids.begin());
+
+                Ids.push_back(Node);
+                List.Template.push_back({ Position, Size ? std::get<vec2_t>(*Size) : vec2_t{}, Offset ? std::get<vec2_t>(*Offset) : vec2_t{} });
+            }
+
+            // Items are stacked with the template's top offset as the gap, an item that takes no space can't be scrolled.
+            List.Pitch = List.Template[0].Offset.y + List.Template[0].Size.y;
+            const auto &Declaration = std::get<Attributes::List>(*Attribute);
+            List.Count = Declaration.Count;
+            List.Overscan = Declaration.Overscan;
+            List.onBind = Declaration.onBind;
+            List.Slotsize = uint32_t(Ids.size()) + 1;
+            List.Poolsize = List.Pitch > 0.0f ? uint32_t(std::ceil(Visible(List))) + 1 + 2 * List.Overscan : 0;
+            if(!List.Poolsize) continue;
+
+            // A list that doesn't fit is an error like any other overflowing markup, rather than a template drawn once.
+            if(Nodes->Size + uint64_t(List.Poolsize) * List.Slotsize > Maxnodes)
+            {
+                Logging::Print('E', va("The list at node %u needs a pool of %llu nodes, more than the node-store has left", Index, static_cast<unsigned long long>(uint64_t(List.Poolsize) * List.Slotsize)));
+                return false;
+            }
+
+            // The wrappers are only there for the tree's sake, so their class draws nothing.
+            if(!Emptyclass)
+            {
+                if(Properties->Size == Maxclasses)
+                {
+                    Logging::Print('E', va("The list at node %u has no room for its wrappers' class", Index));
+                    return false;
+                }
+                Emptyclass = uint8_t(Properties->Size);
+                Addclass(Properties);
+            }
+
+            List.First = Nodes->Size;
+            for(uint32_t Slot = 0; Slot < List.Poolsize; ++Slot)
+            {
+                const auto Wrapper = Nodes->Size;
+                auto [_, pWrapper] = Nodes->add();
+                pWrapper->StyleID = Emptyclass;
+                pWrapper->Child_2 = Slot + 1 < List.Poolsize ? Wrapper + List.Slotsize : 0;
+
+                for(const auto Id : Ids)
+                {
+                    auto [__, pCopy] = Nodes->add((*Nodes)[Id]);
+                    for(auto pChild : { &pCopy->Child_1, &pCopy->Child_2, &pCopy->Child_3, &pCopy->Child_4 })
+                        if(*pChild) *pChild = Wrapper + 1 + uint32_t(std::find(Ids.begin(), Ids.end(), *pChild) - Ids.begin());
+                }
+            }
+
+            // The template stays in the store but is unreachable, and mustn't get any callbacks.
+            for(const auto Id : Ids)
+            {
+                isTemplate[Id] = true;
+                (*Nodes)[Id].onFrame = (*Nodes)[Id].onState = 0;
+            }
+
+            (*Nodes)[Index].Child_1 = List.First;
+            List.Pool = &(*Nodes)[List.First];
+            List.Items.assign(List.Poolsize, Unbound);
+            Containers.push_back(Index);
+            Lists.push_back(std::move(List));
+        }
+
+        return true;
+    }
+
+    // Place the visible items over their lists' areas, the layout calls this after every pass.
+    void Layout(Array<Element_t, Maxnodes> &Nodes)
+    {
+        for(auto &List : State().Lists) Place(Nodes, List);
+    }
+
+    // In items, clamped so the last item stays at the bottom.
+    bool Scroll(Array<Element_t, Maxnodes> &Nodes, Nodeid_t Node, float Items, bool isRelative)
+    {
+        const auto List = Find(Node);
+        if(!List) return false;
+
+        const auto Target = std::clamp(isRelative ? List->Scroll + Items : Items, 0.0f, Limit(*List));
+        if(Target == List->Scroll) return false;
+
+        List->Scroll = Target;
+        Place(Nodes, *List);
+        Activecontext->isDirty = true;
+        return true;
+    }
+
+    // Every visible copy is re-bound, as a new count usually means new content.
+    void Setcount(Array<Element_t, Maxnodes> &Nodes, Nodeid_t Node, uint32_t Count)
+    {
+        const auto List = Find(Node);
+        if(!List) return;
+
+        List->Count = Count;
+        List->Scroll = std::clamp(List->Scroll, 0.0f, Limit(*List));
+        List->Items.assign(List->Poolsize, Unbound);
+        Place(Nodes, *List);
+        Activecontext->isDirty = true;
+    }
+
+    // The item a pooled node currently shows, UINT32_MAX for anything else.
+    uint32_t Itemindex(const Element_t &Node)
+    {
+        for(const auto &List : State().Lists)
+        {
+            const auto End = List.Pool + List.Poolsize * List.Slotsize;
+            if(std::less<const Element_t *>()(&Node, List.Pool) || !std::less<const Element_t *>()(&Node, End)) continue;
+
+            // Wrappers aren't part of an item.
+            const auto Offset = uint32_t(&Node - List.Pool);
+            return Offset % List.Slotsize ? List.Items[Offset / List.Slotsize] : Unbound;
+        }
+
+        return Unbound;
+    }
+
+    std::span<const Nodeid_t> Containers() { return State().Containers; }
+
+    // The node-store is being rebuilt, so every pool is stale.
+    void Clear()
+    {
+        State().Lists.clear();
+        State().Containers.clear();
+    }
+}
@@ -0,0 +1,37 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-16
+    License: MIT
+*/
+
+#pragma once
+#include <Stdinclude.hpp>
+#include <span>
+
+// Virtualized lists, see Attributes::List; the first child is the item-template and a pool of copies is recycled while scrolling.
+// The pool is sized by how many items fit in the list, so memory and per-frame cost don't depend on the item-count.
+namespace Lists
+{
+    // Items per notch of the wheel.
+    constexpr float Wheelstep = 3.0f;
+
+    // Replace the templates with their pools, after the callbacks are resolved and before the layout.
+    // False if a pool or its class doesn't fit, the tree is then only partly built.
+    bool Build(Array<Element_t, Maxnodes> *Nodes, Array<Class_t, Maxclasses> *Properties);
+
+    // Place the visible items over their lists' areas, the layout calls this after every pass.
+    void Layout(Array<Element_t, Maxnodes> &Nodes);
+
+    // In items, clamped so the last item stays at the bottom; returns false if the node isn't a list or the view didn't move.
+    bool Scroll(Array<Element_t, Maxnodes> &Nodes, Nodeid_t List, float Items, bool isRelative = true);
+    void Setcount(Array<Element_t, Maxnodes> &Nodes, Nodeid_t List, uint32_t Count);
+
+    // The item a pooled node currently shows, UINT32_MAX for anything else.
+    uint32_t Itemindex(const Element_t &Node);
+
+    // The list-nodes in ascending order, the renderer clips their contents.
+    std::span<const Nodeid_t> Containers();
+
+    // The node-store is being rebuilt, so every pool is stale.
+    void Clear();
+}
@@ -0,0 +1,280 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-03
+    License: MIT
+*/
+
+#pragma once
+#include <Stdinclude.hpp>
+
+// Scanline rasterizer with analytic coverage, all blending rounds the same way so the SIMD path is bit-exact.
+namespace Rasterizer
+{
+    // x * y / 255, correctly rounded for x, y <= 255.
+    inline uint32_t Multiply(uint32_t x, uint32_t y)
+    {
+        const uint32_t t = x * y + 0x80;
+        return (t + (t >> 8)) >> 8;
+    }
+
+    // Source-over blending of ARGB, two channels at a time.
+    inline uint32_t Blend(uint32_t Destination, uint32_t Source)
+    {
+        const uint32_t Alpha = Source >> 24;
+        const uint32_t Inverse = 0xFF - Alpha;
+        const uint32_t Opaque = Source | 0xFF000000;
+
+        const auto Lerp = [&](uint32_t S, uint32_t D)
+        {
+            const uint32_t t = S * Alpha + D * Inverse + 0x800080;
+            return ((t + ((t >> 8) & 0xFF00FF)) >> 8) & 0xFF00FF;
+        };
+
+        return Lerp(Opaque & 0xFF00FF, Destination & 0xFF00FF) | (Lerp((Opaque >> 8) & 0xFF00FF, (Destination >> 8) & 0xFF00FF) << 8);
+    }
+
+    // Source-over for premultiplied pixels, which is what Blend produces when drawing on a transparent surface.
+    inline uint32_t Composite(uint32_t Destination, uint32_t Source)
+    {
+        const uint32_t Inverse = 0xFF - (Source >> 24);
+
+        const auto Scale = [&](uint32_t D)
+        {
+            const uint32_t t = D * Inverse + 0x800080;
+            return ((t + ((t >> 8) & 0xFF00FF)) >> 8) & 0xFF00FF;
+        };
+
+        return Source + (Scale(Destination & 0xFF00FF) | (Scale((Destination >> 8) & 0xFF00FF) << 8));
+    }
+
+    #if defined(HAS_SSE2)
+    namespace Internal
+    {
+        // (x + 0x80 + ((x + 0x80) >> 8)) >> 8 per 16-bit lane, i.e. Multiply without the products.
+        inline __m128i Divide255(__m128i x)
+        {
+            x = _mm_add_epi16(x, _mm_set1_epi16(0x80));
+            return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+        }
+
+        // Two pixels widened to 16-bit lanes, with the alpha per channel.
+        inline __m128i Lerp(__m128i Source, __m128i Destination, __m128i Alpha)
+        {
+            const auto Inverse = _mm_sub_epi16(_mm_set1_epi16(0xFF), Alpha);
+            return Divide255(_mm_add_epi16(_mm_mullo_epi16(Source, Alpha), _mm_mullo_epi16(Destination, Inverse)));
+        }
+    }
+    #endif
+
+    // Blend a colour scaled by per-pixel coverage, four pixels at a time where possible.
+    inline void Blendspan(uint32_t *Row, const uint8_t *Coverage, int32_t Length, uint32_t Colour)
+    {
+        const uint32_t Alpha = Colour >> 24;
+        int32_t i = 0;
+
+        #if defined(HAS_SSE2)
+        const auto Zero = _mm_setzero_si128();
+        const auto Source = _mm_unpacklo_epi8(_mm_set1_epi32(int(Colour | 0xFF000000)), Zero);
+        const auto Colouralpha = _mm_set1_epi16(int16_t(Alpha));
+
+        for(; i + 4 <= Length; i += 4)
+        {
+            uint32_t Quad;
+            std::memcpy(&Quad, Coverage + i, sizeof(Quad));
+            if(Quad == 0) continue;
+
+            if(Quad == 0xFFFFFFFF && Alpha == 0xFF)
+            {
+                _mm_storeu_si128((__m128i *)(Row + i), _mm_set1_epi32(int(Colour)));
+                continue;
+            }
+
+            // Each coverage byte repeated for the four channels of its pixel.
+            auto Spread = _mm_cvtsi32_si128(int(Quad));
+            Spread = _mm_unpacklo_epi8(Spread, Spread);
+            Spread = _mm_unpacklo_epi16(Spread, Spread);
+
+            const auto Low = Internal::Divide255(_mm_mullo_epi16(_mm_unpacklo_epi8(Spread, Zero), Colouralpha));
+            const auto High = Internal::Divide255(_mm_mullo_epi16(_mm_unpackhi_epi8(Spread, Zero), Colouralpha));
+
+            const auto Destination = _mm_loadu_si128((const __m128i *)(Row + i));
+            const auto Result = _mm_packus_epi16(Internal::Lerp(Source, _mm_unpacklo_epi8(Destination, Zero), Low),
+                                                 Internal::Lerp(Source, _mm_unpackhi_epi8(Destination, Zero), High));
+            _mm_storeu_si128((__m128i *)(Row + i), Result);
+        }
+        #endif
+
+        for(; i < Length; ++i)
+        {
+            if(!Coverage[i]) continue;
+            Row[i] = Blend(Row[i], (Colour & 0xFFFFFF) | (Multiply(Alpha, Coverage[i]) << 24));
+        }
+    }
+
+    // Uniform coverage, e.g. the interior of a shape.
+    inline void Fillspan(uint32_t *Row, int32_t Length, uint32_t Colour)
+    {
+        if((Colour >> 24) == 0xFF) return (void)std::fill_n(Row, Length, Colour);
+        int32_t i = 0;
+
+        #if defined(HAS_SSE2)
+        const auto Zero = _mm_setzero_si128();
+        const auto Source = _mm_unpacklo_epi8(_mm_set1_epi32(int(Colour | 0xFF000000)), Zero);
+        const auto Alpha = _mm_set1_epi16(int16_t(Colour >> 24));
+
+        for(; i + 4 <= Length; i += 4)
+        {
+            const auto Destination = _mm_loadu_si128((const __m128i *)(Row + i));
+            const auto Result = _mm_packus_epi16(Internal::Lerp(Source, _mm_unpacklo_epi8(Destination, Zero), Alpha),
+                                                 Internal::Lerp(Source, _mm_unpackhi_epi8(Destination, Zero), Alpha));
+            _mm_storeu_si128((__m128i *)(Row + i), Result);
+        }
+        #endif
+
+        for(; i < Length; ++i) Row[i] = Blend(Row[i], Colour);
+    }
+
+    // Pixel-snapped, clipped to the surface.
+    inline void Fillrectangle(Surface_t &Surface, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t Colour)
+    {
+        x0 = std::max(x0, 0); y0 = std::max(y0, 0);
+        x1 = std::min(x1, Surface.Width); y1 = std::min(y1, Surface.Height);
+        if(x0 >= x1 || y0 >= y1) return;
+
+        for(int32_t y = y0; y < y1; ++y)
+        {
+            Fillspan(Surface.Pixels + y * Surface.Width + x0, x1 - x0, Colour);
+        }
+    }
+
+    // A rounded rectangle in sub-pixel coordinates, with an inset it's the outline of that width.
+    struct Shape_t
+    {
+        vec4_t Area;
+        float Radius, Inset;
+        uint32_t Colour;
+
+        // Pixels that can be touched, i.e. the area rounded outwards.
+        int32_t Left() const { return int32_t(std::floor(Area.x0)); }
+        int32_t Top() const { return int32_t(std::floor(Area.y0)); }
+        int32_t Right() const { return int32_t(std::ceil(Area.x1)); }
+        int32_t Bottom() const { return int32_t(std::ceil(Area.y1)); }
+    };
+
+    namespace Internal
+    {
+        // Length of [a, b) inside the pixel [p, p + 1).
+        inline float Overlap(float a, float b, int32_t p)
+        {
+            return std::clamp(std::min(b, p + 1.0f) - std::max(a, float(p)), 0.0f, 1.0f);
+        }
+
+        // A rounded rectangle as seen by one row.
+        struct Row_t
+        {
+            vec4_t Area; float Radius, Vertical;
+            int32_t Solid0, Solid1;     // Fully covered pixels.
+            int32_t Touched0, Touched1; // Partially covered pixels.
+
+            Row_t(const vec4_t &Rectangle, float Cornerradius, int32_t y) : Area(Rectangle)
+            {
+                const auto Width = Area.x1 - Area.x0, Height = Area.y1 - Area.y0;
+                Radius = std::clamp(Cornerradius, 0.0f, std::min(Width, Height) * 0.5f);
+                Vertical = Width > 0 && Height > 0 ? Overlap(Area.y0, Area.y1, y) : 0.0f;
+
+                Touched0 = Touched1 = Solid0 = Solid1 = 0;
+                if(Vertical <= 0.0f) return;
+                Touched0 = int32_t(std::floor(Area.x0));
+                Touched1 = int32_t(std::ceil(Area.x1));
+                if(Vertical < 1.0f) return;
+
+                // Rows through the corners lose the rounded part on either side.
+                const auto Inset = (y < Area.y0 + Radius || y + 1 > Area.y1 - Radius) ? Radius : 0.0f;
+                Solid0 = int32_t(std::ceil(Area.x0 + Inset));
+                Solid1 = std::max(Solid0, int32_t(std::floor(Area.x1 - Inset)));
+            }
+
+            // Exact for the straight edges, the corners use the distance to the arc.
+            float Coverage(int32_t x, int32_t y) const
+            {
+                if(x < Touched0 || x >= Touched1) return 0.0f;
+                if(x >= Solid0 && x < Solid1) return 1.0f;
+
+                const auto Linear = Overlap(Area.x0, Area.x1, x) * Vertical;
+                if(Radius <= 0.0f || Linear <= 0.0f) return Linear;
+
+                const auto Centerx = x + 0.5f, Centery = y + 0.5f;
+                const auto dx = std::max({ Area.x0 + Radius - Centerx, Centerx - (Area.x1 - Radius), 0.0f });
+                const auto dy = std::max({ Area.y0 + Radius - Centery, Centery - (Area.y1 - Radius), 0.0f });
+                if(dx <= 0.0f || dy <= 0.0f) return Linear;
+
+                return std::min(Linear, std::clamp(Radius + 0.5f - std::sqrt(dx * dx + dy * dy), 0.0f, 1.0f));
+            }
+        };
+    }
+
+    // Rasterize the part of the shape on row y within [x0, x1).
+    inline void Drawspan(uint32_t *Row, const Shape_t &Shape, int32_t y, int32_t x0, int32_t x1)
+    {
+        const Internal::Row_t Outer(Shape.Area, Shape.Radius, y);
+        if(Outer.Vertical <= 0.0f) return;
+
+        // Outlines subtract the inner shape, which leaves a hole where it's solid.
+        const bool isOutline = Shape.Inset > 0.0f;
+        const Internal::Row_t Inner(isOutline ? vec4_t{ Shape.Area.x0 + Shape.Inset, Shape.Area.y0 + Shape.Inset, Shape.Area.x1 - Shape.Inset, Shape.Area.y1 - Shape.Inset }
+                                              : vec4_t{}, Shape.Radius - Shape.Inset, y);
+
+        x0 = std::max(x0, Outer.Touched0);
+        x1 = std::min(x1, Outer.Touched1);
+
+        uint8_t Coverage[256];
+        while(x0 < x1)
+        {
+            // Holes are skipped and solid runs filled, anything else gets its coverage computed.
+            if(x0 >= Inner.Solid0 && x0 < Inner.Solid1)
+            {
+                x0 = Inner.Solid1;
+                continue;
+            }
+
+            const bool isInner = x0 >= Inner.Touched0 && x0 < Inner.Touched1;
+            if(!isInner && x0 >= Outer.Solid0 && x0 < Outer.Solid1)
+            {
+                auto End = std::min(x1, Outer.Solid1);
+                if(x0 < Inner.Touched0) End = std::min(End, Inner.Touched0);
+
+                Fillspan(Row + x0, End - x0, Shape.Colour);
+                x0 = End;
+                continue;
+            }
+
+            // Up to the next boundary, whichever comes first.
+            auto End = x1;
+            for(const auto Boundary : { Outer.Solid0, Inner.Solid0, Inner.Solid1, Inner.Touched1 })
+                if(Boundary > x0) End = std::min(End, Boundary);
+            if(!isInner && x0 >= Outer.Solid1 && Inner.Touched0 > x0) End = std::min(End, Inner.Touched0);
+            End = std::min(End, x0 + int32_t(sizeof(Coverage)));
+
+            for(int32_t x = x0; x < End; ++x)
+            {
+                const auto Value = Outer.Coverage(x, y) - (isOutline ? Inner.Coverage(x, y) : 0.0f);
+                Coverage[x - x0] = uint8_t(std::clamp(Value, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+
+            Blendspan(Row + x0, Coverage, End - x0, Shape.Colour);
+            x0 = End;
+        }
+    }
+
+    // The whole shape, clipped to the surface.
+    inline void Drawshape(Surface_t &Surface, const Shape_t &Shape)
+    {
+        const auto x0 = std::max(Shape.Left(), 0), x1 = std::min(Shape.Right(), Surface.Width);
+        const auto y0 = std::max(Shape.Top(), 0), y1 = std::min(Shape.Bottom(), Surface.Height);
+
+        for(int32_t y = y0; y < y1; ++y)
+        {
+            Drawspan(Surface.Pixels + y * Surface.Width, Shape, y, x0, x1);
+        }
+    }
+}
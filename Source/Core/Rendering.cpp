@@ -0,0 +1,461 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-01
+    License: MIT
+*/
+
+#include <Stdinclude.hpp>
+#include <Core/Traversal.hpp>
+#include <Core/Rasterizer.hpp>
+#include <Core/Text.hpp>
+#include <Core/Animation.hpp>
+#include <Core/Lists.hpp>
+
+// Animated elements override their class, opacity scales every alpha.
+inline uint32_t Fade(uint32_t Colour, float Opacity)
+{
+    return (Colour & 0xFFFFFF) | (uint32_t((Colour >> 24) * Opacity + 0.5f) << 24);
+}
+static Attributes::Background Restyle(const Element_t &Node, Attributes::Background Background)
+{
+    if(const auto Style = Animation::Find(Node))
+    {
+        if(Style->hasColour) Background.Colour = Style->Colour;
+        Background.Colour = Fade(Background.Colour, Style->Opacity);
+        Background.Border = Fade(Background.Border, Style->Opacity);
+    }
+    return Background;
+}
+static Attributes::Text Restyle(const Element_t &Node, Attributes::Text Label)
+{
+    if(const auto Style = Animation::Find(Node)) Label.Colour = Fade(Label.Colour, Style->Opacity);
+    return Label;
+}
+
+// A node is drawn as up to two shapes, in render order: Solid, Overlay, Outline.
+static uint32_t Decompose(const Element_t &Node, const Attributes::Background &Classstyle, Rasterizer::Shape_t (&Shapes)[2])
+{
+    const auto Background = Restyle(Node, Classstyle);
+    uint32_t Count{};
+
+    if(Background.Colour)
+    {
+        Shapes[Count++] = { Node.Area, Background.Radius, 0.0f, Background.Colour };
+    }
+    if(!Background.Image.empty())
+    {
+        // TODO(tcn): Need a buffer system..
+    }
+    if(Background.Border && Background.Borderwidth > 0.0f)
+    {
+        // Inside the area, following the corners.
+        Shapes[Count++] = { Node.Area, Background.Radius, Background.Borderwidth, Background.Border };
+    }
+
+    return Count;
+}
+
+// Draw a single node, the offset moves it into the target's coordinate-system.
+static void Drawnode(Surface_t &Surface, const Element_t &Node, const Attributes::Background &Background, const Attributes::Text &Label, int32_t Offsetx = 0, int32_t Offsety = 0)
+{
+    Rasterizer::Shape_t Shapes[2];
+    const auto Count = Decompose(Node, Background, Shapes);
+
+    for(uint32_t i = 0; i < Count; ++i)
+    {
+        auto &Area = Shapes[i].Area;
+        Area = { Area.x0 - Offsetx, Area.y0 - Offsety, Area.x1 - Offsetx, Area.y1 - Offsety };
+        Rasterizer::Drawshape(Surface, Shapes[i]);
+    }
+
+    Text::Drawlabel(Surface, Restyle(Node, Label), Node.Area, Offsetx, Offsety);
+}
+
+// Subtrees without callbacks can't change between frames, so they are rasterized once and composited.
+namespace Layers
+{
+    // Smaller subtrees are as cheap to draw as to composite.
+    constexpr uint32_t Minnodes = 2;
+
+    struct Layer_t
+    {
+        uint64_t Fingerprint;
+        int32_t x0, y0, Width, Height;
+        std::vector<uint32_t> Pixels;
+        uint64_t Lastused;
+        bool isOpaque;
+    };
+
+    // Per context and keyed by the subtree's root, layers not used in a frame are dropped.
+    struct State_t { std::unordered_map<uint32_t, Layer_t> Cache; uint64_t Framecount; };
+    static State_t &State() { return Modulestate<State_t>(Activecontext->Modules.Layers); }
+
+    // Order-dependent combination of hashes, this runs for every node each frame so FNV is too slow.
+    inline uint64_t Mix(uint64_t Hash, uint64_t Value)
+    {
+        Hash = (Hash ^ Value) * 0x9E3779B97F4A7C15;
+        return Hash ^ (Hash >> 29);
+    }
+
+    // Anything that would change the rasterized output, the style is hashed once per frame.
+    inline uint64_t Fingerprint(const Element_t &Node, uint64_t Stylehash)
+    {
+        uint64_t Area[2]{};
+        std::memcpy(Area, &Node.Area, sizeof(Node.Area));
+        return Mix(Mix(Mix(Stylehash, Area[0]), Area[1]), Node.StyleID);
+    }
+    inline uint64_t Fingerprint(const Attributes::Background &Background)
+    {
+        uint32_t Values[4]{ Background.Colour, Background.Border };
+        std::memcpy(&Values[2], &Background.Radius, sizeof(float));
+        std::memcpy(&Values[3], &Background.Borderwidth, sizeof(float));
+        return Mix(Hash::FNV1a_64(Values, sizeof(Values)), Hash::FNV1a_64(Background.Image));
+    }
+    inline uint64_t Fingerprint(const Attributes::Text &Label)
+    {
+        const uint32_t Values[2]{ Label.Colour, uint32_t(Label.Size * 4.0f) };
+        return Mix(Mix(Hash::FNV1a_64(Values, sizeof(Values)), Hash::FNV1a_64(Label.String)), Hash::FNV1a_64(Label.Font));
+    }
+
+    // Composite part of a row from the layer, opaque pixels are copied and transparent ones skipped.
+    inline void Present(uint32_t *Destination, const Layer_t &Layer, int32_t x, int32_t y, int32_t Length)
+    {
+        const auto Source = Layer.Pixels.data() + (y - Layer.y0) * Layer.Width + (x - Layer.x0);
+
+        if(Layer.isOpaque)
+        {
+            std::memcpy(Destination, Source, Length * sizeof(uint32_t));
+            return;
+        }
+
+        for(int32_t i = 0; i < Length; ++i)
+        {
+            const auto Alpha = Source[i] >> 24;
+            if(Alpha == 0xFF) Destination[i] = Source[i];
+            else if(Alpha) Destination[i] = Rasterizer::Composite(Destination[i], Source[i]);
+        }
+    }
+}
+
+// Opaque fills hide whatever was drawn before them, so we resolve what's visible front-to-back before touching pixels.
+namespace Culling
+{
+    struct Span_t { int32_t x0, x1; };
+    struct Visible_t { int32_t y, x0, x1; };
+
+    // Only large fills are worth tracking, small ones are simply overdrawn.
+    constexpr int32_t Minarea = 32 * 32;
+
+    // Either a shape or a cached layer, the bounds are the pixels it touches clipped to the surface.
+    struct Primitive_t
+    {
+        int32_t x0, y0, x1, y1;
+        Rasterizer::Shape_t Shape;
+        const Layers::Layer_t *Layer{};
+
+        bool isLarge() const { return (x1 - x0) * (y1 - y0) >= Minarea; }
+
+        // The fully covered part of a row, anti-aliased edges and outlines don't hide anything.
+        Span_t Interior(int32_t y) const
+        {
+            if(Layer) return Layer->isOpaque ? Span_t{ x0, x1 } : Span_t{};
+            if(Shape.Inset > 0.0f || (Shape.Colour >> 24) != 0xFF) return {};
+
+            const Rasterizer::Internal::Row_t Row(Shape.Area, Shape.Radius, y);
+            return { std::max(Row.Solid0, x0), std::min(Row.Solid1, x1) };
+        }
+    };
+
+    // The parts of each row that opaque primitives have claimed, sorted and merged.
+    struct Coverage_t
+    {
+        std::pmr::vector<Span_t> *Rows;
+        int32_t Width, Height, Fullrows{};
+
+        Coverage_t(int32_t Width, int32_t Height) : Width(Width), Height(Height)
+        {
+            Rows = (std::pmr::vector<Span_t> *)Activecontext->Framearena.allocate(sizeof(std::pmr::vector<Span_t>) * Height, alignof(std::pmr::vector<Span_t>));
+            for(int32_t y = 0; y < Height; ++y) std::construct_at(&Rows[y], &Activecontext->Framearena);
+        }
+
+        bool isComplete() const { return Fullrows == Height; }
+
+        // Report the uncovered parts of [x0, x1).
+        template<typename Callback_t> void Visit(int32_t y, int32_t x0, int32_t x1, Callback_t &&Output) const
+        {
+            const auto &Row = Rows[y];
+            auto Cursor = x0;
+
+            auto First = std::lower_bound(Row.begin(), Row.end(), x0, [](const Span_t &Span, int32_t x) { return Span.x1 < x; });
+            for(auto Span = First; Span != Row.end() && Span->x0 < x1; ++Span)
+            {
+                if(Span->x0 > Cursor) Output(Cursor, Span->x0);
+                Cursor = std::max(Cursor, Span->x1);
+            }
+            if(Cursor < x1) Output(Cursor, x1);
+        }
+
+        // Mark [x0, x1) as hidden for everything behind it.
+        void Claim(int32_t y, int32_t x0, int32_t x1)
+        {
+            if(x0 >= x1) return;
+            auto &Row = Rows[y];
+
+            // Already covered, nothing to claim.
+            auto First = std::lower_bound(Row.begin(), Row.end(), x0, [](const Span_t &Span, int32_t x) { return Span.x1 < x; });
+            if(First != Row.end() && First->x0 <= x0 && First->x1 >= x1) return;
+
+            // Merge with everything overlapping or touching.
+            auto Last = First;
+            Span_t Merged{ x0, x1 };
+            while(Last != Row.end() && Last->x0 <= x1)
+            {
+                Merged.x0 = std::min(Merged.x0, Last->x0);
+                Merged.x1 = std::max(Merged.x1, Last->x1);
+                ++Last;
+            }
+            Row.insert(Row.erase(First, Last), Merged);
+
+            if(Row.size() == 1 && Row[0].x0 <= 0 && Row[0].x1 >= Width) ++Fullrows;
+        }
+    };
+}
+
+// Render each of the nodes to the surface.
+void Rendernodes(Surface_t &Surface, Array<Element_t, Maxnodes> &Nodetree, Array<Class_t, Maxclasses> &Classes)
+{
+    // Clear the surface to white (chroma-key for transparent), unless something opaque covers it.
+    if(!Nodetree.Size) return (void)std::fill_n(Surface.Pixels, Surface.Width * Surface.Height, 0xFFFFFFFF);
+    auto &Cache = Layers::State().Cache;
+    const auto Framecount = ++Layers::State().Framecount;
+
+    // Resolve the styles up-front rather than per node.
+    const auto Styles = (Attributes::Background *)Activecontext->Framearena.allocate(sizeof(Attributes::Background) * Classes.Size, alignof(Attributes::Background));
+    const auto Labels = (Attributes::Text *)Activecontext->Framearena.allocate(sizeof(Attributes::Text) * Classes.Size, alignof(Attributes::Text));
+    const auto Stylehashes = (uint64_t *)Activecontext->Framearena.allocate(sizeof(uint64_t) * Classes.Size, alignof(uint64_t));
+    for(uint32_t i = 0; i < Classes.Size; ++i)
+    {
+        Styles[i] = std::get<Attributes::Background>(Classes[i][Hash::FNV1a_32("Background")]);
+
+        const auto Label = Classes[i].find(Hash::FNV1a_32("Text"));
+        Labels[i] = Label != Classes[i].end() && std::holds_alternative<Attributes::Text>(Label->second) ? std::get<Attributes::Text>(Label->second) : Attributes::Text{};
+
+        Stylehashes[i] = Layers::Mix(Layers::Fingerprint(Styles[i]), Layers::Fingerprint(Labels[i]));
+    }
+
+    // Lists clip their items to their area, which only the rows need to know as they scroll vertically.
+    const auto Lists = Lists::Containers();
+    const auto isList = [&](uint32_t Index) { return !Lists.empty() && std::binary_search(Lists.begin(), Lists.end(), Index); };
+
+    // Find the static subtrees along with their size, extent and fingerprint; children first.
+    // A layer is only clipped by its own bounds, so nothing containing a list gets one unless it's the list itself.
+    struct Subtree_t { uint64_t Fingerprint; vec4_t Extent; uint32_t Nodes; bool isStatic, hasList; };
+    const auto Subtrees = (Subtree_t *)Activecontext->Framearena.allocate(sizeof(Subtree_t) * Nodetree.Size, alignof(Subtree_t));
+    for(const auto [Index, _] : Traversal::Postorder(Nodetree))
+    {
+        const auto &Node = Nodetree[Index];
+        auto &This = Subtrees[Index];
+
+        This = { Layers::Fingerprint(Node, Stylehashes[Node.StyleID]), Node.Area, 1, !Node.onFrame && !Node.onState, isList(Index) };
+
+        // Running tweens change it every frame, finished ones are just another style.
+        if(const auto Style = Animation::Find(Node))
+        {
+            uint32_t Opacity;
+            std::memcpy(&Opacity, &Style->Opacity, sizeof(Opacity));
+            This.Fingerprint = Layers::Mix(Layers::Mix(This.Fingerprint, Style->hasColour ? Style->Colour : 0), Opacity);
+            This.isStatic &= !Style->Activetracks;
+        }
+
+        for(const auto Child : Traversal::Children(Node))
+        {
+            if(!Child) continue;
+            const auto &Other = Subtrees[Child];
+
+            This.Fingerprint = Layers::Mix(This.Fingerprint, Other.Fingerprint);
+            This.Extent.x0 = std::min(This.Extent.x0, Other.Extent.x0); This.Extent.y0 = std::min(This.Extent.y0, Other.Extent.y0);
+            This.Extent.x1 = std::max(This.Extent.x1, Other.Extent.x1); This.Extent.y1 = std::max(This.Extent.y1, Other.Extent.y1);
+            This.Nodes += Other.Nodes;
+            This.isStatic &= Other.isStatic && !Other.hasList;
+            This.hasList |= Other.hasList;
+        }
+
+        if(This.hasList && isList(Index))
+        {
+            const vec4_t Area = Node.Area;
+            This.Extent.y0 = std::max(This.Extent.y0, Area.y0);
+            This.Extent.y1 = std::min(This.Extent.y1, Area.y1);
+        }
+    }
+
+    // Paint-order of what to draw, a node or a layer; the clear goes first. Only the rows in [Clip0, Clip1) may be touched.
+    struct Draw_t { uint32_t Index; const Layers::Layer_t *Layer; int32_t Clip0, Clip1; };
+    std::pmr::vector<Draw_t> Drawlist(&Activecontext->Framearena);
+    Drawlist.reserve(Nodetree.Size + 1);
+    Drawlist.push_back({ Traversal::None, nullptr, 0, Surface.Height });
+
+    // Back-to-front, static subtrees are composited from their layer rather than descended into.
+    struct Pending_t { Nodeid_t Index; int32_t Clip0, Clip1; };
+    Traversal::Stack<Pending_t> Pending(Nodetree.Size);
+    Pending.push({ 0, 0, Surface.Height });
+    while(!Pending.empty())
+    {
+        auto [Index, Clip0, Clip1] = Pending.pop();
+        const auto &Subtree = Subtrees[Index];
+
+        if(Subtree.isStatic && Subtree.Nodes >= Layers::Minnodes)
+        {
+            const auto x0 = std::max(int32_t(std::floor(Subtree.Extent.x0)), 0);
+            const auto y0 = std::max(int32_t(std::floor(Subtree.Extent.y0)), Clip0);
+            const auto x1 = std::min(int32_t(std::ceil(Subtree.Extent.x1)), Surface.Width);
+            const auto y1 = std::min(int32_t(std::ceil(Subtree.Extent.y1)), Clip1);
+            if(x0 >= x1 || y0 >= y1) continue;
+
+            // The clip is part of the key, the layer only holds what's visible.
+            const int32_t Extent[4]{ x0, y0, x1, y1 };
+            const auto Fingerprint = Layers::Mix(Subtree.Fingerprint, Hash::FNV1a_64(Extent, sizeof(Extent)));
+
+            auto &Layer = Cache[Index];
+            if(Layer.Pixels.empty() || Layer.Fingerprint != Fingerprint)
+            {
+                Layer.Fingerprint = Fingerprint;
+                Layer.x0 = x0; Layer.y0 = y0;
+                Layer.Width = x1 - x0; Layer.Height = y1 - y0;
+                Layer.Pixels.assign(size_t(Layer.Width) * Layer.Height, 0);
+
+                Surface_t Target{ Layer.Pixels.data(), Layer.Width, Layer.Height };
+                for(const auto [Node, _] : Traversal::Preorder(Nodetree, Index))
+                {
+                    Drawnode(Target, Nodetree[Node], Styles[Nodetree[Node].StyleID], Labels[Nodetree[Node].StyleID], x0, y0);
+                }
+
+                Layer.isOpaque = std::all_of(Layer.Pixels.begin(), Layer.Pixels.end(), [](uint32_t Pixel) { return (Pixel >> 24) == 0xFF; });
+            }
+
+            Layer.Lastused = Framecount;
+            Drawlist.push_back({ Index, &Layer, Clip0, Clip1 });
+            continue;
+        }
+
+        Drawlist.push_back({ Index, nullptr, Clip0, Clip1 });
+
+        // Partly visible items are cut at the list's edges, the overscan ones are not drawn at all.
+        if(Subtree.hasList && isList(Index))
+        {
+            const vec4_t Area = Nodetree[Index].Area;
+            Clip0 = std::max(Clip0, int32_t(std::floor(Area.y0)));
+            Clip1 = std::min(Clip1, int32_t(std::ceil(Area.y1)));
+        }
+
+        const auto Slots = Traversal::Children(Nodetree[Index]);
+        for(auto Slot = Slots.rbegin(); Slot != Slots.rend(); ++Slot)
+            if(*Slot) Pending.push({ *Slot, Clip0, Clip1 });
+    }
+
+    // The shapes of an entry in paint-order, clipped to the surface and the entry's rows.
+    const auto Primitives = [&](const Draw_t &Draw, Culling::Primitive_t (&Output)[2]) -> uint32_t
+    {
+        if(Draw.Layer) { Output[0] = { Draw.Layer->x0, Draw.Layer->y0, Draw.Layer->x0 + Draw.Layer->Width, Draw.Layer->y0 + Draw.Layer->Height, {}, Draw.Layer }; return 1; }
+        if(Draw.Index == Traversal::None)
+        {
+            Output[0] = { 0, 0, Surface.Width, Surface.Height, { vec4_t{ 0.0f, 0.0f, float(Surface.Width), float(Surface.Height) }, 0.0f, 0.0f, 0xFFFFFFFF } };
+            return 1;
+        }
+
+        Rasterizer::Shape_t Shapes[2];
+        uint32_t Count{};
+        for(uint32_t i = 0, Total = Decompose(Nodetree[Draw.Index], Styles[Nodetree[Draw.Index].StyleID], Shapes); i < Total; ++i)
+        {
+            const auto x0 = std::max(Shapes[i].Left(), 0), y0 = std::max(Shapes[i].Top(), Draw.Clip0);
+            const auto x1 = std::min(Shapes[i].Right(), Surface.Width), y1 = std::min(Shapes[i].Bottom(), Draw.Clip1);
+            if(x0 < x1 && y0 < y1) Output[Count++] = { x0, y0, x1, y1, Shapes[i] };
+        }
+        return Count;
+    };
+
+    // Front-to-back, find the visible spans of the large primitives while the opaque interiors claim coverage.
+    struct Record_t { uint32_t Firstspan, Spancount; };
+    std::pmr::vector<Record_t> Records(&Activecontext->Framearena);
+    std::pmr::vector<Culling::Visible_t> Visible(&Activecontext->Framearena);
+    Culling::Coverage_t Coverage(Surface.Width, Surface.Height);
+    for(auto Draw = Drawlist.rbegin(); Draw != Drawlist.rend(); ++Draw)
+    {
+        // Conservative, as the shapes touch at most two extra pixels per axis.
+        if(!Draw->Layer && Draw->Index != Traversal::None)
+        {
+            const vec4_t Area = Nodetree[Draw->Index].Area;
+            if((Area.x1 - Area.x0 + 2.0f) * (Area.y1 - Area.y0 + 2.0f) < float(Culling::Minarea)) continue;
+        }
+
+        Culling::Primitive_t Shapes[2];
+        for(uint32_t i = Primitives(*Draw, Shapes); i-- > 0;)
+        {
+            const auto &Shape = Shapes[i];
+            if(!Shape.isLarge()) continue;
+
+            Record_t Record{ uint32_t(Visible.size()), 0 };
+            if(!Coverage.isComplete())
+            {
+                for(int32_t y = Shape.y0; y < Shape.y1; ++y)
+                {
+                    Coverage.Visit(y, Shape.x0, Shape.x1, [&](int32_t x0, int32_t x1)
+                    {
+                        Visible.push_back({ y, x0, x1 });
+                    });
+
+                    const auto Interior = Shape.Interior(y);
+                    Coverage.Claim(y, Interior.x0, Interior.x1);
+                }
+            }
+
+            Record.Spancount = uint32_t(Visible.size()) - Record.Firstspan;
+            Records.push_back(Record);
+        }
+    }
+
+    // Back-to-front, large primitives only touch their visible spans and small ones are drawn as-is.
+    for(const auto &Draw : Drawlist)
+    {
+        Culling::Primitive_t Shapes[2];
+        for(uint32_t i = 0, Count = Primitives(Draw, Shapes); i < Count; ++i)
+        {
+            const auto &Shape = Shapes[i];
+
+            if(!Shape.isLarge())
+            {
+                for(int32_t y = Shape.y0; y < Shape.y1; ++y)
+                {
+                    const auto Row = Surface.Pixels + y * Surface.Width;
+                    if(Shape.Layer) Layers::Present(Row + Shape.x0, *Shape.Layer, Shape.x0, y, Shape.x1 - Shape.x0);
+                    else Rasterizer::Drawspan(Row, Shape.Shape, y, Shape.x0, Shape.x1);
+                }
+                continue;
+            }
+
+            const auto Record = Records.back();
+            Records.pop_back();
+
+            for(uint32_t k = 0; k < Record.Spancount; ++k)
+            {
+                const auto &Span = Visible[Record.Firstspan + k];
+                const auto Row = Surface.Pixels + Span.y * Surface.Width;
+
+                if(Shape.Layer) Layers::Present(Row + Span.x0, *Shape.Layer, Span.x0, Span.y, Span.x1 - Span.x0);
+                else Rasterizer::Drawspan(Row, Shape.Shape, Span.y, Span.x0, Span.x1);
+            }
+        }
+
+        // Labels are small enough to simply overdraw, anything hiding them is drawn later.
+        // Clipped by drawing into a view of just the visible rows.
+        if(!Draw.Layer && Draw.Index != Traversal::None && Draw.Clip0 < Draw.Clip1)
+        {
+            const auto &Node = Nodetree[Draw.Index];
+            Surface_t Rows{ Surface.Pixels + Draw.Clip0 * Surface.Width, Surface.Width, Draw.Clip1 - Draw.Clip0 };
+            Text::Drawlabel(Rows, Restyle(Node, Labels[Node.StyleID]), Node.Area, 0, Draw.Clip0);
+        }
+    }
+
+    // Subtrees that changed shape or went live no longer need their layers.
+    std::erase_if(Cache, [&](const auto &Item) { return Item.second.Lastused != Framecount; });
+    Text::Endframe();
+}
@@ -0,0 +1,231 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-04
+    License: MIT
+*/
+
+#include <Stdinclude.hpp>
+#include <Core/Text.hpp>
+#include <Core/Rasterizer.hpp>
+#include <Utilities/Truetype.hpp>
+#include <Utilities/Filesystem.hpp>
+
+namespace Text
+{
+    // Where a glyph lives in the atlas, the offset is from the pen-position on the baseline.
+    struct Glyph_t { int16_t x, y, Width, Height, Offsetx, Offsety; uint16_t Shelf; };
+    constexpr uint16_t Noshelf = UINT16_MAX;
+
+    // 8-bit coverage shared by all fonts and sizes, packed in shelves of similar height.
+    namespace Atlas
+    {
+        constexpr int32_t Size = 1024;
+
+        struct Shelf_t { int16_t y, Height, Cursor; uint64_t Lastused; };
+        struct Atlas_t
+        {
+            std::vector<uint8_t> Pixels;
+            std::vector<Shelf_t> Shelves;
+            std::unordered_map<uint64_t, Glyph_t> Glyphs;
+            int16_t Nextshelf{};
+
+            // Bumped when glyphs are evicted, layouts holding atlas positions need to look them up again.
+            uint64_t Generation{ 1 };
+        };
+    }
+
+    // A laid out string, advance-widths only; glyph positions in the atlas are cached until it evicts something.
+    struct Run_t
+    {
+        struct Placement_t { uint32_t Glyph; int32_t Penx; Glyph_t Cached; };
+        std::vector<Placement_t> Glyphs;
+        int32_t Width, Ascent, Descent;
+        uint64_t Generation, Lastused;
+    };
+
+    // Per context like the other modules, so contexts driven from different threads never touch the same caches.
+    // Fonts are loaded on first use and kept, failures too so they aren't retried every frame.
+    struct State_t
+    {
+        std::unordered_map<uint32_t, Truetype::Font_t> Fonts;
+        std::unordered_map<uint64_t, Run_t> Runs;
+        Atlas::Atlas_t Atlas;
+        uint64_t Framecount{};
+    };
+    static State_t &State() { return Modulestate<State_t>(Activecontext->Modules.Text); }
+
+    static const Truetype::Font_t *Getfont(std::string_view Path, uint32_t Fonthash)
+    {
+        auto [Iterator, isNew] = State().Fonts.try_emplace(Fonthash);
+        if(isNew) Iterator->second.Load(FS::Readfile(std::string(Path)));
+        return Iterator->second.isValid() ? &Iterator->second : nullptr;
+    }
+
+    namespace Atlas
+    {
+    // Least recently drawn shelf that can hold the height, never one used this frame.
+        static Shelf_t *Evict(Atlas_t &Atlas, int16_t Height, uint64_t Framecount)
+        {
+            auto &[Pixels, Shelves, Glyphs, Nextshelf, Generation] = Atlas;
+            Shelf_t *Victim{};
+            for(auto &Shelf : Shelves)
+            {
+                if(Shelf.Height < Height || Shelf.Lastused == Framecount) continue;
+                if(!Victim || Shelf.Lastused < Victim->Lastused) Victim = &Shelf;
+            }
+            if(!Victim) return nullptr;
+
+            const auto Index = uint16_t(Victim - Shelves.data());
+            std::erase_if(Glyphs, [&](const auto &Item) { return Item.second.Shelf == Index; });
+            Victim->Cursor = 0;
+            Generation++;
+            return Victim;
+        }
+
+        // Rasterize on first use, false if the atlas is full of glyphs drawn this frame.
+        static bool Lookup(Atlas_t &Atlas, uint64_t Framecount, const Truetype::Font_t &Font, uint64_t Key, uint32_t Glyphindex, float Scale, Glyph_t &Output)
+        {
+            auto &[Pixels, Shelves, Glyphs, Nextshelf, Generation] = Atlas;
+            if(const auto Iterator = Glyphs.find(Key); Iterator != Glyphs.end())
+            {
+                Output = Iterator->second;
+                return true;
+            }
+
+            const auto Bitmap = Font.Rasterize(Glyphindex, Scale);
+            if(Bitmap.Pixels.empty())
+            {
+                Output = Glyphs[Key] = { 0, 0, 0, 0, 0, 0, Noshelf };
+                return true;
+            }
+            if(Bitmap.Width > Size || Bitmap.Height > Size) return false;
+            if(Pixels.empty()) Pixels.resize(size_t(Size) * Size);
+
+            // Heights are rounded up so nearby sizes can share shelves.
+            const auto Height = int16_t((Bitmap.Height + 3) & ~3);
+            Shelf_t *Target{};
+            for(auto &Shelf : Shelves)
+            {
+                if(Shelf.Height == Height && Shelf.Cursor + Bitmap.Width <= Size)
+                {
+                    Target = &Shelf;
+                    break;
+                }
+            }
+            if(!Target && Nextshelf + Height <= Size)
+            {
+                Target = &Shelves.emplace_back(Shelf_t{ Nextshelf, Height, 0, Framecount });
+                Nextshelf += Height;
+            }
+            if(!Target) Target = Evict(Atlas, Height, Framecount);
+            if(!Target) return false;
+
+            Output = { Target->Cursor, Target->y, int16_t(Bitmap.Width), int16_t(Bitmap.Height),
+                       int16_t(Bitmap.Offsetx), int16_t(Bitmap.Offsety), uint16_t(Target - Shelves.data()) };
+            Target->Cursor += int16_t(Bitmap.Width);
+
+            for(int32_t y = 0; y < Bitmap.Height; ++y)
+            {
+                std::memcpy(&Pixels[size_t(Output.y + y) * Size + Output.x], &Bitmap.Pixels[size_t(y) * Bitmap.Width], Bitmap.Width);
+            }
+
+            Glyphs[Key] = Output;
+            return true;
+        }
+    }
+
+    // Not drawn for this many frames and the layout is dropped, the glyphs stay until the atlas needs the room.
+    constexpr uint64_t Runlifetime = 120;
+
+    void Drawlabel(Surface_t &Surface, const Attributes::Text &Label, const vec4_t &Area, int32_t Offsetx, int32_t Offsety)
+    {
+        if(Label.String.empty() || Label.Font.empty()) return;
+        auto &Cache = State();
+
+        // Without a size the label fills most of the element's height.
+        const auto Pixelheight = Label.Size > 0.0f ? Label.Size : std::round((Area.y1 - Area.y0) * 0.6f);
+        const auto Quantized = uint32_t(Pixelheight * 4.0f + 0.5f);
+        if(!Quantized || Quantized > UINT16_MAX) return;
+
+        const auto Fonthash = Hash::FNV1a_32(Label.Font);
+        const auto Font = Getfont(Label.Font, Fonthash);
+        if(!Font) return;
+
+        const auto Scale = Font->Scale(Quantized / 4.0f);
+        const auto Keyprefix = (uint64_t(Fonthash) << 32) | (uint64_t(Quantized) << 16);
+
+        // Lay the string out on first use.
+        const auto Runkey = Hash::FNV1a_64(Label.String) ^ (Keyprefix * 0x9E3779B97F4A7C15);
+        auto [Iterator, isNew] = Cache.Runs.try_emplace(Runkey);
+        auto &Run = Iterator->second;
+        if(isNew)
+        {
+            int32_t Penx{};
+            for(auto String = Label.String; !String.empty();)
+            {
+                const auto Glyph = Font->Glyphindex(Truetype::Decodeutf8(String));
+                Run.Glyphs.push_back({ Glyph & 0xFFFF, Penx, {} });
+                Penx += int32_t(std::lround(Font->Advance(Glyph) * Scale));
+            }
+
+            Run.Width = Penx;
+            Run.Ascent = int32_t(std::lround(Font->Ascent * Scale));
+            Run.Descent = int32_t(std::lround(-Font->Descent * Scale));
+            Run.Generation = 0;
+        }
+        Run.Lastused = Cache.Framecount;
+
+        // Evictions may have moved the glyphs.
+        if(Run.Generation != Cache.Atlas.Generation)
+        {
+            Run.Generation = Cache.Atlas.Generation;
+            for(auto &Placement : Run.Glyphs)
+            {
+                if(!Atlas::Lookup(Cache.Atlas, Cache.Framecount, *Font, Keyprefix | Placement.Glyph, Placement.Glyph, Scale, Placement.Cached))
+                {
+                    Placement.Cached = { 0, 0, 0, 0, 0, 0, Noshelf };
+                    Run.Generation = 0;
+                }
+
+                // Pinned for this frame, so the rest of the run can't evict it.
+                if(Placement.Cached.Width) Cache.Atlas.Shelves[Placement.Cached.Shelf].Lastused = Cache.Framecount;
+            }
+
+            // Evictions for the rest of the run may have moved other layouts, not ours.
+            if(Run.Generation) Run.Generation = Cache.Atlas.Generation;
+        }
+
+        // Centred on the line-box, clipped to the element and surface.
+        const auto Originx = int32_t(std::lround((Area.x0 + Area.x1 - Run.Width) * 0.5f)) - Offsetx;
+        const auto Baseline = int32_t(std::lround((Area.y0 + Area.y1 - Run.Ascent - Run.Descent) * 0.5f)) + Run.Ascent - Offsety;
+        const auto Clipx0 = std::max(int32_t(std::floor(Area.x0)) - Offsetx, 0);
+        const auto Clipy0 = std::max(int32_t(std::floor(Area.y0)) - Offsety, 0);
+        const auto Clipx1 = std::min(int32_t(std::ceil(Area.x1)) - Offsetx, Surface.Width);
+        const auto Clipy1 = std::min(int32_t(std::ceil(Area.y1)) - Offsety, Surface.Height);
+
+        for(const auto &Placement : Run.Glyphs)
+        {
+            const auto &Glyph = Placement.Cached;
+            if(!Glyph.Width) continue;
+            Cache.Atlas.Shelves[Glyph.Shelf].Lastused = Cache.Framecount;
+
+            const auto x0 = Originx + Placement.Penx + Glyph.Offsetx, y0 = Baseline + Glyph.Offsety;
+            const auto Left = std::max(x0, Clipx0), Right = std::min(x0 + Glyph.Width, Clipx1);
+            const auto Top = std::max(y0, Clipy0), Bottom = std::min(y0 + Glyph.Height, Clipy1);
+            if(Left >= Right || Top >= Bottom) continue;
+
+            for(int32_t y = Top; y < Bottom; ++y)
+            {
+                const auto Coverage = &Cache.Atlas.Pixels[size_t(Glyph.y + y - y0) * Atlas::Size + Glyph.x + (Left - x0)];
+                Rasterizer::Blendspan(Surface.Pixels + y * Surface.Width + Left, Coverage, Right - Left, Label.Colour);
+            }
+        }
+    }
+
+    void Endframe()
+    {
+        auto &Cache = State();
+        if(++Cache.Framecount % Runlifetime) return;
+        std::erase_if(Cache.Runs, [&](const auto &Item) { return Item.second.Lastused + Runlifetime < Cache.Framecount; });
+    }
+}
@@ -0,0 +1,18 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-04
+    License: MIT
+*/
+
+#pragma once
+#include <Stdinclude.hpp>
+
+// Labels, glyphs are rasterized once into a shared atlas and strings are laid out once per font and size.
+namespace Text
+{
+    // Centred in the area and clipped to it, the offset moves it into the target's coordinate-system.
+    void Drawlabel(Surface_t &Surface, const Attributes::Text &Label, const vec4_t &Area, int32_t Offsetx = 0, int32_t Offsety = 0);
+
+    // Once per frame, drops the layouts that haven't been drawn in a while.
+    void Endframe();
+}
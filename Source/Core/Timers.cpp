@@ -0,0 +1,230 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-06
+    License: MIT
+*/
+
+#include <Stdinclude.hpp>
+#include <Core/Timers.hpp>
+#include <bit>
+
+namespace Timers
+{
+    // 64 slots per level, a timer lives on the level of the highest 6-bit group where its expiry differs from the
+    // current time. So a slot only holds timers due within its span, and everything below it is earlier.
+    constexpr uint32_t Slotbits = 6, Slotcount = 1 << Slotbits;
+    constexpr uint32_t Levels = (64 + Slotbits - 1) / Slotbits;
+    constexpr uint32_t None = UINT32_MAX;
+
+    struct Timer_t
+    {
+        uint64_t Expiry;
+        Element_t *Target;
+        uint32_t Callbackhash, Interval;
+        uint32_t Previous, Next, Generation;
+        uint8_t Level, Slot;
+    };
+    constexpr uint8_t Unlinked = UINT8_MAX;
+
+    // Per context, as the targets point into its node-store.
+    struct State_t
+    {
+        std::vector<Timer_t> Pool{};
+        uint32_t Freelist{ None };
+        std::array<std::array<uint32_t, Slotcount>, Levels> Heads = []()
+        {
+            std::array<std::array<uint32_t, Slotcount>, Levels> Empty;
+            for(auto &Level : Empty) Level.fill(None);
+            return Empty;
+        }();
+        uint64_t Occupied[Levels]{};
+        uint64_t Current{};
+        uint32_t Active{};
+        bool isVirtual{};
+    };
+    static State_t &State() { return Modulestate<State_t>(Activecontext->Modules.Timers); }
+
+    // Start of the span that slot covers, relative to the current time.
+    static uint64_t Boundary(uint32_t Level, uint32_t Slot)
+    {
+        auto &[Pool, Freelist, Heads, Occupied, Current, Active, isVirtual] = State();
+        const auto Shift = Slotbits * (Level + 1);
+        const auto Upper = Shift >= 64 ? 0 : (Current >> Shift) << Shift;
+        return Upper | (uint64_t(Slot) << (Slotbits * Level));
+    }
+
+    static void Link(uint32_t Index)
+    {
+        auto &[Pool, Freelist, Heads, Occupied, Current, Active, isVirtual] = State();
+        auto &Timer = Pool[Index];
+        Timer.Expiry = std::max(Timer.Expiry, Current + 1);
+
+        const auto Level = uint8_t((63 - std::countl_zero(Timer.Expiry ^ Current)) / Slotbits);
+        const auto Slot = uint8_t((Timer.Expiry >> (Slotbits * Level)) & (Slotcount - 1));
+
+        Timer.Level = Level; Timer.Slot = Slot;
+        Timer.Previous = None;
+        Timer.Next = Heads[Level][Slot];
+        if(Timer.Next != None) Pool[Timer.Next].Previous = Index;
+
+        Heads[Level][Slot] = Index;
+        Occupied[Level] |= uint64_t(1) << Slot;
+    }
+    static void Unlink(uint32_t Index)
+    {
+        auto &[Pool, Freelist, Heads, Occupied, Current, Active, isVirtual] = State();
+        auto &Timer = Pool[Index];
+        if(Timer.Previous != None) Pool[Timer.Previous].Next = Timer.Next;
+        else Heads[Timer.Level][Timer.Slot] = Timer.Next;
+        if(Timer.Next != None) Pool[Timer.Next].Previous = Timer.Previous;
+
+        if(Heads[Timer.Level][Timer.Slot] == None) Occupied[Timer.Level] &= ~(uint64_t(1) << Timer.Slot);
+        Timer.Level = Unlinked;
+    }
+    static void Release(uint32_t Index)
+    {
+        auto &[Pool, Freelist, Heads, Occupied, Current, Active, isVirtual] = State();
+        auto &Timer = Pool[Index];
+        Timer.Generation++;
+        Timer.Level = Unlinked;
+        Timer.Next = Freelist;
+        Freelist = Index;
+        Active--;
+    }
+
+    uint64_t Clock()
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void Usevirtualclock()
+    {
+        State().isVirtual = true;
+    }
+
+    Timerid_t Schedule(uint32_t Callbackhash, Element_t &Target, uint32_t Delay, uint32_t Interval)
+    {
+        auto &[Pool, Freelist, Heads, Occupied, Current, Active, isVirtual] = State();
+        // Nothing pending, so the wheel can jump straight to now.
+        if(!Active && !isVirtual) Current = std::max(Current, Clock());
+
+        uint32_t Index = Freelist;
+        if(Index != None) Freelist = Pool[Index].Next;
+        else
+        {
+            Index = uint32_t(Pool.size());
+            Pool.push_back({});
+        }
+
+        auto &Timer = Pool[Index];
+        Timer.Expiry = Current + Delay;
+        Timer.Target = &Target;
+        Timer.Callbackhash = Callbackhash;
+        Timer.Interval = Interval;
+        Link(Index);
+        Active++;
+
+        return uint64_t(Timer.Generation) << 32 | Index;
+    }
+
+    bool Cancel(Timerid_t Timer)
+    {
+        auto &[Pool, Freelist, Heads, Occupied, Current, Active, isVirtual] = State();
+        const auto Index = uint32_t(Timer);
+        if(Index >= Pool.size() || Pool[Index].Generation != uint32_t(Timer >> 32)) return false;
+
+        // Cancelled from its own callback, it's already off the wheel.
+        if(Pool[Index].Level != Unlinked) Unlink(Index);
+        Release(Index);
+        return true;
+    }
+
+    uint32_t Advance(uint64_t Now)
+    {
+        auto &[Pool, Freelist, Heads, Occupied, Current, Active, isVirtual] = State();
+        uint32_t Fired{};
+
+        while(Active)
+        {
+            // The lowest occupied slot is the earliest, nothing before its boundary needs any work.
+            uint32_t Level = 0;
+            while(Level < Levels && !Occupied[Level]) ++Level;
+            if(Level == Levels) break;
+
+            const auto Slot = uint32_t(std::countr_zero(Occupied[Level]));
+            const auto Next = Boundary(Level, Slot);
+            if(Next > Now) break;
+
+            // Drain the slot, the callbacks may add or cancel timers but never add to a slot at or before the current time.
+            Current = Next;
+            while(Heads[Level][Slot] != None)
+            {
+                const auto Index = Heads[Level][Slot];
+                Unlink(Index);
+
+                // Not due yet, so it moves down a level.
+                if(Pool[Index].Expiry > Current)
+                {
+                    Link(Index);
+                    continue;
+                }
+
+                // The pool may grow during the callback, so nothing is held by reference.
+                const auto Generation = Pool[Index].Generation;
+                const auto Timerid = uint64_t(Generation) << 32 | Index;
+                const auto Callback = Activecontext->Namedcallbacks.find(Pool[Index].Callbackhash);
+                const bool Keep = Callback != Activecontext->Namedcallbacks.end() && Callback->second(*Pool[Index].Target, &Timerid);
+                Fired++;
+
+                if(Pool[Index].Generation == Generation)
+                {
+                    if(Keep && Pool[Index].Interval)
+                    {
+                        Pool[Index].Expiry += Pool[Index].Interval;
+                        Link(Index);
+                    }
+                    else Release(Index);
+                }
+            }
+        }
+
+        Current = std::max(Current, Now);
+        return Fired;
+    }
+
+    uint64_t Nextdeadline()
+    {
+        auto &[Pool, Freelist, Heads, Occupied, Current, Active, isVirtual] = State();
+        if(!Active) return UINT64_MAX;
+
+        // Cascading is cheap, but waking for it isn't; the lowest slot has the earliest timer so search it.
+        uint32_t Level = 0;
+        while(Level < Levels && !Occupied[Level]) ++Level;
+        if(Level == Levels) return UINT64_MAX;
+
+        uint64_t Earliest = UINT64_MAX;
+        for(auto Index = Heads[Level][std::countr_zero(Occupied[Level])]; Index != None; Index = Pool[Index].Next)
+            Earliest = std::min(Earliest, Pool[Index].Expiry);
+
+        return Earliest;
+    }
+
+    void Clear()
+    {
+        auto &[Pool, Freelist, Heads, Occupied, Current, Active, isVirtual] = State();
+        for(uint32_t i = 0; i < Pool.size(); ++i)
+        {
+            if(Pool[i].Level != Unlinked) Unlink(i);
+        }
+
+        // The generations are kept so IDs from before the clear stay stale.
+        Freelist = None;
+        for(auto i = uint32_t(Pool.size()); i-- > 0;)
+        {
+            Pool[i].Generation++;
+            Pool[i].Next = Freelist;
+            Freelist = i;
+        }
+        Active = 0;
+    }
+}
@@ -0,0 +1,35 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-06
+    License: MIT
+*/
+
+#pragma once
+#include <Stdinclude.hpp>
+
+// One-shot and repeating timers on a hierarchical wheel, in milliseconds of the steady clock.
+namespace Timers
+{
+    // Index in the low half, generation in the high so stale IDs can't cancel a reused timer.
+    using Timerid_t = uint64_t;
+
+    // Current time in the wheel's unit, the same clock as Platform::Now().
+    uint64_t Clock();
+
+    // Replays advance the wheel by the recorded frame-times, so scheduling counts from the last advance rather than the steady clock.
+    void Usevirtualclock();
+
+    // Delay is from the last advance, the callback is looked up in the context's Namedcallbacks when it fires with the Timerid_t as argument.
+    // Repeating timers keep going until cancelled or the callback returns false.
+    Timerid_t Schedule(uint32_t Callbackhash, Element_t &Target, uint32_t Delay, uint32_t Interval = 0);
+    bool Cancel(Timerid_t Timer);
+
+    // Fire everything due, returns the number of callbacks made.
+    uint32_t Advance(uint64_t Now = Clock());
+
+    // When the earliest timer is due, UINT64_MAX if there are none.
+    uint64_t Nextdeadline();
+
+    // The node-store is being rebuilt, so every target is stale.
+    void Clear();
+}
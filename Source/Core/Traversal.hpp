@@ -0,0 +1,126 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-09-30
+    License: MIT
+*/
+
+#pragma once
+#include <Stdinclude.hpp>
+
+// Iterative walks over the node-store, the storage is sized to the tree up-front so no recursion or heap is needed.
+namespace Traversal
+{
+    constexpr uint32_t None = UINT32_MAX;
+    struct Visit_t { uint32_t Index, Parent; };
+
+    // Fixed-capacity LIFO/FIFO, memory comes from the arena so it's gone by the next frame.
+    template<typename T> struct Stack
+    {
+        uint32_t Size{}, Head{}, Capacity;
+        T *Data;
+
+        explicit Stack(uint32_t Capacity, std::pmr::memory_resource *Resource = &Activecontext->Framearena)
+            : Capacity(Capacity), Data((T *)Resource->allocate(sizeof(T) * std::max(Capacity, 1U), alignof(T))) {}
+
+        bool empty() const { return Head == Size; }
+        void push(T Value) { assert(Size != Capacity); Data[Size++] = Value; }
+        T &top() { return Data[Size - 1]; }
+        T pop() { return Data[--Size]; }
+        T dequeue() { return Data[Head++]; }
+    };
+
+    // Child-slots in declaration order, zero marks an empty slot as the root can't be a child.
+    template<typename Node_t> inline std::array<uint32_t, 4> Children(const Node_t &Node)
+    {
+        return { Node.Child_1, Node.Child_2, Node.Child_3, Node.Child_4 };
+    }
+
+    // Shared forwarding iterator, the range owns the state so range-for doesn't copy the stacks.
+    template<typename Range_t> struct Iterator
+    {
+        Range_t *Owner; bool isValid;
+        Visit_t operator*() const { return Owner->Current; }
+        Iterator &operator++() { isValid = Owner->Next(); return *this; }
+        bool operator!=(const Iterator &) const { return isValid; }
+    };
+
+    // Parents before children, children in declaration order.
+    template<typename Store_t> struct Preorder
+    {
+        Store_t &Nodes; Stack<Visit_t> Pending; Visit_t Current{};
+        explicit Preorder(Store_t &Nodes, uint32_t Root = 0) : Nodes(Nodes), Pending(Nodes.Size)
+        {
+            if(Nodes.Size) Pending.push({ Root, None });
+        }
+
+        bool Next()
+        {
+            if(Pending.empty()) return false;
+            Current = Pending.pop();
+
+            const auto Slots = Children(Nodes[Current.Index]);
+            for(auto Slot = Slots.rbegin(); Slot != Slots.rend(); ++Slot)
+                if(*Slot) Pending.push({ *Slot, Current.Index });
+
+            return true;
+        }
+        Iterator<Preorder> begin() { return { this, Next() }; }
+        Iterator<Preorder> end() { return { this, false }; }
+    };
+
+    // Children before parents, i.e. the order events bubble in.
+    template<typename Store_t> struct Postorder
+    {
+        struct Entry_t { Visit_t Visit; bool isExpanded; };
+        Store_t &Nodes; Stack<Entry_t> Pending; Visit_t Current{};
+        explicit Postorder(Store_t &Nodes, uint32_t Root = 0) : Nodes(Nodes), Pending(Nodes.Size)
+        {
+            if(Nodes.Size) Pending.push({ { Root, None }, false });
+        }
+
+        bool Next()
+        {
+            while(!Pending.empty())
+            {
+                auto Entry = Pending.pop();
+                if(Entry.isExpanded)
+                {
+                    Current = Entry.Visit;
+                    return true;
+                }
+
+                Pending.push({ Entry.Visit, true });
+                const auto Slots = Children(Nodes[Entry.Visit.Index]);
+                for(auto Slot = Slots.rbegin(); Slot != Slots.rend(); ++Slot)
+                    if(*Slot) Pending.push({ { *Slot, Entry.Visit.Index }, false });
+            }
+
+            return false;
+        }
+        Iterator<Postorder> begin() { return { this, Next() }; }
+        Iterator<Postorder> end() { return { this, false }; }
+    };
+
+    // Breadth-first, every node is queued exactly once so the queue never wraps.
+    template<typename Store_t> struct Levelorder
+    {
+        Store_t &Nodes; Stack<Visit_t> Pending; Visit_t Current{};
+        explicit Levelorder(Store_t &Nodes, uint32_t Root = 0) : Nodes(Nodes), Pending(Nodes.Size)
+        {
+            if(Nodes.Size) Pending.push({ Root, None });
+        }
+
+        bool Next()
+        {
+            if(Pending.empty()) return false;
+            Current = Pending.dequeue();
+
+            for(const auto Slot : Children(Nodes[Current.Index]))
+                if(Slot) Pending.push({ Slot, Current.Index });
+
+            return true;
+        }
+        Iterator<Levelorder> begin() { return { this, Next() }; }
+        Iterator<Levelorder> end() { return { this, false }; }
+    };
+}
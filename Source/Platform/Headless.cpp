@@ -0,0 +1,37 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-02
+    License: MIT
+*/
+
+#include <Platform/Platform.hpp>
+
+namespace Platform
+{
+    std::pmr::vector<Event_t> Headless_t::Poll()
+    {
+        std::pmr::vector<Event_t> Events(Pending.begin(), Pending.end(), &Activecontext->Framearena);
+        Pending.clear();
+
+        // Scripted resizes apply immediately, like a window-manager's would.
+        for(const auto &Event : Events)
+            if(Event.Type == Event_t::Resize) Size = Event.Size;
+
+        return Events;
+    }
+
+    void Headless_t::Present(const Surface_t &Surface)
+    {
+        Framebuffer.assign(Surface.Pixels, Surface.Pixels + Surface.Width * Surface.Height);
+        Size = { int16_t(Surface.Width), int16_t(Surface.Height) };
+        Framecount++;
+    }
+
+    // Builds without a windowing-system only get the offscreen backend.
+    #if !defined(_WIN32) && !defined(HAS_X11)
+    std::unique_ptr<Window_t> Createwindow(point2_t)
+    {
+        return nullptr;
+    }
+    #endif
+}
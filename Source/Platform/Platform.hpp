@@ -0,0 +1,112 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-02
+    License: MIT
+*/
+
+#pragma once
+#include <Stdinclude.hpp>
+
+// Everything the host needs from the OS, the core only ever sees Mouseinput_t and Surface_t.
+namespace Platform
+{
+    using Clock_t = std::chrono::steady_clock;
+    using Timepoint_t = Clock_t::time_point;
+    inline Timepoint_t Now() { return Clock_t::now(); }
+
+    // Window-events normalized to what the main-loop cares about.
+    struct Event_t
+    {
+        enum : uint8_t { Mouse, Paint, Resize, Close } Type;
+        Mouseinput_t Input{};
+        point2_t Size{};
+    };
+
+    struct Window_t
+    {
+        point2_t Size{};
+
+        virtual ~Window_t() = default;
+
+        // Non-blocking, the events are allocated from the frame-arena.
+        virtual std::pmr::vector<Event_t> Poll() = 0;
+
+        // Block until there's an event or the deadline passes.
+        virtual void Wait(Timepoint_t Deadline) = 0;
+
+        // Copy the surface to the screen, or wherever the backend keeps it.
+        virtual void Present(const Surface_t &Surface) = 0;
+
+        // Let the window-manager drag the window with the mouse, e.g. from a toolbar.
+        virtual void Beginmove() {}
+    };
+
+    // Offscreen, never blocks and keeps the last presented frame.
+    struct Headless_t : Window_t
+    {
+        std::vector<uint32_t> Framebuffer{};
+        std::vector<Event_t> Pending{};
+        uint64_t Framecount{};
+
+        explicit Headless_t(point2_t Windowsize) { Size = Windowsize; }
+
+        // Scripted input, delivered on the next poll.
+        void Push(const Event_t &Event) { Pending.push_back(Event); }
+
+        std::pmr::vector<Event_t> Poll() override;
+        void Wait(Timepoint_t) override {}
+        void Present(const Surface_t &Surface) override;
+    };
+
+    // Win32 or X11 depending on the build, nullptr if there's no display to connect to.
+    std::unique_ptr<Window_t> Createwindow(point2_t Windowsize);
+
+    // Input traces, every poll is a frame with the time since the last one and the events it returned.
+    // Header_t, then per frame a Frame_t followed by its events; Position is the size for resizes.
+    namespace Trace
+    {
+        struct Header_t { uint32_t Magic; point2_t Windowsize; };
+        struct Frame_t { uint32_t Deltamicroseconds; uint16_t Eventcount; };
+        struct Packedevent_t { uint8_t Type, Pressed, Released; int8_t Wheel; point2_t Position; };
+        static_assert(sizeof(Header_t) == 8 && sizeof(Frame_t) == 8 && sizeof(Packedevent_t) == 8);
+        constexpr uint32_t Magic = Hash::FNV1a_32("Appcore::Trace_v2");
+    }
+
+    // Passes everything through to the real window and appends each frame to the trace as it's polled.
+    struct Recorder_t : Window_t
+    {
+        std::unique_ptr<Window_t> Inner;
+        std::FILE *Filehandle{};
+        std::string Buffer{};
+        Timepoint_t Lastpoll{};
+
+        Recorder_t(std::unique_ptr<Window_t> &&Window, std::string_view Path);
+        ~Recorder_t() override;
+
+        std::pmr::vector<Event_t> Poll() override;
+        void Wait(Timepoint_t Deadline) override { Inner->Wait(Deadline); }
+        void Present(const Surface_t &Surface) override { Inner->Present(Surface); }
+        void Beginmove() override { Inner->Beginmove(); }
+    };
+
+    // Offscreen playback of a trace, as fast as possible or paced like the recording; closes itself at the end.
+    struct Replay_t : Headless_t
+    {
+        std::basic_string<uint8_t> Buffer;
+        size_t Position{ sizeof(Trace::Header_t) };
+        Timepoint_t Nextframe{};
+        bool isRealtime{};
+
+        // The recorded frame-time of the last poll and the total so far, the main-loop uses them instead of the clock.
+        float Deltatime{};
+        uint64_t Elapsedmicroseconds{};
+
+        Replay_t(std::basic_string<uint8_t> &&Trace, point2_t Windowsize, bool Realtime);
+
+        // Each poll is the next recorded frame, in real-time it first sleeps until the frame is due.
+        std::pmr::vector<Event_t> Poll() override;
+    };
+
+    // nullptr if the file is missing or isn't a trace.
+    std::unique_ptr<Replay_t> Loadtrace(std::string_view Path, bool isRealtime);
+}
@@ -0,0 +1,134 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-15
+    License: MIT
+*/
+
+#include <Platform/Platform.hpp>
+#include <Utilities/Filesystem.hpp>
+
+namespace Platform
+{
+    Recorder_t::Recorder_t(std::unique_ptr<Window_t> &&Window, std::string_view Path) : Inner(std::move(Window))
+    {
+        Size = Inner->Size;
+        Trace::Header_t Header{};
+        Header.Magic = Trace::Magic;
+        Header.Windowsize = Size;
+
+        // Recording is best-effort, the session runs either way.
+        Filehandle = std::fopen(std::string(Path).c_str(), "wb");
+        if(Filehandle) std::fwrite(&Header, sizeof(Header), 1, Filehandle);
+    }
+    Recorder_t::~Recorder_t()
+    {
+        if(Filehandle) std::fclose(Filehandle);
+    }
+
+    std::pmr::vector<Event_t> Recorder_t::Poll()
+    {
+        auto Events = Inner->Poll();
+        Size = Inner->Size;
+
+        // The first frame has nothing to measure from.
+        const auto Thispoll = Now();
+        const auto Delta = Lastpoll == Timepoint_t{} ? 0 : std::chrono::duration_cast<std::chrono::microseconds>(Thispoll - Lastpoll).count();
+        Lastpoll = Thispoll;
+
+        Trace::Frame_t Frame{};
+        Frame.Deltamicroseconds = uint32_t(std::min<int64_t>(Delta, UINT32_MAX));
+        Frame.Eventcount = uint16_t(std::min<size_t>(Events.size(), UINT16_MAX));
+        Buffer.assign((const char *)&Frame, sizeof(Frame));
+
+        for(uint16_t i = 0; i < Frame.Eventcount; ++i)
+        {
+            const auto &Event = Events[i];
+            // Value-initialized so the padding is zero too.
+            Trace::Packedevent_t Packed{};
+            Packed.Type = Event.Type;
+            Packed.Pressed = Event.Input.Pressed.Raw;
+            Packed.Released = Event.Input.Released.Raw;
+            Packed.Wheel = Event.Input.Wheel;
+            Packed.Position = Event.Type == Event_t::Resize ? Event.Size : Event.Input.Position;
+            Buffer.append((const char *)&Packed, sizeof(Packed));
+        }
+
+        // Flushed per frame, so a crash or a killed session still leaves a trace up to it.
+        if(Filehandle)
+        {
+            std::fwrite(Buffer.data(), Buffer.size(), 1, Filehandle);
+            std::fflush(Filehandle);
+        }
+
+        return Events;
+    }
+
+    Replay_t::Replay_t(std::basic_string<uint8_t> &&Trace, point2_t Windowsize, bool Realtime) : Headless_t(Windowsize), Buffer(std::move(Trace)), isRealtime(Realtime) {}
+
+    std::pmr::vector<Event_t> Replay_t::Poll()
+    {
+        std::pmr::vector<Event_t> Events(&Activecontext->Framearena);
+
+        // A truncated frame ends the replay like the end of the file does.
+        Trace::Frame_t Frame{};
+        if(Buffer.size() - Position < sizeof(Frame))
+        {
+            Events.push_back({ Event_t::Close });
+            return Events;
+        }
+        std::memcpy(&Frame, Buffer.data() + Position, sizeof(Frame));
+        Position += sizeof(Frame);
+        if(Buffer.size() - Position < Frame.Eventcount * sizeof(Trace::Packedevent_t))
+        {
+            Position = Buffer.size();
+            Events.push_back({ Event_t::Close });
+            return Events;
+        }
+
+        Deltatime = Frame.Deltamicroseconds / 1e6f;
+        Elapsedmicroseconds += Frame.Deltamicroseconds;
+        if(isRealtime)
+        {
+            if(Nextframe == Timepoint_t{}) Nextframe = Now();
+            Nextframe += std::chrono::microseconds(Frame.Deltamicroseconds);
+            std::this_thread::sleep_until(Nextframe);
+        }
+
+        Events.reserve(Frame.Eventcount);
+        for(uint16_t i = 0; i < Frame.Eventcount; ++i)
+        {
+            Trace::Packedevent_t Packed;
+            std::memcpy(&Packed, Buffer.data() + Position, sizeof(Packed));
+            Position += sizeof(Packed);
+
+            Event_t Event{ decltype(Event_t::Type)(Packed.Type) };
+            if(Event.Type == Event_t::Resize)
+            {
+                Event.Size = Packed.Position;
+                Size = Packed.Position;
+            }
+            else
+            {
+                Event.Input.Position = Packed.Position;
+                Event.Input.Pressed.Raw = Packed.Pressed;
+                Event.Input.Released.Raw = Packed.Released;
+                Event.Input.Wheel = Packed.Wheel;
+            }
+            Events.push_back(Event);
+        }
+
+        return Events;
+    }
+
+    std::unique_ptr<Replay_t> Loadtrace(std::string_view Path, bool isRealtime)
+    {
+        auto Buffer = FS::Readfile(Path);
+        Trace::Header_t Header{};
+        if(Buffer.size() < sizeof(Header)) return nullptr;
+
+        std::memcpy(&Header, Buffer.data(), sizeof(Header));
+        if(Header.Magic != Trace::Magic) return nullptr;
+
+        return std::make_unique<Replay_t>(std::move(Buffer), Header.Windowsize, isRealtime);
+    }
+}
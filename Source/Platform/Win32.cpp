@@ -0,0 +1,164 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-09-18
+    License: MIT
+*/
+
+#include <Platform/Platform.hpp>
+
+#if defined(_WIN32)
+namespace Platform
+{
+    struct Win32_t : Window_t
+    {
+        HWND Handle{};
+        BITMAPINFO Surfaceformat{};
+
+        // High-resolution wheels send fractions of a notch, kept until they add up to a whole one.
+        int32_t Wheelremainder{};
+
+        std::pmr::vector<Event_t> Poll() override
+        {
+            std::pmr::vector<Event_t> Events(&Activecontext->Framearena);
+            MSG Event{};
+
+            // Non-blocking polling for messages.
+            while(PeekMessageA(&Event, Handle, NULL, NULL, PM_REMOVE) > 0)
+            {
+                // Process mouse events first as they are the most common.
+                if(Event.message >= WM_MOUSEFIRST && Event.message <= WM_MOUSELAST)
+                {
+                    // Coordinates relative to the window.
+                    Event_t Mouse{ Event_t::Mouse };
+                    Mouse.Input.Position = { int16_t(GET_X_LPARAM(Event.lParam)), int16_t(GET_Y_LPARAM(Event.lParam)) };
+                    Mouse.Input.Pressed.isLeftclicked = Event.message == WM_LBUTTONDOWN;
+                    Mouse.Input.Pressed.isRightclicked = Event.message == WM_RBUTTONDOWN;
+                    Mouse.Input.Pressed.isMiddleclicked = Event.message == WM_MBUTTONDOWN;
+                    Mouse.Input.Released.isLeftclicked = Event.message == WM_LBUTTONUP;
+                    Mouse.Input.Released.isRightclicked = Event.message == WM_RBUTTONUP;
+                    Mouse.Input.Released.isMiddleclicked = Event.message == WM_MBUTTONUP;
+
+                    // Unlike the rest, the wheel is in screen-coordinates.
+                    if(Event.message == WM_MOUSEWHEEL)
+                    {
+                        POINT Point{ GET_X_LPARAM(Event.lParam), GET_Y_LPARAM(Event.lParam) };
+                        ScreenToClient(Handle, &Point);
+                        Mouse.Input.Position = { int16_t(Point.x), int16_t(Point.y) };
+                        Wheelremainder += GET_WHEEL_DELTA_WPARAM(Event.wParam);
+                        const auto Notches = Wheelremainder / WHEEL_DELTA;
+                        Wheelremainder -= Notches * WHEEL_DELTA;
+                        Mouse.Input.Wheel = int8_t(std::clamp(Notches, -127, 127));
+                    }
+
+                    Events.push_back(Mouse);
+                    continue;
+                }
+
+                // If Windows wants us to redraw, we oblige.
+                if(Event.message == WM_PAINT) Events.push_back({ Event_t::Paint });
+
+                // If we should quit, stop without processing the rest of the queue.
+                if(Event.message == WM_SYSCOMMAND && Event.wParam == SC_CLOSE)
+                {
+                    Events.push_back({ Event_t::Close });
+                    return Events;
+                }
+
+                // If we couldn't handle the event, let Windows do it.
+                DispatchMessageA(&Event);
+            }
+
+            // WM_SIZE is sent rather than posted, so compare against the client-area instead.
+            RECT Client{};
+            GetClientRect(Handle, &Client);
+            if(Client.right - Client.left != Size.x || Client.bottom - Client.top != Size.y)
+            {
+                Size = { int16_t(Client.right - Client.left), int16_t(Client.bottom - Client.top) };
+                Events.push_back({ Event_t::Resize, {}, Size });
+            }
+
+            return Events;
+        }
+
+        void Wait(Timepoint_t Deadline) override
+        {
+            const auto Remaining = std::chrono::duration_cast<std::chrono::milliseconds>(Deadline - Now()).count();
+            if(Remaining > 0) MsgWaitForMultipleObjects(0, NULL, FALSE, DWORD(Remaining), QS_ALLINPUT);
+        }
+
+        void Present(const Surface_t &Surface) override
+        {
+            Surfaceformat.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+            Surfaceformat.bmiHeader.biWidth = Surface.Width;
+            Surfaceformat.bmiHeader.biHeight = -Surface.Height;
+            Surfaceformat.bmiHeader.biPlanes = 1;
+            Surfaceformat.bmiHeader.biBitCount = 32;
+            Surfaceformat.bmiHeader.biCompression = BI_RGB;
+
+            // Notify Windows, the window needs repainting.
+            InvalidateRect(Handle, NULL, FALSE);
+
+            // Grab a handle to the window.
+            PAINTSTRUCT Updateinformation{};
+            auto Devicecontext = BeginPaint(Handle, &Updateinformation);
+
+            SetDIBitsToDevice(Devicecontext, 0, 0, Surface.Width, Surface.Height, 0, 0, 0, Surface.Height,
+                              Surface.Pixels, &Surfaceformat, DIB_RGB_COLORS);
+
+            // Notify Windows, we are done painting.
+            EndPaint(Handle, &Updateinformation);
+        }
+
+        void Beginmove() override
+        {
+            POINT Point;
+            ReleaseCapture();
+            GetCursorPos(&Point);
+            SendMessageA(Handle, WM_NCLBUTTONDOWN, HTCAPTION, MAKEWPARAM(Point.x, Point.y));
+        }
+    };
+
+    // Create a centred window chroma-keyed on 0xFFFFFF.
+    std::unique_ptr<Window_t> Createwindow(point2_t Windowsize)
+    {
+        RECT Desktop{};
+        SystemParametersInfoA(SPI_GETWORKAREA, 0, &Desktop, 0);
+
+        // Register the window.
+        WNDCLASSEXA Windowclass{};
+        Windowclass.lpfnWndProc = DefWindowProc;
+        Windowclass.cbSize = sizeof(WNDCLASSEXA);
+        Windowclass.lpszClassName = "Desktop_cpp";
+        Windowclass.hInstance = GetModuleHandleA(NULL);
+        Windowclass.hCursor = LoadCursor(NULL, IDC_ARROW);
+        Windowclass.style = CS_HREDRAW | CS_VREDRAW | CS_OWNDC;
+        if(NULL == RegisterClassExA(&Windowclass)) return nullptr;
+
+        // Pre-calculate the window-offsets.
+        const auto Desktopwidth = Desktop.right - Desktop.left;
+        const auto Desktopheight = Desktop.bottom - Desktop.top;
+        const auto Desktopcenterx = Desktop.left + Desktopwidth * 0.5f;
+        const auto Desktopcentery = Desktop.top + Desktopheight * 0.5f;
+
+        // HACK(tcn): We create the window with a size of 0 to prevent rendering of the first frame (black).
+        auto Windowhandle = CreateWindowExA(WS_EX_LAYERED | WS_EX_APPWINDOW | WS_EX_TOPMOST, "Desktop_cpp", NULL, WS_POPUP, 0, 0, 0, 0, NULL, NULL, Windowclass.hInstance, NULL);
+        if(Windowhandle == 0) return nullptr;
+
+        // Use a pixel-value of {0xFF, 0xFF, 0xFF} to mean transparent, because we should not use pure white anyway.
+        if(FALSE == SetLayeredWindowAttributes(Windowhandle, 0xFFFFFF, 0, LWA_COLORKEY)) return nullptr;
+
+        // Resize the window to the requested size.
+        SetWindowPos(Windowhandle, NULL,
+                     std::lround(Desktopcenterx - Windowsize.x * 0.5),
+                     std::lround(Desktopcentery - Windowsize.y * 0.5),
+                     Windowsize.x, Windowsize.y,
+                     SWP_NOSENDCHANGING);
+        ShowWindow(Windowhandle, SW_SHOWNORMAL);
+
+        auto Window = std::make_unique<Win32_t>();
+        Window->Handle = Windowhandle;
+        Window->Size = Windowsize;
+        return Window;
+    }
+}
+#endif
@@ -0,0 +1,192 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-02
+    License: MIT
+*/
+
+#include <Platform/Platform.hpp>
+
+#if !defined(_WIN32) && defined(HAS_X11)
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <poll.h>
+
+namespace Platform
+{
+    struct X11_t : Window_t
+    {
+        Display *Connection{};
+        ::Window Handle{};
+        GC Context{};
+        Atom Deletewindow{}, Moveresize{};
+        point2_t Cursor{};
+
+        ~X11_t() override
+        {
+            if(Context) XFreeGC(Connection, Context);
+            if(Handle) XDestroyWindow(Connection, Handle);
+            XCloseDisplay(Connection);
+        }
+
+        std::pmr::vector<Event_t> Poll() override
+        {
+            std::pmr::vector<Event_t> Events(&Activecontext->Framearena);
+            XEvent Event{};
+
+            while(XPending(Connection))
+            {
+                XNextEvent(Connection, &Event);
+
+                // Process mouse events first as they are the most common.
+                if(Event.type == MotionNotify)
+                {
+                    Cursor = { int16_t(Event.xmotion.x_root), int16_t(Event.xmotion.y_root) };
+                    Event_t Mouse{ Event_t::Mouse };
+                    Mouse.Input.Position = { int16_t(Event.xmotion.x), int16_t(Event.xmotion.y) };
+                    Events.push_back(Mouse);
+                    continue;
+                }
+                if(Event.type == ButtonPress || Event.type == ButtonRelease)
+                {
+                    // The wheel is buttons 4 and 5, pressed and released per notch.
+                    const bool isWheel = Event.xbutton.button == Button4 || Event.xbutton.button == Button5;
+                    if(isWheel && Event.type == ButtonRelease) continue;
+
+                    Cursor = { int16_t(Event.xbutton.x_root), int16_t(Event.xbutton.y_root) };
+                    Event_t Mouse{ Event_t::Mouse };
+                    Mouse.Input.Position = { int16_t(Event.xbutton.x), int16_t(Event.xbutton.y) };
+                    auto &State = Event.type == ButtonPress ? Mouse.Input.Pressed : Mouse.Input.Released;
+                    State.isLeftclicked = Event.xbutton.button == Button1;
+                    State.isMiddleclicked = Event.xbutton.button == Button2;
+                    State.isRightclicked = Event.xbutton.button == Button3;
+                    if(isWheel) Mouse.Input.Wheel = Event.xbutton.button == Button4 ? 1 : -1;
+
+                    Events.push_back(Mouse);
+                    continue;
+                }
+
+                if(Event.type == Expose && Event.xexpose.count == 0) Events.push_back({ Event_t::Paint });
+
+                if(Event.type == ConfigureNotify && (Event.xconfigure.width != Size.x || Event.xconfigure.height != Size.y))
+                {
+                    Size = { int16_t(Event.xconfigure.width), int16_t(Event.xconfigure.height) };
+                    Events.push_back({ Event_t::Resize, {}, Size });
+                }
+
+                // If we should quit, stop without processing the rest of the queue.
+                if(Event.type == ClientMessage && Atom(Event.xclient.data.l[0]) == Deletewindow)
+                {
+                    Events.push_back({ Event_t::Close });
+                    return Events;
+                }
+            }
+
+            return Events;
+        }
+
+        void Wait(Timepoint_t Deadline) override
+        {
+            XFlush(Connection);
+            if(XPending(Connection)) return;
+
+            const auto Remaining = std::chrono::duration_cast<std::chrono::milliseconds>(Deadline - Now()).count();
+            if(Remaining <= 0) return;
+
+            pollfd Descriptor{ ConnectionNumber(Connection), POLLIN, 0 };
+            poll(&Descriptor, 1, int(Remaining));
+        }
+
+        // NOTE(tcn): Plain XPutImage, MIT-SHM would save a copy but doesn't work over the network.
+        void Present(const Surface_t &Surface) override
+        {
+            XImage Image{};
+            Image.width = Surface.Width;
+            Image.height = Surface.Height;
+            Image.format = ZPixmap;
+            Image.data = (char *)Surface.Pixels;
+            Image.byte_order = LSBFirst;
+            Image.bitmap_unit = 32;
+            Image.bitmap_bit_order = LSBFirst;
+            Image.bitmap_pad = 32;
+            Image.depth = 24;
+            Image.bytes_per_line = Surface.Width * sizeof(uint32_t);
+            Image.bits_per_pixel = 32;
+            Image.red_mask = 0xFF0000;
+            Image.green_mask = 0x00FF00;
+            Image.blue_mask = 0x0000FF;
+            if(!XInitImage(&Image)) return;
+
+            XPutImage(Connection, Handle, Context, &Image, 0, 0, 0, 0, Surface.Width, Surface.Height);
+            XFlush(Connection);
+        }
+
+        // Hand the drag over to the window-manager, same as clicking a titlebar.
+        void Beginmove() override
+        {
+            XUngrabPointer(Connection, CurrentTime);
+
+            XEvent Event{};
+            Event.xclient.type = ClientMessage;
+            Event.xclient.window = Handle;
+            Event.xclient.message_type = Moveresize;
+            Event.xclient.format = 32;
+            Event.xclient.data.l[0] = Cursor.x;
+            Event.xclient.data.l[1] = Cursor.y;
+            Event.xclient.data.l[2] = 8; // _NET_WM_MOVERESIZE_MOVE
+            Event.xclient.data.l[3] = Button1;
+            Event.xclient.data.l[4] = 1;
+
+            XSendEvent(Connection, DefaultRootWindow(Connection), False,
+                       SubstructureRedirectMask | SubstructureNotifyMask, &Event);
+            XFlush(Connection);
+        }
+    };
+
+    // Create a centred, undecorated window.
+    std::unique_ptr<Window_t> Createwindow(point2_t Windowsize)
+    {
+        const auto Connection = XOpenDisplay(nullptr);
+        if(!Connection) return nullptr;
+
+        auto Window = std::make_unique<X11_t>();
+        Window->Connection = Connection;
+        Window->Size = Windowsize;
+
+        // Only 24-bit TrueColor matches our surface without conversion.
+        XVisualInfo Visual{};
+        const auto Screen = DefaultScreen(Connection);
+        if(!XMatchVisualInfo(Connection, Screen, 24, TrueColor, &Visual)) return nullptr;
+
+        // Pre-calculate the window-offsets.
+        const auto Desktopcenterx = DisplayWidth(Connection, Screen) * 0.5f;
+        const auto Desktopcentery = DisplayHeight(Connection, Screen) * 0.5f;
+
+        XSetWindowAttributes Attributes{};
+        Attributes.background_pixel = 0xFFFFFF;
+        Attributes.colormap = XCreateColormap(Connection, RootWindow(Connection, Screen), Visual.visual, AllocNone);
+        Attributes.event_mask = ExposureMask | StructureNotifyMask | PointerMotionMask | ButtonPressMask | ButtonReleaseMask;
+
+        Window->Handle = XCreateWindow(Connection, RootWindow(Connection, Screen),
+                                       std::lround(Desktopcenterx - Windowsize.x * 0.5),
+                                       std::lround(Desktopcentery - Windowsize.y * 0.5),
+                                       Windowsize.x, Windowsize.y, 0, Visual.depth, InputOutput, Visual.visual,
+                                       CWBackPixel | CWColormap | CWEventMask, &Attributes);
+        if(!Window->Handle) return nullptr;
+        Window->Context = XCreateGC(Connection, Window->Handle, 0, nullptr);
+
+        // Ask the window-manager for a popup without decorations, same as WS_POPUP.
+        const unsigned long Motifhints[5]{ 2, 0, 0, 0, 0 }; // Flags = MWM_HINTS_DECORATIONS, Decorations = 0
+        const auto Hintsatom = XInternAtom(Connection, "_MOTIF_WM_HINTS", False);
+        XChangeProperty(Connection, Window->Handle, Hintsatom, Hintsatom, 32, PropModeReplace, (unsigned char *)&Motifhints, 5);
+
+        // Get notified instead of killed when the user closes the window.
+        Window->Deletewindow = XInternAtom(Connection, "WM_DELETE_WINDOW", False);
+        Window->Moveresize = XInternAtom(Connection, "_NET_WM_MOVERESIZE", False);
+        XSetWMProtocols(Connection, Window->Handle, &Window->Deletewindow, 1);
+
+        XMapWindow(Connection, Window->Handle);
+        XFlush(Connection);
+        return Window;
+    }
+}
+#endif
@@ -10,48 +10,120 @@
 #pragma warning(push, 0)
 
 // Standard-library includes.
+#include <memory_resource>
 #include <unordered_map>
 #include <functional>
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <chrono>
 #include <memory>
 #include <string>
 #include <thread>
+#include <variant>
+#include <vector>
+#include <atomic>
 #include <array>
-#include <any>
+#include <cmath>
 
 // Platform-library includes.
+#if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN
-#include <ObjIdl.h>
-#include <gdiplus.h>
 #include <windows.h>
 #include <windowsx.h>
 #undef min
 #undef max
+#endif
 
-// External-library includes.
-#include <pugixml.hpp>
+// SIMD is optional, SSE2 is the baseline on x64.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAS_SSE2
+#endif
 
 // Restore warnings.
 #pragma warning(pop)
 
 // Common-library includes.
 #include <Utilities/FNV1Hash.hpp>
+#include <Utilities/Assetcache.hpp>
+#include <Utilities/Arena.hpp>
+#include <Utilities/Flatmap.hpp>
 
 // Extensions to the language.
 using namespace std::string_literals;
 
-// Vertex and sub-pixel coordinate-system, could probably go down to half-precision floats.
-using point4_t = struct { union {  struct { int16_t x0, y0, x1, y1; }; int16_t Raw[4]; }; };
-using vec4_t = struct { union {  struct { float x0, y0, x1, y1; }; float Raw[4]; }; };
-using point3_t = struct { union { struct { int16_t x, y, z; }; int16_t Raw[3]; }; };
-using point2_t = struct { union { struct { int16_t x, y; }; int16_t Raw[2]; }; };
-using vec3_t = struct { union { struct { float x, y, z; }; float Raw[3]; }; };
-using vec2_t = struct { union { struct { float x, y; }; float Raw[2]; }; };
+// Portable _byteswap_ulong, compilers recognize the pattern.
+constexpr uint32_t Byteswap(uint32_t Value)
+{
+    return (Value >> 24) | ((Value >> 8) & 0xFF00) | ((Value << 8) & 0xFF0000) | (Value << 24);
+}
+
+// Vertex and sub-pixel coordinate-system, also the fixed-point storage for areas.
+struct point4_t { union {  struct { int16_t x0, y0, x1, y1; }; int16_t Raw[4]; }; };
+struct vec4_t { union {  struct { float x0, y0, x1, y1; }; float Raw[4]; }; };
+struct point3_t { union { struct { int16_t x, y, z; }; int16_t Raw[3]; }; };
+struct point2_t { union { struct { int16_t x, y; }; int16_t Raw[2]; }; };
+struct vec3_t { union { struct { float x, y, z; }; float Raw[3]; }; };
+struct vec2_t { union { struct { float x, y; }; float Raw[2]; }; };
+
+// Pixels with two fraction-bits, a quarter-pixel over [-8192, 8192); FP16 only has whole pixels past 1024.
+namespace Fixedpoint
+{
+    constexpr float Scale = 4.0f;
+    constexpr int32_t Fractionbits = 2;
+
+    // Rounded to nearest and saturated, the result is in the low 64 bits.
+    #if defined(HAS_SSE2)
+    inline __m128i Pack(__m128 Value)
+    {
+        const auto Scaled = _mm_cvtps_epi32(_mm_mul_ps(Value, _mm_set1_ps(Scale)));
+        return _mm_packs_epi32(Scaled, Scaled);
+    }
+    #endif
+
+    inline point4_t Pack(const vec4_t &Value)
+    {
+        point4_t Result;
+        #if defined(HAS_SSE2)
+        _mm_storel_epi64((__m128i *)Result.Raw, Pack(_mm_loadu_ps(Value.Raw)));
+        #else
+        for(int i = 0; i < 4; ++i) Result.Raw[i] = int16_t(std::clamp(std::lrint(Value.Raw[i] * Scale), long(INT16_MIN), long(INT16_MAX)));
+        #endif
+        return Result;
+    }
+    inline vec4_t Unpack(const point4_t &Value)
+    {
+        vec4_t Result;
+        #if defined(HAS_SSE2)
+        const auto Packed = _mm_loadl_epi64((const __m128i *)Value.Raw);
+        const auto Widened = _mm_srai_epi32(_mm_unpacklo_epi16(Packed, Packed), 16);
+        _mm_storeu_ps(Result.Raw, _mm_mul_ps(_mm_cvtepi32_ps(Widened), _mm_set1_ps(1.0f / Scale)));
+        #else
+        for(int i = 0; i < 4; ++i) Result.Raw[i] = Value.Raw[i] / Scale;
+        #endif
+        return Result;
+    }
+}
+
+// Resolved element areas, COMPACT_GEOMETRY builds store them as fixed-point so Element_t shrinks by 8 bytes.
+// Both convert to and from vec4_t, so code that works on a copy doesn't need to know which it is.
+#if defined(HAS_COMPACTGEOMETRY)
+struct Area_t
+{
+    point4_t Packed{};
+
+    Area_t() = default;
+    Area_t(const vec4_t &Area) : Packed(Fixedpoint::Pack(Area)) {}
+    operator vec4_t() const { return Fixedpoint::Unpack(Packed); }
+};
+#else
+using Area_t = vec4_t;
+#endif
 
 // Elements provide the core of the UI.
-using Elementstate_t = union
+union Elementstate_t
 {
     struct
     {
@@ -62,19 +134,20 @@ using Elementstate_t = union
     };
     uint8_t Raw;
 };
+using Nodeid_t = uint32_t;
 struct Element_t
 {
     // Region of the screen this element occupies.
-    vec4_t Area{};
+    Area_t Area{};
 
     // Packed element info.
     struct
     {
         // ID of this elements children.
-        uint8_t Child_1;
-        uint8_t Child_2;
-        uint8_t Child_3;
-        uint8_t Child_4;
+        Nodeid_t Child_1;
+        Nodeid_t Child_2;
+        Nodeid_t Child_3;
+        Nodeid_t Child_4;
 
         // Display information.
         Elementstate_t State;
@@ -88,10 +161,36 @@ struct Element_t
 
 constexpr size_t a = sizeof(Element_t);
 
-// Classes are a set of attributes.
-using Class_t = std::unordered_map<uint32_t, std::any>;
+// Classes are a set of attributes, allocated from the blueprint's arena.
+namespace Attributes
+{
+    // Radius and Borderwidth are in pixels and may be fractional, the edges are anti-aliased.
+    struct Background { uint32_t Colour, Border; float Radius, Borderwidth; std::string_view Image; };
+
+    // A label centred in the element, a Size of zero scales it with the element's height.
+    struct Text { std::string_view String, Font; float Size; uint32_t Colour; };
+
+    // Makes the element a scrolling list of Count copies of its first child, only the visible ones plus Overscan on either side exist.
+    // onBind is looked up in the context's Namedcallbacks when a copy is given another item, with the item's index as argument.
+    // Every class has one, isEnabled is only set by declaring it as a list may start out empty.
+    struct List { uint32_t Count, Overscan, onBind; bool isEnabled; };
+}
+using Attribute_t = std::variant<vec2_t, Attributes::Background, Attributes::Text, Attributes::List>;
+using Class_t = Hashmap::pmr::Flat<Attribute_t>;
 using Callback_t = std::function<bool(struct Element_t &This, const void *Argument)>;
 
+// Upper bounds for the blueprint, classes and callbacks are referenced by 8-bit IDs.
+constexpr uint32_t Maxnodes = 1 << 17;
+constexpr uint32_t Maxclasses = UINT8_MAX;
+constexpr uint32_t Maxcallbacks = UINT8_MAX;
+
+// Normalized mouse-input, the buttons use the click-bits of Elementstate_t.
+// Wheel is in notches, positive when rolled away from the user.
+struct Mouseinput_t { point2_t Position; Elementstate_t Pressed, Released; int8_t Wheel; };
+
+// 32-bit BGRA pixels, top-down.
+struct Surface_t { uint32_t *Pixels; int32_t Width, Height; };
+
 // Simple class for tracking the used size.
 template<typename T, uint32_t Maxsize>
 struct Array
@@ -106,9 +205,79 @@ struct Array
     }
 };
 
+// Everything one UI owns, contexts share no mutable state so each can be driven from its own thread; see Core/Context.cpp.
+struct Context_t
+{
+    // Backing memory for the blueprint and for temporaries that only live for a frame.
+    // Declared first so the classes, which allocate from it, are destroyed before it.
+    Arena::Bump Parsearena{};
+    Arena::Bump Framearena{};
+
+    // The blueprint, heap-allocated with the context as the stores are too large for the stack.
+    Array<Element_t, Maxnodes> Nodetree;
+    Array<Class_t, Maxclasses> Classes;
+    Array<Callback_t, Maxcallbacks> Callbacks;
+
+    // Callbacks available to the blueprint by name, registering one from inside a callback may move the running one.
+    Hashmap::Flat<Callback_t> Namedcallbacks;
+
+    // Set by the file-watcher thread in developer builds.
+    std::atomic<bool> shouldReload{ false };
+    bool isDirty{ true };
+    uint32_t Errorno{};
+
+    // Reused between frames, a drag grows it in steps rather than reallocating per pixel.
+    Surface_t Surface{};
+    std::unique_ptr<uint32_t[]> Pixels{};
+    size_t Pixelcapacity{};
+    void Resizesurface(point2_t Size);
+
+    // Private to the modules, created on first use; e.g. the tweens and timers, which point into this Nodetree.
+    struct { std::shared_ptr<void> Animation, Timers, Layers, Layout, Input, Lists, Text; } Modules;
+
+    // The calling thread works on this context until the guard goes out of scope, the previous one is restored after.
+    struct Bind_t
+    {
+        Context_t *Previous;
+        explicit Bind_t(Context_t &Context);
+        ~Bind_t();
+    };
+};
+
+// The context the calling thread is driving, see Context_t::Bind_t.
+extern thread_local Context_t *Activecontext;
+
+// A module's slot in Context_t::Modules, default-constructed on first use.
+template<typename T> T &Modulestate(std::shared_ptr<void> &Slot)
+{
+    if(!Slot) [[unlikely]] Slot = std::make_shared<T>();
+    return *static_cast<T *>(Slot.get());
+}
+
 // Parse the markup into arrays.
 bool Parseblueprint(vec4_t Boundingbox,
                     std::string_view Filepath,
-                    Array<Element_t, UINT8_MAX> *Nodes,
-                    Array<Class_t, UINT8_MAX> *Properties,
-                    Array<Callback_t, UINT8_MAX> *Callbacks);
+                    Array<Element_t, Maxnodes> *Nodes,
+                    Array<Class_t, Maxclasses> *Properties,
+                    Array<Callback_t, Maxcallbacks> *Callbacks);
+
+// Resolve the areas of the nodes from their classes.
+void Layoutnodes(vec4_t Boundingbox,
+                 Array<Element_t, Maxnodes> *Nodes,
+                 Array<Class_t, Maxclasses> *Properties);
+
+// Move the last layout into a new bounding box, e.g. on resize; falls back to Layoutnodes for another store.
+void Relayoutnodes(vec4_t Boundingbox,
+                   Array<Element_t, Maxnodes> *Nodes,
+                   Array<Class_t, Maxclasses> *Properties);
+
+// Update the element-states and notify the elements whose state changed, an onState returning true stops it reaching the ones below.
+// The wheel scrolls the innermost list under the pointer that can still move.
+void Processinput(const Mouseinput_t &Input,
+                  Array<Element_t, Maxnodes> &Nodes,
+                  Array<Callback_t, Maxcallbacks> &Callbacks);
+
+// Rasterize the nodes in order.
+void Rendernodes(Surface_t &Surface,
+                 Array<Element_t, Maxnodes> &Nodes,
+                 Array<Class_t, Maxclasses> &Properties);
@@ -0,0 +1,136 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-09-29
+    License: MIT
+*/
+
+#pragma once
+#include <memory_resource>
+#include <string_view>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace Arena
+{
+    // Chunked bump-allocator, deallocation is a no-op and Reset() rewinds without returning memory upstream.
+    struct Bump : std::pmr::memory_resource
+    {
+        struct Chunk_t { Chunk_t *Next; size_t Size; };
+        std::pmr::memory_resource *Upstream;
+        Chunk_t *Head{}, *Current{};
+        uint8_t *Cursor{}, *Limit{};
+        size_t Chunksize;
+
+        explicit Bump(size_t Chunksize = 64 * 1024, std::pmr::memory_resource *Upstream = std::pmr::new_delete_resource())
+            : Upstream(Upstream), Chunksize(Chunksize) {}
+        ~Bump()
+        {
+            while (Head)
+            {
+                const auto Next = Head->Next;
+                Upstream->deallocate(Head, Head->Size, alignof(std::max_align_t));
+                Head = Next;
+            }
+        }
+        Bump(const Bump &) = delete;
+        Bump &operator=(const Bump &) = delete;
+
+        // Everything allocated so far is invalidated, the chunks are kept for the next round.
+        void Reset()
+        {
+            Current = Head;
+            Cursor = Head ? (uint8_t *)(Head + 1) : nullptr;
+            Limit = Head ? (uint8_t *)Head + Head->Size : nullptr;
+        }
+
+        // Bytes handed out from all chunks up to and including the current one.
+        size_t Used() const
+        {
+            size_t Total{};
+            for (auto Chunk = Head; Chunk; Chunk = Chunk->Next)
+            {
+                if (Chunk == Current) return Total + (Cursor - (uint8_t *)(Chunk + 1));
+                Total += Chunk->Size - sizeof(Chunk_t);
+            }
+            return Total;
+        }
+        size_t Capacity() const
+        {
+            size_t Total{};
+            for (auto Chunk = Head; Chunk; Chunk = Chunk->Next) Total += Chunk->Size - sizeof(Chunk_t);
+            return Total;
+        }
+
+        // Helpers for data that is not stored in a container.
+        template <typename T, typename ... Args> T *Create(Args&& ... Arguments)
+        {
+            return ::new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(Arguments)...);
+        }
+        std::string_view Copy(std::string_view String)
+        {
+            if (String.empty()) return {};
+            const auto Buffer = (char *)allocate(String.size(), 1);
+            std::memcpy(Buffer, String.data(), String.size());
+            return { Buffer, String.size() };
+        }
+
+    protected:
+        void *do_allocate(size_t Size, size_t Alignment) override
+        {
+            while (true)
+            {
+                if (Cursor)
+                {
+                    const auto Aligned = (uint8_t *)((uintptr_t(Cursor) + Alignment - 1) & ~uintptr_t(Alignment - 1));
+                    if (Aligned + Size <= Limit)
+                    {
+                        Cursor = Aligned + Size;
+                        return Aligned;
+                    }
+                }
+
+                // Reuse the chunks from before the last reset, skipping the ones too small for this until the next reset.
+                // Otherwise a frame that allocates in a different order than the last would keep growing the arena.
+                auto Reusable = Current ? Current->Next : nullptr;
+                while (Reusable && Reusable->Size - sizeof(Chunk_t) < Size + Alignment) Reusable = Reusable->Next;
+                if (Reusable)
+                {
+                    Current = Reusable;
+                    Cursor = (uint8_t *)(Current + 1);
+                    Limit = (uint8_t *)Current + Current->Size;
+                    continue;
+                }
+
+                // Otherwise we need to grow, the new chunk is linked after the current one.
+                const auto Newsize = std::max(Chunksize, Size + Alignment + sizeof(Chunk_t));
+                const auto Chunk = (Chunk_t *)Upstream->allocate(Newsize, alignof(std::max_align_t));
+                Chunk->Size = Newsize;
+
+                if (Current)
+                {
+                    Chunk->Next = Current->Next;
+                    Current->Next = Chunk;
+                }
+                else
+                {
+                    Chunk->Next = Head;
+                    Head = Chunk;
+                }
+
+                Current = Chunk;
+                Cursor = (uint8_t *)(Chunk + 1);
+                Limit = (uint8_t *)Chunk + Newsize;
+            }
+        }
+        void do_deallocate(void *, size_t, size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource &Other) const noexcept override
+        {
+            return this == &Other;
+        }
+    };
+
+    // pmr-containers just need the resource, this is for the odd STL type that wants an allocator.
+    template <typename T> using Allocator_t = std::pmr::polymorphic_allocator<T>;
+}
@@ -0,0 +1,276 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-09-28
+    License: MIT
+*/
+
+#pragma once
+#include "FNV1Hash.hpp"
+#include "Filesystem.hpp"
+#include <initializer_list>
+#include <memory_resource>
+#include <system_error>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <ctime>
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+// Content-addressed storage for derived artifacts, e.g. compiled blueprints and decoded images.
+namespace Assetcache
+{
+    #if !defined(CACHEPATH)
+    #define CACHEPATH "./Cache"
+    #endif
+
+    // Upper bound for the artifacts on disk, least recently used are evicted first.
+    #if !defined(CACHESIZE)
+    #define CACHESIZE (64 * 1024 * 1024)
+    #endif
+
+    // Tools that need to measure the uncached path can opt out.
+    inline bool isEnabled{ true };
+
+    // Time and size are checked first, the content is only hashed if they differ.
+    // Times are nanoseconds since the Unix epoch, Checked is when the content was hashed.
+    struct Fingerprint_t { uint64_t Contenthash, Modified, Checked, Size; };
+    struct Entry_t { uint64_t Sourcekey; Fingerprint_t Source; uint32_t Kind, Blobsize; uint64_t Lastused; };
+    static_assert(sizeof(Entry_t) == 56, "The index is written as-is, so no padding.");
+
+    namespace Internal
+    {
+        constexpr uint32_t Indexmagic = Hash::FNV1a_32("Assetcache::Index_v2");
+        constexpr char Indexpath[] = CACHEPATH "/Index.bin";
+
+        // NOTE(tcn): The index is shared by all callers, so we serialize access.
+        inline std::vector<Entry_t> Entries{};
+        inline bool isLoaded{ false }, isDirty{ false };
+        inline uint32_t Tempcounter{};
+        inline std::mutex Lock{};
+
+        // Coarse timestamps can't tell two edits apart, so a file modified this close to its hashing is hashed again.
+        constexpr uint64_t Racywindow = 1000000000;
+        inline uint64_t Now()
+        {
+            return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+        }
+        inline uint32_t Processid()
+        {
+            #if defined(_WIN32)
+            return uint32_t(_getpid());
+            #else
+            return uint32_t(getpid());
+            #endif
+        }
+
+        // Artifacts are named by what they were derived from, so identical sources share a blob.
+        inline uint64_t Blobkey(const Entry_t &Entry)
+        {
+            const uint64_t Key[2]{ Entry.Source.Contenthash, Entry.Kind };
+            return Hash::FNV1a_64(Key, sizeof(Key));
+        }
+
+        // Formatted on the stack, a cache-hit shouldn't need the heap.
+        struct Blobpath_t { char String[sizeof(CACHEPATH) + 22]; };
+        inline Blobpath_t Blobpath(const Entry_t &Entry)
+        {
+            Blobpath_t Path;
+            std::snprintf(Path.String, sizeof(Path.String), "%s/%016llX.bin", CACHEPATH, (unsigned long long)Blobkey(Entry));
+            return Path;
+        }
+
+        // Write to a temporary file and rename it over the target, readers never see partial files.
+        // Like the blob paths, the name is formatted on the stack so storing an artifact needs no heap.
+        inline bool Writeatomic(std::string_view Path, std::initializer_list<std::basic_string_view<uint8_t>> Parts)
+        {
+            // Other processes may share the directory, so the name is unique to the writer.
+            char Temporary[sizeof(Blobpath_t::String) + 24];
+            std::snprintf(Temporary, sizeof(Temporary), "%.*s.%u.%u.tmp", int(Path.size()), Path.data(), Processid(), Tempcounter++);
+
+            // The directory only needs creating on the first write.
+            auto Filehandle = std::fopen(Temporary, "wb");
+            if (!Filehandle)
+            {
+                std::error_code Error{};
+                std::filesystem::create_directories(CACHEPATH, Error);
+                Filehandle = std::fopen(Temporary, "wb");
+                if (!Filehandle) return false;
+            }
+
+            bool Result{ true };
+            for (const auto &Part : Parts)
+                if (!Part.empty()) Result &= std::fwrite(Part.data(), Part.size(), 1, Filehandle) == 1;
+            Result &= std::fclose(Filehandle) == 0;
+
+            #if defined(_WIN32)
+            Result = Result && MoveFileExA(Temporary, Path.data(), MOVEFILE_REPLACE_EXISTING);
+            #else
+            Result = Result && std::rename(Temporary, Path.data()) == 0;
+            #endif
+
+            if (!Result) std::remove(Temporary);
+            return Result;
+        }
+
+        inline void Loadindex()
+        {
+            if (isLoaded) return;
+            isLoaded = true;
+
+            const auto Buffer = FS::Readfile(Indexpath);
+            if (Buffer.size() < sizeof(uint32_t) * 2) return;
+
+            uint32_t Magic, Count;
+            std::memcpy(&Magic, Buffer.data(), sizeof(uint32_t));
+            std::memcpy(&Count, Buffer.data() + sizeof(uint32_t), sizeof(uint32_t));
+            if (Magic != Indexmagic || Buffer.size() != sizeof(uint32_t) * 2 + Count * sizeof(Entry_t)) return;
+
+            Entries.resize(Count);
+            std::memcpy(Entries.data(), Buffer.data() + sizeof(uint32_t) * 2, Count * sizeof(Entry_t));
+        }
+        inline void Saveindex()
+        {
+            const uint32_t Header[2]{ Indexmagic, uint32_t(Entries.size()) };
+            Writeatomic(Indexpath, { { (const uint8_t *)Header, sizeof(Header) },
+                                     { (const uint8_t *)Entries.data(), Entries.size() * sizeof(Entry_t) } });
+            isDirty = false;
+        }
+
+        // Cache-hits only update the recency, which is written with the next change or at exit.
+        inline struct Flusher_t
+        {
+            ~Flusher_t()
+            {
+                std::scoped_lock Guard(Lock);
+                if (isDirty) Saveindex();
+            }
+        } Flusher{};
+
+        // Drop an entry, the blob is only deleted if no other entry shares it.
+        inline void Evict(size_t Index)
+        {
+            const auto Path = Blobpath(Entries[Index]);
+            const auto Key = Blobkey(Entries[Index]);
+            Entries.erase(Entries.begin() + Index);
+
+            if (std::none_of(Entries.begin(), Entries.end(), [&](const auto &Entry) { return Blobkey(Entry) == Key; }))
+                std::remove(Path.String);
+        }
+        inline void Trim()
+        {
+            while (true)
+            {
+                uint64_t Total{};
+                for (const auto &Entry : Entries) Total += Entry.Blobsize;
+                if (Total <= CACHESIZE || Entries.empty()) return;
+
+                const auto Oldest = std::min_element(Entries.begin(), Entries.end(), [](const auto &a, const auto &b)
+                {
+                    return a.Lastused < b.Lastused;
+                });
+                Evict(std::distance(Entries.begin(), Oldest));
+            }
+        }
+
+        inline Entry_t *Find(uint64_t Sourcekey, uint32_t Kind)
+        {
+            for (auto &Entry : Entries)
+                if (Entry.Sourcekey == Sourcekey && Entry.Kind == Kind)
+                    return &Entry;
+            return nullptr;
+        }
+    }
+
+    // Hashes the content, which means reading the whole file; in blocks, so it needs no memory.
+    inline Fingerprint_t Fingerprint(std::string_view Path)
+    {
+        const auto Checked = Internal::Now();
+        const auto Modified = FS::Modifiedtime(Path);
+
+        uint64_t Contenthash = Hash::Internal::FNV1_Offset_64, Size{};
+        if (const auto Filehandle = std::fopen(Path.data(), "rb"))
+        {
+            uint8_t Block[4096];
+            while (const auto Count = std::fread(Block, 1, sizeof(Block), Filehandle))
+            {
+                for (size_t i = 0; i < Count; ++i) Contenthash = (Contenthash ^ Block[i]) * Hash::Internal::FNV1_Prime_64;
+                Size += Count;
+            }
+            std::fclose(Filehandle);
+        }
+
+        return { Contenthash, Modified, Checked, Size };
+    }
+
+    // Get the artifact derived from the source, empty if there's no valid entry; the buffer comes from the resource.
+    inline std::pmr::basic_string<uint8_t> Load(std::string_view Sourcepath, uint32_t Kind, std::pmr::memory_resource *Resource = std::pmr::get_default_resource())
+    {
+        if (!isEnabled) return std::pmr::basic_string<uint8_t>(Resource);
+
+        std::scoped_lock Guard(Internal::Lock);
+        Internal::Loadindex();
+
+        auto Entry = Internal::Find(Hash::FNV1a_64(Sourcepath), Kind);
+        if (!Entry) return std::pmr::basic_string<uint8_t>(Resource);
+
+        // If the file has been touched, or was hashed too soon after an edit to tell, check if the content actually changed.
+        const auto Modified = FS::Modifiedtime(Sourcepath);
+        const auto Size = uint64_t(FS::Filesize(Sourcepath));
+        const auto isRacy = Entry->Source.Checked < Entry->Source.Modified + Internal::Racywindow;
+        if (isRacy || Modified != Entry->Source.Modified || Size != Entry->Source.Size)
+        {
+            const auto Current = Fingerprint(Sourcepath);
+            if (Current.Contenthash != Entry->Source.Contenthash) return std::pmr::basic_string<uint8_t>(Resource);
+            Entry->Source = Current;
+            Internal::isDirty = true;
+        }
+
+        auto Artifact = FS::Readfile(Internal::Blobpath(*Entry).String, Resource);
+        if (Artifact.size() != Entry->Blobsize)
+        {
+            Internal::Evict(Entry - Internal::Entries.data());
+            Internal::Saveindex();
+            return std::pmr::basic_string<uint8_t>(Resource);
+        }
+
+        Entry->Lastused = uint64_t(std::time(nullptr));
+        Internal::isDirty = true;
+        return Artifact;
+    }
+
+    // Save the artifact derived from the source, replacing any older version.
+    inline bool Store(std::string_view Sourcepath, uint32_t Kind, std::basic_string_view<uint8_t> Artifact)
+    {
+        if (!isEnabled) return false;
+
+        std::scoped_lock Guard(Internal::Lock);
+        Internal::Loadindex();
+
+        const auto Sourcekey = Hash::FNV1a_64(Sourcepath);
+        const Entry_t Newentry{ Sourcekey, Fingerprint(Sourcepath), Kind, uint32_t(Artifact.size()), uint64_t(std::time(nullptr)) };
+        if (!Internal::Writeatomic(Internal::Blobpath(Newentry).String, { Artifact })) return false;
+
+        if (auto Entry = Internal::Find(Sourcekey, Kind))
+        {
+            // The old blob may be orphaned now.
+            if (Internal::Blobkey(*Entry) != Internal::Blobkey(Newentry))
+                Internal::Evict(Entry - Internal::Entries.data());
+            else *Entry = Newentry;
+        }
+        // Evicting keeps the capacity, so an edited source doesn't grow the index.
+        if (!Internal::Find(Sourcekey, Kind)) Internal::Entries.push_back(Newentry);
+
+        Internal::Trim();
+        Internal::Saveindex();
+        return true;
+    }
+}
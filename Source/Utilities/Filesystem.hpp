@@ -5,12 +5,21 @@
 */
 
 #pragma once
+#include <memory_resource>
 #include <string_view>
 #include <vector>
 #include <cstdio>
 #include <memory>
 #include <string>
 
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#endif
+
 namespace FS
 {
     inline std::basic_string<uint8_t> Readfile(std::string_view Path)
@@ -28,6 +37,21 @@ namespace FS
 
         return std::basic_string<uint8_t>(Buffer.get(), Length);
     }
+    inline std::pmr::basic_string<uint8_t> Readfile(std::string_view Path, std::pmr::memory_resource *Resource)
+    {
+        std::FILE *Filehandle = std::fopen(Path.data(), "rb");
+        if (!Filehandle) return std::pmr::basic_string<uint8_t>(Resource);
+
+        std::fseek(Filehandle, 0, SEEK_END);
+        const auto Length = std::ftell(Filehandle);
+        std::fseek(Filehandle, 0, SEEK_SET);
+
+        std::pmr::basic_string<uint8_t> Buffer(size_t(Length), 0, Resource);
+        std::fread(Buffer.data(), Length, 1, Filehandle);
+        std::fclose(Filehandle);
+
+        return Buffer;
+    }
     inline bool Writefile(std::string_view Path, const std::basic_string<uint8_t> &Buffer)
     {
         std::FILE *Filehandle = std::fopen(Path.data(), "wb");
@@ -90,7 +114,6 @@ namespace FS
 
     // Windows.
     #if defined(_WIN32)
-    #include <Windows.h>
     inline std::vector<std::string> Findfilesrecursive(std::string Searchpath, std::string_view Criteria)
     {
         std::vector<std::string> Filepaths{};
@@ -169,7 +192,8 @@ namespace FS
     inline Stat_t Filestats(std::string_view Path)
     {
         Stat_t Result{};
-        if (const auto Filehandle = CreateFileA(Path.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr))
+        const auto Filehandle = CreateFileA(Path.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (Filehandle != INVALID_HANDLE_VALUE)
         {
             uint64_t Created, Accessed, Modified;
             GetFileTime(Filehandle, (FILETIME *)&Created, (FILETIME *)&Accessed, (FILETIME *)&Modified);
@@ -182,12 +206,20 @@ namespace FS
         return Result;
     }
 
+    // Nanoseconds since the Unix epoch at whatever resolution the filesystem keeps, zero if missing.
+    inline uint64_t Modifiedtime(std::string_view Path)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA Fileinfo;
+        if (!GetFileAttributesExA(Path.data(), GetFileExInfoStandard, &Fileinfo)) return 0;
+
+        const auto Ticks = uint64_t(Fileinfo.ftLastWriteTime.dwHighDateTime) << 32 | Fileinfo.ftLastWriteTime.dwLowDateTime;
+        return (Ticks - 116444736000000000ULL) * 100;
+    }
+
     #endif
 
     // *nix.
     #if !defined(_WIN32)
-    #include <sys/types.h>
-    #include <dirent.h>
     inline std::vector<std::string> Findfilesrecursive(std::string Searchpath, std::string_view Criteria)
     {
         // TODO(tcn): Just port the NT version.
@@ -226,8 +258,30 @@ namespace FS
     }
     inline Stat_t Filestats(std::string_view Path)
     {
-        assert(false);
-        return {};
+        Stat_t Result{};
+        struct stat Fileinfo;
+
+        if (stat(Path.data(), &Fileinfo) == 0)
+        {
+            Result.Modified = uint32_t(Fileinfo.st_mtime);
+            Result.Accessed = uint32_t(Fileinfo.st_atime);
+            Result.Created = uint32_t(Fileinfo.st_ctime);
+        }
+
+        return Result;
+    }
+
+    // Nanoseconds since the Unix epoch at whatever resolution the filesystem keeps, zero if missing.
+    inline uint64_t Modifiedtime(std::string_view Path)
+    {
+        struct stat Fileinfo;
+        if (stat(Path.data(), &Fileinfo) != 0) return 0;
+
+        #if defined(__APPLE__)
+        return uint64_t(Fileinfo.st_mtimespec.tv_sec) * 1000000000 + Fileinfo.st_mtimespec.tv_nsec;
+        #else
+        return uint64_t(Fileinfo.st_mtim.tv_sec) * 1000000000 + Fileinfo.st_mtim.tv_nsec;
+        #endif
     }
     #endif
 }
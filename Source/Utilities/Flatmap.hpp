@@ -0,0 +1,337 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-07
+    License: MIT
+*/
+
+#pragma once
+#include <memory_resource>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <memory>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FLATMAP_SSE2
+#endif
+
+namespace Hashmap
+{
+    namespace Internal
+    {
+        // One control-byte per slot, 7 bits of the hash when full so a group of 16 is matched in one compare.
+        constexpr int8_t Empty = -128, Deleted = -2;
+        constexpr size_t Groupsize = 16;
+
+        struct Group_t
+        {
+            #if defined(FLATMAP_SSE2)
+            __m128i Control;
+            explicit Group_t(const int8_t *Position) : Control(_mm_loadu_si128((const __m128i *)Position)) {}
+
+            uint32_t Match(int8_t Tag) const { return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(Tag), Control))); }
+            uint32_t Matchempty() const { return Match(Empty); }
+            uint32_t Matchfree() const { return uint32_t(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), Control))); }
+            #else
+            int8_t Control[Groupsize];
+            explicit Group_t(const int8_t *Position) { std::memcpy(Control, Position, Groupsize); }
+
+            uint32_t Match(int8_t Tag) const
+            {
+                uint32_t Mask{};
+                for (size_t i = 0; i < Groupsize; ++i) Mask |= uint32_t(Control[i] == Tag) << i;
+                return Mask;
+            }
+            uint32_t Matchempty() const { return Match(Empty); }
+            uint32_t Matchfree() const
+            {
+                uint32_t Mask{};
+                for (size_t i = 0; i < Groupsize; ++i) Mask |= uint32_t(Control[i] < 0) << i;
+                return Mask;
+            }
+            #endif
+        };
+
+        // The probe-sequence of a map that hasn't allocated yet, always misses.
+        alignas(Groupsize) inline const int8_t Emptygroup[Groupsize]{ Empty, Empty, Empty, Empty, Empty, Empty, Empty, Empty,
+                                                                     Empty, Empty, Empty, Empty, Empty, Empty, Empty, Empty };
+    }
+
+    // Open-addressing map for keys that already are hashes (FNV1a_32 and such), probed a group of slots at a time.
+    // References are invalidated by inserts that grow the table, like std::vector.
+    template <typename Value, typename Allocator = std::allocator<std::byte>>
+    struct Flat
+    {
+        using key_type = uint32_t;
+        using mapped_type = Value;
+        using value_type = std::pair<uint32_t, Value>;
+        using allocator_type = Allocator;
+        using Bytealloc_t = typename std::allocator_traits<Allocator>::template rebind_alloc<std::byte>;
+
+        template <bool isConst> struct Iterator_t
+        {
+            using Map_t = std::conditional_t<isConst, const Flat, Flat>;
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Flat::value_type;
+            using difference_type = ptrdiff_t;
+            using pointer = std::conditional_t<isConst, const value_type *, value_type *>;
+            using reference = std::conditional_t<isConst, const value_type &, value_type &>;
+
+            Map_t *Map; size_t Index;
+
+            reference operator*() const { return Map->Slots[Index]; }
+            pointer operator->() const { return &Map->Slots[Index]; }
+            Iterator_t &operator++() { Index = Map->Nextfull(Index + 1); return *this; }
+            Iterator_t operator++(int) { auto Copy = *this; ++*this; return Copy; }
+            bool operator==(const Iterator_t &Other) const { return Index == Other.Index; }
+            bool operator!=(const Iterator_t &Other) const { return Index != Other.Index; }
+            operator Iterator_t<true>() const { return { Map, Index }; }
+        };
+        using iterator = Iterator_t<false>;
+        using const_iterator = Iterator_t<true>;
+
+        Flat() = default;
+        explicit Flat(const Allocator &Alloc) : Alloc(Alloc) {}
+        template <typename T = Allocator, typename = std::enable_if_t<std::is_constructible_v<T, std::pmr::memory_resource *>>>
+        Flat(std::pmr::memory_resource *Resource) : Alloc(Resource) {}
+
+        Flat(const Flat &Other) : Alloc(std::allocator_traits<Allocator>::select_on_container_copy_construction(Other.Alloc))
+        {
+            Copyfrom(Other);
+        }
+        Flat(Flat &&Other) noexcept : Alloc(std::move(Other.Alloc)) { Steal(Other); }
+        Flat &operator=(const Flat &Other)
+        {
+            if (this != &Other) { clear(); Copyfrom(Other); }
+            return *this;
+        }
+        Flat &operator=(Flat &&Other) noexcept
+        {
+            if (this == &Other) return *this;
+            if (Alloc == Other.Alloc) { Release(); Steal(Other); }
+            else { clear(); Copyfrom(Other); }
+            return *this;
+        }
+        ~Flat() { Release(); }
+
+        iterator begin() { return { this, Nextfull(0) }; }
+        iterator end() { return { this, Capacity }; }
+        const_iterator begin() const { return { this, Nextfull(0) }; }
+        const_iterator end() const { return { this, Capacity }; }
+
+        size_t size() const { return Count; }
+        bool empty() const { return !Count; }
+        bool contains(uint32_t Key) const { return Locate(Key) != Capacity; }
+
+        iterator find(uint32_t Key) { return { this, Locate(Key) }; }
+        const_iterator find(uint32_t Key) const { return { this, Locate(Key) }; }
+
+        template <typename ... Args> std::pair<iterator, bool> try_emplace(uint32_t Key, Args&& ... Arguments)
+        {
+            if (const auto Index = Locate(Key); Index != Capacity) return { { this, Index }, false };
+
+            const auto Index = Claim(Key);
+            ::new (&Slots[Index]) value_type(std::piecewise_construct, std::forward_as_tuple(Key), std::forward_as_tuple(std::forward<Args>(Arguments)...));
+            return { { this, Index }, true };
+        }
+        template <typename T> std::pair<iterator, bool> insert_or_assign(uint32_t Key, T &&Item)
+        {
+            auto Result = try_emplace(Key, std::forward<T>(Item));
+            if (!Result.second) Result.first->second = std::forward<T>(Item);
+            return Result;
+        }
+        Value &operator[](uint32_t Key) { return try_emplace(Key).first->second; }
+
+        size_t erase(uint32_t Key)
+        {
+            const auto Index = Locate(Key);
+            if (Index == Capacity) return 0;
+            erase(iterator{ this, Index });
+            return 1;
+        }
+        iterator erase(const_iterator Position)
+        {
+            const auto Index = Position.Index;
+            std::destroy_at(&Slots[Index]);
+            Count--;
+
+            // If no group containing the slot was ever full, no probe went past it and it can be reused as empty.
+            const auto Before = Internal::Group_t(&Control[(Index - Internal::Groupsize) & Mask]).Matchempty();
+            const auto After = Internal::Group_t(&Control[Index]).Matchempty();
+            const bool isFree = Before && After && std::countl_zero(Before << 16) + std::countr_zero(After) < int(Internal::Groupsize);
+            Setcontrol(Index, isFree ? Internal::Empty : Internal::Deleted);
+            if (isFree) Growthleft++;
+
+            return { this, Nextfull(Index + 1) };
+        }
+
+        void clear()
+        {
+            if (!Capacity) return;
+            for (size_t i = 0; i < Capacity; ++i)
+                if (Control[i] >= 0) std::destroy_at(&Slots[i]);
+
+            std::memset(Control, Internal::Empty, Capacity + Internal::Groupsize - 1);
+            Growthleft = Maxload(Capacity);
+            Count = 0;
+        }
+        void reserve(size_t Elements)
+        {
+            // Copying an empty map shouldn't allocate, e.g. default-constructed array-entries.
+            if (!Elements) return;
+
+            size_t Wanted = Internal::Groupsize;
+            while (Maxload(Wanted) < Elements) Wanted *= 2;
+            if (Wanted > Capacity) Rehash(Wanted);
+        }
+
+        allocator_type get_allocator() const { return Alloc; }
+
+    private:
+        int8_t *Control{ const_cast<int8_t *>(Internal::Emptygroup) };
+        value_type *Slots{};
+        std::byte *Base{};
+        size_t Capacity{}, Mask{}, Count{}, Growthleft{};
+        [[no_unique_address]] Allocator Alloc{};
+
+        // 7/8 load, the keys are assumed to be hashes so they're only mixed enough to separate the tag from the position.
+        static size_t Maxload(size_t Slotcount) { return Slotcount - Slotcount / 8; }
+        static uint32_t Mix(uint32_t Key) { return Key * 0x9E3779B1u; }
+        static int8_t Tag(uint32_t Hash) { return int8_t(Hash >> 25); }
+        static size_t Start(uint32_t Hash) { return Hash ^ (Hash >> 16); }
+
+        size_t Nextfull(size_t Index) const
+        {
+            while (Index < Capacity && Control[Index] < 0) ++Index;
+            return Index;
+        }
+
+        // The first Groupsize - 1 bytes are mirrored after the end, so a group can be loaded from any position.
+        void Setcontrol(size_t Index, int8_t Byte)
+        {
+            Control[Index] = Byte;
+            Control[((Index - (Internal::Groupsize - 1)) & Mask) + (Internal::Groupsize - 1)] = Byte;
+        }
+
+        size_t Locate(uint32_t Key) const
+        {
+            const auto Hash = Mix(Key);
+            const auto Wanted = Tag(Hash);
+
+            for (size_t Position = Start(Hash) & Mask, Step = Internal::Groupsize;; Position = (Position + Step) & Mask, Step += Internal::Groupsize)
+            {
+                const Internal::Group_t Group(Control + Position);
+                for (auto Matches = Group.Match(Wanted); Matches; Matches &= Matches - 1)
+                {
+                    const auto Index = (Position + std::countr_zero(Matches)) & Mask;
+                    if (Slots[Index].first == Key) return Index;
+                }
+
+                if (Group.Matchempty()) return Capacity;
+            }
+        }
+
+        // Free slot for a key known to be missing, grows first if needed.
+        size_t Claim(uint32_t Key)
+        {
+            const auto Hash = Mix(Key);
+            auto Index = Findfree(Hash);
+
+            if (!Growthleft && Control[Index] != Internal::Deleted)
+            {
+                // Mostly tombstones, so a rehash at the same size is enough.
+                Rehash(Capacity && Count < Maxload(Capacity) / 2 ? Capacity : std::max(Capacity * 2, Internal::Groupsize));
+                Index = Findfree(Hash);
+            }
+
+            if (Control[Index] == Internal::Empty) Growthleft--;
+            Setcontrol(Index, Tag(Hash));
+            Count++;
+            return Index;
+        }
+        size_t Findfree(uint32_t Hash) const
+        {
+            for (size_t Position = Start(Hash) & Mask, Step = Internal::Groupsize;; Position = (Position + Step) & Mask, Step += Internal::Groupsize)
+            {
+                if (const auto Free = Internal::Group_t(Control + Position).Matchfree())
+                    return (Position + std::countr_zero(Free)) & Mask;
+            }
+        }
+
+        void Rehash(size_t Newcapacity)
+        {
+            const auto Oldbase = Base;
+            const auto Oldcontrol = Control;
+            const auto Oldslots = Slots;
+            const auto Oldcapacity = Capacity;
+
+            Allocate(Newcapacity);
+            for (size_t i = 0; i < Oldcapacity; ++i)
+            {
+                if (Oldcontrol[i] < 0) continue;
+
+                const auto Hash = Mix(Oldslots[i].first);
+                const auto Index = Findfree(Hash);
+                Setcontrol(Index, Tag(Hash));
+                ::new (&Slots[Index]) value_type(std::move(Oldslots[i]));
+                std::destroy_at(&Oldslots[i]);
+            }
+            Growthleft -= Count;
+
+            if (Oldcapacity) Deallocate(Oldbase, Oldcapacity);
+        }
+
+        // One allocation, the slots first for alignment and the control-bytes after them.
+        static size_t Bytesize(size_t Slotcount) { return alignof(value_type) + Slotcount * sizeof(value_type) + Slotcount + Internal::Groupsize - 1; }
+        void Allocate(size_t Slotcount)
+        {
+            Bytealloc_t Bytes(Alloc);
+            Base = std::allocator_traits<Bytealloc_t>::allocate(Bytes, Bytesize(Slotcount));
+            Slots = (value_type *)((uintptr_t(Base) + alignof(value_type) - 1) & ~uintptr_t(alignof(value_type) - 1));
+            Control = (int8_t *)(Slots + Slotcount);
+            std::memset(Control, Internal::Empty, Slotcount + Internal::Groupsize - 1);
+
+            Capacity = Slotcount;
+            Mask = Slotcount - 1;
+            Growthleft = Maxload(Slotcount);
+        }
+        void Deallocate(std::byte *Buffer, size_t Slotcount)
+        {
+            Bytealloc_t Bytes(Alloc);
+            std::allocator_traits<Bytealloc_t>::deallocate(Bytes, Buffer, Bytesize(Slotcount));
+        }
+
+        void Release()
+        {
+            clear();
+            if (Capacity) Deallocate(Base, Capacity);
+
+            Control = const_cast<int8_t *>(Internal::Emptygroup);
+            Slots = nullptr; Base = nullptr;
+            Capacity = Mask = Count = Growthleft = 0;
+        }
+        void Steal(Flat &Other)
+        {
+            Control = Other.Control; Slots = Other.Slots; Base = Other.Base;
+            Capacity = Other.Capacity; Mask = Other.Mask; Count = Other.Count; Growthleft = Other.Growthleft;
+
+            Other.Control = const_cast<int8_t *>(Internal::Emptygroup);
+            Other.Slots = nullptr; Other.Base = nullptr;
+            Other.Capacity = Other.Mask = Other.Count = Other.Growthleft = 0;
+        }
+        void Copyfrom(const Flat &Other)
+        {
+            reserve(Other.Count);
+            for (const auto &Item : Other) try_emplace(Item.first, Item.second);
+        }
+    };
+
+    // For maps in a frame- or parse-arena.
+    namespace pmr
+    {
+        template <typename Value> using Flat = Hashmap::Flat<Value, std::pmr::polymorphic_allocator<std::byte>>;
+    }
+}
@@ -0,0 +1,57 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-15
+    License: MIT
+*/
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <bit>
+
+// Log-linear buckets, eight per power of two, so any value is within 12.5% of its bucket; recording is a few instructions.
+struct Histogram_t
+{
+    static constexpr uint32_t Subbits = 3, Subbuckets = 1 << Subbits;
+    uint64_t Buckets[64 * Subbuckets]{};
+    uint64_t Count{}, Sum{}, Min{ UINT64_MAX }, Max{};
+
+    static uint32_t Bucket(uint64_t Value)
+    {
+        if (Value < Subbuckets) return uint32_t(Value);
+        const uint32_t Magnitude = 63 - std::countl_zero(Value);
+        return (Magnitude - Subbits + 1) << Subbits | (uint32_t(Value >> (Magnitude - Subbits)) & (Subbuckets - 1));
+    }
+    // The largest value that lands in the bucket.
+    static uint64_t Upperbound(uint32_t Index)
+    {
+        if (Index < Subbuckets) return Index;
+        const uint32_t Magnitude = (Index >> Subbits) + Subbits - 1;
+        const uint64_t Base = (uint64_t(Subbuckets) | (Index & (Subbuckets - 1))) << (Magnitude - Subbits);
+        return Base + (uint64_t(1) << (Magnitude - Subbits)) - 1;
+    }
+
+    void Add(uint64_t Value)
+    {
+        Buckets[Bucket(Value)]++;
+        Count++; Sum += Value;
+        Min = std::min(Min, Value);
+        Max = std::max(Max, Value);
+    }
+
+    // Quantile in [0, 1], reported as the bucket's upper bound but never above the maximum seen.
+    uint64_t Percentile(double Quantile) const
+    {
+        if (!Count) return 0;
+        const auto Target = std::max<uint64_t>(uint64_t(Quantile * Count + 0.5), 1);
+
+        uint64_t Seen{};
+        for (uint32_t i = 0; i < 64 * Subbuckets; ++i)
+        {
+            Seen += Buckets[i];
+            if (Seen >= Target) return std::min(Upperbound(i), Max);
+        }
+        return Max;
+    }
+    double Mean() const { return Count ? double(Sum) / Count : 0.0; }
+};
@@ -0,0 +1,211 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-12
+    License: MIT
+*/
+
+#pragma once
+#include <cstdint>
+#include <array>
+
+// x86-64 instruction lengths plus what's needed to relocate them, no mnemonics or operands.
+namespace Lengthdecoder
+{
+    struct Instruction_t
+    {
+        uint8_t Length;         // Zero if the bytes aren't a valid 64-bit instruction.
+        uint8_t Displacement;   // Offset of a RIP-relative disp32, zero if none.
+        uint8_t Branch;         // Offset of a relative branch-target, zero if none.
+        uint8_t Branchsize;     // Of the branch-target, 1 or 4 bytes.
+        enum Kind_t : uint8_t { None, Call, Jump, Conditional, Loop } Kind;
+        uint8_t Condition;      // For Conditional, the low nibble of Jcc.
+        bool isTerminator;      // Execution never falls through, e.g. RET or JMP.
+    };
+
+    namespace Internal
+    {
+        enum Flags_t : uint8_t { Modrm = 1, Imm8 = 2, Immz = 4, Imm16 = 8, Rel8 = 16, Rel32 = 32, Special = 64, Invalid = 128 };
+
+        // Immz is 16 or 32 bits by operand-size, Special needs the opcode looked at.
+        constexpr std::array<uint8_t, 256> Onebyte = []()
+        {
+            std::array<uint8_t, 256> Table{};
+
+            // The ALU block, op r/m,r / op r,r/m / op AL,imm8 / op eAX,immz.
+            for (uint32_t Row = 0; Row < 0x40; Row += 8)
+            {
+                for (uint32_t i = 0; i < 4; ++i) Table[Row + i] = Modrm;
+                Table[Row + 4] = Imm8;
+                Table[Row + 5] = Immz;
+            }
+            for (const auto Op : { 0x06, 0x07, 0x0E, 0x16, 0x17, 0x1E, 0x1F, 0x27, 0x2F, 0x37, 0x3F }) Table[Op] = Invalid;
+
+            Table[0x60] = Table[0x61] = Table[0x62] = Invalid;
+            Table[0x63] = Modrm;
+            Table[0x68] = Immz; Table[0x69] = Modrm | Immz;
+            Table[0x6A] = Imm8; Table[0x6B] = Modrm | Imm8;
+            for (uint32_t Op = 0x70; Op <= 0x7F; ++Op) Table[Op] = Rel8;
+
+            Table[0x80] = Modrm | Imm8; Table[0x81] = Modrm | Immz;
+            Table[0x82] = Invalid;      Table[0x83] = Modrm | Imm8;
+            for (uint32_t Op = 0x84; Op <= 0x8F; ++Op) Table[Op] = Modrm;
+            Table[0x9A] = Invalid;
+
+            // MOV moffs, eight bytes unless there's an address-size prefix.
+            for (uint32_t Op = 0xA0; Op <= 0xA3; ++Op) Table[Op] = Special;
+            Table[0xA8] = Imm8; Table[0xA9] = Immz;
+            for (uint32_t Op = 0xB0; Op <= 0xB7; ++Op) Table[Op] = Imm8;
+            for (uint32_t Op = 0xB8; Op <= 0xBF; ++Op) Table[Op] = Special;
+
+            Table[0xC0] = Table[0xC1] = Modrm | Imm8;
+            Table[0xC2] = Imm16;
+            Table[0xC6] = Modrm | Imm8; Table[0xC7] = Modrm | Immz;
+            Table[0xC8] = Imm16 | Imm8;
+            Table[0xCA] = Imm16; Table[0xCD] = Imm8;
+            Table[0xCE] = Invalid;
+
+            for (uint32_t Op = 0xD0; Op <= 0xD3; ++Op) Table[Op] = Modrm;
+            Table[0xD4] = Table[0xD5] = Table[0xD6] = Invalid;
+            for (uint32_t Op = 0xD8; Op <= 0xDF; ++Op) Table[Op] = Modrm;
+
+            for (uint32_t Op = 0xE0; Op <= 0xE3; ++Op) Table[Op] = Rel8;
+            for (uint32_t Op = 0xE4; Op <= 0xE7; ++Op) Table[Op] = Imm8;
+            Table[0xE8] = Table[0xE9] = Rel32;
+            Table[0xEA] = Invalid;
+            Table[0xEB] = Rel8;
+
+            // TEST has an immediate, the rest of the group doesn't.
+            Table[0xF6] = Table[0xF7] = Modrm | Special;
+            Table[0xFE] = Table[0xFF] = Modrm;
+            return Table;
+        }();
+
+        // 0F xx, the 38 and 3A escapes are handled separately.
+        constexpr std::array<uint8_t, 256> Twobyte = []()
+        {
+            std::array<uint8_t, 256> Table{};
+            for (auto &Entry : Table) Entry = Modrm;
+
+            for (const auto Op : { 0x05, 0x06, 0x07, 0x08, 0x09, 0x0B, 0x0E, 0x77, 0xA0, 0xA1, 0xA2, 0xA8, 0xA9, 0xAA }) Table[Op] = 0;
+            for (uint32_t Op = 0x30; Op <= 0x37; ++Op) Table[Op] = 0;
+            for (uint32_t Op = 0xC8; Op <= 0xCF; ++Op) Table[Op] = 0;
+            for (uint32_t Op = 0x80; Op <= 0x8F; ++Op) Table[Op] = Rel32;
+            for (const auto Op : { 0x04, 0x0A, 0x0C, 0x24, 0x25, 0x26, 0x27, 0x36, 0x39, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F, 0x7A, 0x7B }) Table[Op] = Invalid;
+
+            // The 3DNow! suffix is an immediate as far as the length is concerned.
+            for (const auto Op : { 0x0F, 0x70, 0x71, 0x72, 0x73, 0xA4, 0xAC, 0xBA, 0xC2, 0xC4, 0xC5, 0xC6 }) Table[Op] = Modrm | Imm8;
+            return Table;
+        }();
+    }
+
+    // Reads at most 15 bytes.
+    inline Instruction_t Decode(const uint8_t *Code)
+    {
+        using namespace Internal;
+        Instruction_t Result{};
+        const uint8_t *Cursor = Code;
+        bool Operandsize{}, Addresssize{}, Rexw{};
+
+        // Legacy prefixes in any order, REX only counts if it's right before the opcode.
+        while (Cursor - Code < 14)
+        {
+            const auto Byte = *Cursor;
+            if (Byte == 0x66) Operandsize = true;
+            else if (Byte == 0x67) Addresssize = true;
+            else if (Byte == 0xF0 || Byte == 0xF2 || Byte == 0xF3 || Byte == 0x2E || Byte == 0x36 ||
+                     Byte == 0x3E || Byte == 0x26 || Byte == 0x64 || Byte == 0x65) {}
+            else break;
+
+            ++Cursor;
+        }
+        if ((*Cursor & 0xF0) == 0x40)
+        {
+            Rexw = *Cursor & 0x08;
+            ++Cursor;
+        }
+
+        uint8_t Flags{}, Map{}, Opcode{};
+        if (*Cursor == 0xC4 || *Cursor == 0xC5 || *Cursor == 0x62)
+        {
+            // VEX and EVEX, the map decides the immediate and there's always a ModRM except for VZEROUPPER/VZEROALL.
+            if (*Cursor == 0xC5) { Map = 1; Cursor += 2; }
+            else if (*Cursor == 0xC4) { Map = Cursor[1] & 0x1F; Cursor += 3; }
+            else { Map = Cursor[1] & 0x07; Cursor += 4; }
+
+            Opcode = *Cursor++;
+            if (Map == 1) Flags = Twobyte[Opcode] & (Modrm | Imm8);
+            else if (Map == 2) Flags = Modrm;
+            else if (Map == 3) Flags = Modrm | Imm8;
+            else return {};
+
+            if (Map == 1 && Opcode == 0x77) Flags = 0;
+        }
+        else if (*Cursor == 0x0F)
+        {
+            ++Cursor;
+            if (*Cursor == 0x38) { Map = 2; Flags = Modrm; ++Cursor; }
+            else if (*Cursor == 0x3A) { Map = 3; Flags = Modrm | Imm8; ++Cursor; }
+            else { Map = 1; Flags = Twobyte[*Cursor]; }
+            Opcode = *Cursor++;
+        }
+        else
+        {
+            Opcode = *Cursor++;
+            Flags = Onebyte[Opcode];
+        }
+        if (Flags & Invalid) return {};
+
+        if (Flags & Modrm)
+        {
+            const auto Mod = *Cursor >> 6, Reg = (*Cursor >> 3) & 7, Rm = *Cursor & 7;
+            ++Cursor;
+
+            if (Mod != 3)
+            {
+                if (Rm == 4)
+                {
+                    const auto Base = *Cursor++ & 7;
+                    if (Mod == 0 && Base == 5) Cursor += 4;
+                }
+                else if (Mod == 0 && Rm == 5)
+                {
+                    Result.Displacement = uint8_t(Cursor - Code);
+                    Cursor += 4;
+                }
+
+                if (Mod == 1) Cursor += 1;
+                if (Mod == 2) Cursor += 4;
+            }
+
+            // TEST r/m, imm.
+            if (Map == 0 && (Opcode == 0xF6 || Opcode == 0xF7) && Reg < 2) Flags |= Opcode == 0xF6 ? Imm8 : Immz;
+
+            // JMP r/m and JMP far.
+            if (Map == 0 && Opcode == 0xFF && (Reg == 4 || Reg == 5)) Result.isTerminator = true;
+        }
+
+        if (Map == 0 && Opcode >= 0xA0 && Opcode <= 0xA3) Cursor += Addresssize ? 4 : 8;
+        if (Map == 0 && Opcode >= 0xB8 && Opcode <= 0xBF) Cursor += Rexw ? 8 : Operandsize ? 2 : 4;
+        if (Flags & Imm8) Cursor += 1;
+        if (Flags & Imm16) Cursor += 2;
+        if (Flags & Immz) Cursor += Operandsize && !Rexw ? 2 : 4;
+
+        if (Flags & (Rel8 | Rel32))
+        {
+            Result.Branch = uint8_t(Cursor - Code);
+            Result.Branchsize = Flags & Rel8 ? 1 : 4;
+            Cursor += Result.Branchsize;
+
+            if (Map == 1 || (Opcode >= 0x70 && Opcode <= 0x7F)) { Result.Kind = Instruction_t::Conditional; Result.Condition = Opcode & 0x0F; }
+            else if (Opcode >= 0xE0 && Opcode <= 0xE3) Result.Kind = Instruction_t::Loop;
+            else if (Opcode == 0xE8) Result.Kind = Instruction_t::Call;
+            else { Result.Kind = Instruction_t::Jump; Result.isTerminator = true; }
+        }
+
+        if (Map == 0 && (Opcode == 0xC2 || Opcode == 0xC3 || Opcode == 0xCA || Opcode == 0xCB || Opcode == 0xCF)) Result.isTerminator = true;
+
+        if (Cursor - Code > 15) return {};
+        Result.Length = uint8_t(Cursor - Code);
+        return Result;
+    }
+}
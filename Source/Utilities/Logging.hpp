@@ -38,6 +38,18 @@ namespace Logging
         std::fflush(stderr);
     }
 
+    inline void toDefault(const std::basic_string_view<char> Message)
+    {
+        toFile(Message);
+
+        #if !defined(NDEBUG)
+        toStream(Message);
+        #endif
+    }
+
+    // Where the formatted lines go, e.g. a no-op to measure just the formatting.
+    inline void (*Sink)(const std::basic_string_view<char> Message) = toDefault;
+
     // Formatted standard printing.
     inline void Print(const char Prefix, const std::basic_string_view<char> Message)
     {
@@ -45,11 +57,7 @@ namespace Logging
         char Buffer[80]{};
 
         std::strftime(Buffer, 80, "%H:%M:%S", std::localtime(&Now));
-        toFile(va("[%c][%-8s] %*s\n", Prefix, Buffer, Message.size(), Message.data()));
-
-        #if !defined(NDEBUG)
-        toStream(va("[%c][%-8s] %*s\n", Prefix, Buffer, Message.size(), Message.data()));
-        #endif
+        Sink(va("[%c][%-8s] %*s\n", Prefix, Buffer, Message.size(), Message.data()));
     }
 
     // Remove the old logfile.
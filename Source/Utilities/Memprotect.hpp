@@ -5,73 +5,260 @@
 */
 
 #pragma once
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
+#include <charconv>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 namespace Memprotect
 {
+    // [Start, End) with the protection in the platform's format.
+    struct Region_t { std::uintptr_t Start, End; unsigned long Protection; };
+
+    inline std::uintptr_t Pagesize()
+    {
+        #if defined(_WIN32)
+        static const std::uintptr_t Size = []() { SYSTEM_INFO Info{}; GetSystemInfo(&Info); return std::uintptr_t(Info.dwPageSize); }();
+        #else
+        static const std::uintptr_t Size = std::uintptr_t(getpagesize());
+        #endif
+        return Size;
+    }
+
     // Windows version.
     #if defined(_WIN32)
-    #include <Windows.h>
-    inline void Protectrange(void *Address, const size_t Length, const unsigned long Oldprotection)
+    constexpr unsigned long Readwriteexecute = PAGE_EXECUTE_READWRITE;
+
+    // The kernel keeps the map, so there's nothing to cache.
+    inline Region_t Regionat(std::uintptr_t Address)
     {
-        unsigned long Temp;
-        VirtualProtect(Address, Length, Oldprotection, &Temp);
+        MEMORY_BASIC_INFORMATION Info{};
+        if (!VirtualQuery(reinterpret_cast<void *>(Address), &Info, sizeof(Info))) return { Address, Address + Pagesize(), Readwriteexecute };
+        return { std::uintptr_t(Info.BaseAddress), std::uintptr_t(Info.BaseAddress) + Info.RegionSize, Info.Protect };
     }
-    inline unsigned long Unprotectrange(void *Address, const size_t Length)
+    inline bool Setprotection(std::uintptr_t Start, std::uintptr_t End, unsigned long Protection)
     {
-        unsigned long Oldprotection;
-        VirtualProtect(Address, Length, PAGE_EXECUTE_READWRITE, &Oldprotection);
-        return Oldprotection;
+        unsigned long Temp;
+        return VirtualProtect(reinterpret_cast<void *>(Start), End - Start, Protection, &Temp);
     }
+    inline void Invalidate() {}
     #endif
 
     // *nix version.
     #if !defined(_WIN32)
-    #include <unistd.h>
-    #include <sys/mman.h>
-    inline void Protectrange(void *Address, const size_t Length, unsigned long Oldprotection)
+    constexpr unsigned long Readwriteexecute = PROT_READ | PROT_WRITE | PROT_EXEC;
+
+    // /proc/self/maps parsed once into sorted intervals, our own changes are applied to it directly.
+    // Mappings made or changed by anyone else are picked up when a lookup misses, or after Invalidate().
+    namespace Regions
     {
-        int Pagesize = getpagesize();
-        *(size_t *)&Address -= size_t(Address) % Pagesize;
-        mprotect(Address, Length + ((Length % Pagesize) ? (Pagesize - (Length % Pagesize)) : 0), Oldprotection);
+        inline std::vector<Region_t> Index{};
+        inline std::recursive_mutex Lock{};
+        inline bool isStale{ true };
+
+        inline void Refresh()
+        {
+            std::string Buffer{};
+            if (std::FILE *Filehandle = std::fopen("/proc/self/maps", "r"))
+            {
+                // procfs doesn't report a size, so read until it runs dry.
+                char Chunk[4096];
+                size_t Read;
+                while ((Read = std::fread(Chunk, 1, sizeof(Chunk), Filehandle))) Buffer.append(Chunk, Read);
+                std::fclose(Filehandle);
+            }
+
+            // "start-end perms offset dev inode path", only the first two fields matter.
+            Index.clear();
+            for (size_t Position = 0; Position < Buffer.size();)
+            {
+                auto Lineend = Buffer.find('\n', Position);
+                if (Lineend == std::string::npos) Lineend = Buffer.size();
+                const char *Cursor = Buffer.data() + Position, *Last = Buffer.data() + Lineend;
+                Position = Lineend + 1;
+
+                Region_t Region{};
+                auto Result = std::from_chars(Cursor, Last, Region.Start, 16);
+                if (Result.ec != std::errc() || Result.ptr == Last || *Result.ptr != '-') continue;
+                Result = std::from_chars(Result.ptr + 1, Last, Region.End, 16);
+                if (Result.ec != std::errc() || Last - Result.ptr < 4) continue;
+
+                const auto Permissions = Result.ptr + 1;
+                if (Permissions[0] == 'r') Region.Protection |= PROT_READ;
+                if (Permissions[1] == 'w') Region.Protection |= PROT_WRITE;
+                if (Permissions[2] == 'x') Region.Protection |= PROT_EXEC;
+                Index.push_back(Region);
+            }
+
+            std::sort(Index.begin(), Index.end(), [](const auto &A, const auto &B) { return A.Start < B.Start; });
+            isStale = false;
+        }
+        inline void Invalidate()
+        {
+            std::scoped_lock Guard(Lock);
+            isStale = true;
+        }
+
+        // The region containing Address, false if it's not mapped even after a refresh.
+        inline bool Find(std::uintptr_t Address, Region_t &Output)
+        {
+            std::scoped_lock Guard(Lock);
+            const auto Search = [&]()
+            {
+                const auto Iterator = std::upper_bound(Index.begin(), Index.end(), Address, [](std::uintptr_t Value, const auto &Region) { return Value < Region.Start; });
+                if (Iterator == Index.begin() || std::prev(Iterator)->End <= Address) return false;
+                Output = *std::prev(Iterator);
+                return true;
+            };
+
+            if (isStale) Refresh();
+            if (Search()) return true;
+
+            Refresh();
+            return Search();
+        }
+
+        // Overwrite [Start, End), splitting the regions it cuts through and merging with equal neighbours like the kernel does.
+        inline void Assign(std::uintptr_t Start, std::uintptr_t End, unsigned long Protection)
+        {
+            std::scoped_lock Guard(Lock);
+            if (isStale) return;
+
+            auto First = std::lower_bound(Index.begin(), Index.end(), Start, [](const auto &Region, std::uintptr_t Value) { return Region.End <= Value; });
+            auto Last = First;
+            while (Last != Index.end() && Last->Start < End) ++Last;
+
+            Region_t Pieces[3]{}; size_t Count{};
+            if (First != Last && First->Start < Start) Pieces[Count++] = { First->Start, Start, First->Protection };
+            Pieces[Count++] = { Start, End, Protection };
+            if (First != Last && std::prev(Last)->End > End) Pieces[Count++] = { End, std::prev(Last)->End, std::prev(Last)->Protection };
+
+            // Absorb the neighbours if they match.
+            if (First != Index.begin() && std::prev(First)->End == Pieces[0].Start && std::prev(First)->Protection == Pieces[0].Protection)
+            {
+                --First;
+                Pieces[0].Start = First->Start;
+            }
+            if (Last != Index.end() && Last->Start == Pieces[Count - 1].End && Last->Protection == Pieces[Count - 1].Protection)
+            {
+                Pieces[Count - 1].End = Last->End;
+                ++Last;
+            }
+
+            // Pieces can only merge with each other if the protection didn't change.
+            size_t Merged{};
+            for (size_t i = 1; i < Count; ++i)
+            {
+                if (Pieces[Merged].End == Pieces[i].Start && Pieces[Merged].Protection == Pieces[i].Protection) Pieces[Merged].End = Pieces[i].End;
+                else Pieces[++Merged] = Pieces[i];
+            }
+            Count = Merged + 1;
+
+            // Usually the same count, so it's an overwrite rather than a shift.
+            const auto Offset = First - Index.begin();
+            const auto Replaced = size_t(Last - First);
+            if (Replaced > Count) Index.erase(First + Count, Last);
+            if (Replaced < Count) Index.insert(Last, Count - Replaced, Region_t{});
+            std::copy_n(Pieces, Count, Index.begin() + Offset);
+        }
+    }
+
+    // Unmapped addresses are reported as RWX, same as before there was an index.
+    inline Region_t Regionat(std::uintptr_t Address)
+    {
+        if (Region_t Region; Regions::Find(Address, Region)) return Region;
+        return { Address & ~(Pagesize() - 1), (Address & ~(Pagesize() - 1)) + Pagesize(), Readwriteexecute };
+    }
+    inline bool Setprotection(std::uintptr_t Start, std::uintptr_t End, unsigned long Protection)
+    {
+        if (mprotect(reinterpret_cast<void *>(Start), End - Start, int(Protection))) return false;
+        Regions::Assign(Start, End, Protection);
+        return true;
+    }
+    inline void Invalidate() { Regions::Invalidate(); }
+    #endif
+
+    // Whole pages covering [Address, Address + Length).
+    inline Region_t Pagerange(const void *Address, const size_t Length)
+    {
+        const auto Mask = Pagesize() - 1;
+        return { std::uintptr_t(Address) & ~Mask, (std::uintptr_t(Address) + std::max<size_t>(Length, 1) + Mask) & ~Mask, 0 };
+    }
+
+    inline void Protectrange(void *Address, const size_t Length, const unsigned long Oldprotection)
+    {
+        const auto Range = Pagerange(Address, Length);
+        Setprotection(Range.Start, Range.End, Oldprotection);
     }
     inline unsigned long Unprotectrange(void *Address, const size_t Length)
     {
-        unsigned long Oldprotection = (PROT_READ | PROT_WRITE | PROT_EXEC);
+        // We assume the range is continuous, the first page decides.
+        const auto Range = Pagerange(Address, Length);
+        const auto Oldprotection = Regionat(Range.Start).Protection;
+
+        Setprotection(Range.Start, Range.End, Readwriteexecute);
+        return Oldprotection;
+    }
+
+    // Many ranges at once, adjacent pages are coalesced so each run is a single call in either direction.
+    // Unlike Unprotectrange, every page gets its own protection back.
+    struct Batch_t
+    {
+        std::vector<Region_t> Pending{}, Saved{};
+
+        void Add(const void *Address, const size_t Length) { Pending.push_back(Pagerange(Address, Length)); }
+        void Add(const std::uintptr_t Address, const size_t Length) { Add(reinterpret_cast<const void *>(Address), Length); }
 
-        // Get the old protection of the range, we assume it's continuous.
-        std::FILE *Filehandle = std::fopen("/proc/self/maps", "r");
-        if (Filehandle)
+        // Returns false if any run failed, the others are still writable and restored by Protect().
+        bool Unprotect()
         {
-            char Buffer[1024]{}, Permissions[5]{}, Device[6]{}, Mapname[256]{};
-            unsigned long Start, End, Node, Foo;
+            std::sort(Pending.begin(), Pending.end(), [](const auto &A, const auto &B) { return A.Start < B.Start; });
 
-            while (std::fgets(Buffer, 1024, Filehandle))
+            std::vector<Region_t> Runs{};
+            for (const auto &Range : Pending)
             {
-                std::sscanf(Buffer, "%lx-%lx %4s %lx %5s %lu %s", &Start, &End, Permissions, &Foo, Device, &Node, Mapname);
+                if (!Runs.empty() && Range.Start <= Runs.back().End) Runs.back().End = std::max(Runs.back().End, Range.End);
+                else Runs.push_back(Range);
+            }
+            Pending.clear();
 
-                if (Start <= (unsigned long)Address || End >= (unsigned long)Address)
+            // Remember what each part of the run had, then open it up in one go.
+            bool Result = true;
+            for (const auto &Run : Runs)
+            {
+                for (auto Address = Run.Start; Address < Run.End;)
                 {
-                    Oldprotection = 0;
-
-                    if (Permissions[0] == 'r') Oldprotection |= PROT_READ;
-                    if (Permissions[1] == 'w') Oldprotection |= PROT_WRITE;
-                    if (Permissions[2] == 'x') Oldprotection |= PROT_EXEC;
+                    const auto Region = Regionat(Address);
+                    const auto End = std::min(std::max(Region.End, Address + Pagesize()), Run.End);
 
-                    break;
+                    if (!Saved.empty() && Saved.back().End == Address && Saved.back().Protection == Region.Protection) Saved.back().End = End;
+                    else Saved.push_back({ Address, End, Region.Protection });
+                    Address = End;
                 }
+
+                Result &= Setprotection(Run.Start, Run.End, Readwriteexecute);
             }
 
-            std::fclose(Filehandle);
+            return Result;
         }
 
-        // Write the new protection.
-        int Pagesize = getpagesize();
-        *(size_t *)&Address -= size_t(Address) % Pagesize;
-        mprotect(Address, Length + ((Length % Pagesize) ? (Pagesize - (Length % Pagesize)) : 0), PROT_READ | PROT_WRITE | PROT_EXEC);
-        return Oldprotection;
-    }
-    #endif
+        void Protect()
+        {
+            // Newest first, so overlapping batches unwind in order.
+            for (auto Region = Saved.rbegin(); Region != Saved.rend(); ++Region) Setprotection(Region->Start, Region->End, Region->Protection);
+            Saved.clear();
+        }
+    };
 
     // Helpers to provide more readable code.
     inline void Protectrange(const std::uintptr_t Address, const size_t Length, const unsigned long Oldprotection)
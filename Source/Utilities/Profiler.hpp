@@ -0,0 +1,475 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-13
+    License: MIT
+*/
+
+#pragma once
+#include "Simplehook.hpp"
+#include <unordered_map>
+#include <string_view>
+#include <charconv>
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <deque>
+
+#if defined(_WIN32)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#include <dlfcn.h>
+#include <link.h>
+#endif
+
+// Function-level timing through trampoline hooks, for release builds where rebuilding with instrumentation isn't an option.
+// On entry the return address is swapped for an exit-stub, so a hooked function must not be unwound through by an
+// exception or longjmp, and can't return a long double. Events are only appended per thread, the aggregation is done on dump.
+#if defined(_M_X64) || defined(__x86_64__)
+namespace Profiler
+{
+    struct Event_t { uint64_t Timestamp; uint32_t Function; uint32_t isExit; };
+
+    // Single writer, the readers only see what Count has published.
+    struct Chunk_t
+    {
+        static constexpr size_t Capacity = 64 * 1024;
+        std::atomic<uint32_t> Count{};
+        std::atomic<Chunk_t *> Next{};
+        Event_t Events[Capacity];
+    };
+
+    struct Thread_t
+    {
+        static constexpr size_t Maxdepth = 256;
+        static constexpr size_t Maxchunks = 64;
+
+        struct Frame_t { std::uintptr_t Returnaddress; uint32_t Function; };
+        Frame_t Frames[Maxdepth]{};
+        uint32_t Depth{};
+
+        Chunk_t *First{}, *Current{};
+        size_t Chunks{}, Dropped{};
+
+        ~Thread_t()
+        {
+            for (auto Chunk = First; Chunk;) delete std::exchange(Chunk, Chunk->Next.load());
+        }
+
+        void Push(uint32_t Function, bool isExit)
+        {
+            auto Count = Current->Count.load(std::memory_order_relaxed);
+            if (Count == Chunk_t::Capacity)
+            {
+                const auto Next = new Chunk_t();
+                Current->Next.store(Next, std::memory_order_release);
+                Current = Next;
+                Count = 0;
+                ++Chunks;
+            }
+
+            Current->Events[Count] = { __rdtsc(), Function, isExit };
+            Current->Count.store(Count + 1, std::memory_order_release);
+        }
+
+        // Room for this entry and the exit of every open frame, so the log always pairs up.
+        bool hasRoom() const
+        {
+            const auto Used = (Chunks - 1) * Chunk_t::Capacity + Current->Count.load(std::memory_order_relaxed);
+            return Depth < Maxdepth && Used + Depth + 2 <= Maxchunks * Chunk_t::Capacity;
+        }
+    };
+
+    // Where the stubs look for the original, the hook is kept here so the thunk can be built before it's installed.
+    // The stub reads Trampoline rather than the hook's slot, it's never cleared so calls in flight outlive Removeall().
+    struct Entry_t
+    {
+        Simplehook::Trampolinehook Hook;
+        uint8_t *Trampoline;
+        uint32_t Function;
+        uint8_t *Thunk;
+    };
+
+    namespace Internal
+    {
+        inline std::recursive_mutex Lock{};
+        inline std::deque<Entry_t> Entries{};
+        inline std::deque<std::string> Names{};
+        inline std::vector<std::unique_ptr<Thread_t>> Threads{};
+        inline thread_local Thread_t *Local{};
+
+        // Set while recording, so a profiled allocator doesn't recurse when a new chunk is needed.
+        inline thread_local bool isBusy{};
+        inline uint8_t *Entrystub{}, *Exitstub{};
+
+        // For converting ticks, measured across the whole session rather than with a sleep.
+        inline std::chrono::steady_clock::time_point Startclock{};
+        inline uint64_t Starttimestamp{};
+
+        inline Thread_t &Thisthread()
+        {
+            if (!Local) [[unlikely]]
+            {
+                auto Thread = std::make_unique<Thread_t>();
+                Thread->First = Thread->Current = new Chunk_t();
+                Thread->Chunks = 1;
+
+                std::scoped_lock Guard(Lock);
+                Local = Threads.emplace_back(std::move(Thread)).get();
+            }
+            return *Local;
+        }
+
+        // Called from the stubs with everything volatile saved.
+        inline void Enter(Entry_t *Entry, std::uintptr_t *Returnslot)
+        {
+            if (isBusy) return;
+            isBusy = true;
+
+            auto &Thread = Thisthread();
+            if (!Thread.hasRoom()) ++Thread.Dropped;
+            else
+            {
+                Thread.Frames[Thread.Depth++] = { *Returnslot, Entry->Function };
+                *Returnslot = std::uintptr_t(Exitstub);
+                Thread.Push(Entry->Function, false);
+            }
+
+            isBusy = false;
+        }
+        inline std::uintptr_t Leave()
+        {
+            const bool Wasbusy = isBusy;
+            isBusy = true;
+
+            auto &Thread = *Local;
+            const auto Frame = Thread.Frames[--Thread.Depth];
+            Thread.Push(Frame.Function, true);
+
+            isBusy = Wasbusy;
+            return Frame.Returnaddress;
+        }
+
+        // Shared by all hooks, the per-function thunk only loads its entry into R11 first.
+        inline bool Createstubs()
+        {
+            #if defined(_WIN32)
+            const auto Page = static_cast<uint8_t *>(VirtualAlloc(nullptr, 4096, MEM_RESERVE | MEM_COMMIT, PAGE_EXECUTE_READWRITE));
+            if (!Page) return false;
+            #else
+            const auto Page = static_cast<uint8_t *>(mmap(nullptr, 4096, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            if (Page == MAP_FAILED) return false;
+            Memprotect::Invalidate();
+            #endif
+
+            size_t Size{};
+            const auto Emit = [&](std::initializer_list<uint8_t> Bytes) { for (const auto Byte : Bytes) Page[Size++] = Byte; };
+            const auto Emit32 = [&](uint32_t Value) { std::memcpy(Page + Size, &Value, 4); Size += 4; };
+            const auto Emit64 = [&](uint64_t Value) { std::memcpy(Page + Size, &Value, 8); Size += 8; };
+
+            // push rax, rdi, rsi, rdx, rcx, r8, r9, r10, r11; sub rsp, 0xA0
+            Entrystub = Page;
+            Emit({ 0x50, 0x57, 0x56, 0x52, 0x51, 0x41, 0x50, 0x41, 0x51, 0x41, 0x52, 0x41, 0x53 });
+            Emit({ 0x48, 0x81, 0xEC }); Emit32(0xA0);
+
+            // movdqu [rsp + 0x20 + i * 16], xmm0-7 above the shadow-space.
+            for (uint8_t i = 0; i < 8; ++i) { Emit({ 0xF3, 0x0F, 0x7F, uint8_t(0x84 | (i << 3)), 0x24 }); Emit32(0x20 + i * 16); }
+
+            // Enter(R11, &Returnaddress)
+            #if defined(_WIN32)
+            Emit({ 0x4C, 0x89, 0xD9, 0x48, 0x8D, 0x94, 0x24 }); Emit32(0xA0 + 9 * 8);
+            #else
+            Emit({ 0x4C, 0x89, 0xDF, 0x48, 0x8D, 0xB4, 0x24 }); Emit32(0xA0 + 9 * 8);
+            #endif
+            Emit({ 0x48, 0xB8 }); Emit64(std::uintptr_t(&Enter));
+            Emit({ 0xFF, 0xD0 });
+
+            for (uint8_t i = 0; i < 8; ++i) { Emit({ 0xF3, 0x0F, 0x6F, uint8_t(0x84 | (i << 3)), 0x24 }); Emit32(0x20 + i * 16); }
+            Emit({ 0x48, 0x81, 0xC4 }); Emit32(0xA0);
+            Emit({ 0x41, 0x5B, 0x41, 0x5A, 0x41, 0x59, 0x41, 0x58, 0x59, 0x5A, 0x5E, 0x5F, 0x58 });
+
+            // mov r11, [r11 + Trampoline]; jmp r11
+            Emit({ 0x4D, 0x8B, 0x9B }); Emit32(uint32_t(offsetof(Entry_t, Trampoline)));
+            Emit({ 0x41, 0xFF, 0xE3 });
+
+            // Returns land here; reserve the real return address' slot, save the return registers and ask Leave() for it.
+            Size = (Size + 15) & ~size_t(15);
+            Exitstub = Page + Size;
+            Emit({ 0x48, 0x83, 0xEC, 0x08, 0x50, 0x52, 0x48, 0x83, 0xEC, 0x48 });
+            Emit({ 0xF3, 0x0F, 0x7F, 0x44, 0x24, 0x20, 0xF3, 0x0F, 0x7F, 0x4C, 0x24, 0x30 });
+            Emit({ 0x48, 0xB8 }); Emit64(std::uintptr_t(&Leave));
+            Emit({ 0xFF, 0xD0, 0x48, 0x89, 0x44, 0x24, 0x58 });
+            Emit({ 0xF3, 0x0F, 0x6F, 0x44, 0x24, 0x20, 0xF3, 0x0F, 0x6F, 0x4C, 0x24, 0x30 });
+            Emit({ 0x48, 0x83, 0xC4, 0x48, 0x5A, 0x58, 0xC3 });
+
+            Simplehook::Flushcache(Page, Size);
+            return true;
+        }
+
+        inline std::uintptr_t Mainmodule()
+        {
+            #if defined(_WIN32)
+            return std::uintptr_t(GetModuleHandleA(nullptr));
+            #else
+            // The executable is always the first object reported.
+            std::uintptr_t Base{};
+            dl_iterate_phdr([](dl_phdr_info *Info, size_t, void *Output) { *static_cast<std::uintptr_t *>(Output) = Info->dlpi_addr; return 1; }, &Base);
+            return Base;
+            #endif
+        }
+
+        // "Symbol", "Module!Symbol", "0xAddress" or "+0xOffset" into the executable, as reported by nm.
+        // Symbols have to be exported and spelled as the linker sees them, i.e. mangled for C++.
+        inline void *Resolve(std::string_view Specifier)
+        {
+            if (Specifier.starts_with("0x") || Specifier.starts_with("+0x"))
+            {
+                const bool isRelative = Specifier[0] == '+';
+                Specifier.remove_prefix(isRelative ? 3 : 2);
+
+                std::uintptr_t Address{};
+                const auto Result = std::from_chars(Specifier.data(), Specifier.data() + Specifier.size(), Address, 16);
+                if (Result.ec != std::errc() || Result.ptr != Specifier.data() + Specifier.size()) return nullptr;
+                return reinterpret_cast<void *>(Address + (isRelative ? Mainmodule() : 0));
+            }
+
+            const auto Separator = Specifier.find('!');
+            const auto Module = Separator == std::string_view::npos ? std::string() : std::string(Specifier.substr(0, Separator));
+            const auto Symbol = std::string(Separator == std::string_view::npos ? Specifier : Specifier.substr(Separator + 1));
+
+            #if defined(_WIN32)
+            const auto Handle = GetModuleHandleA(Module.empty() ? nullptr : Module.c_str());
+            return Handle ? reinterpret_cast<void *>(GetProcAddress(Handle, Symbol.c_str())) : nullptr;
+            #else
+            if (Module.empty()) return dlsym(RTLD_DEFAULT, Symbol.c_str());
+
+            const auto Handle = dlopen(Module.c_str(), RTLD_LAZY | RTLD_NOLOAD);
+            if (!Handle) return nullptr;
+            const auto Address = dlsym(Handle, Symbol.c_str());
+            dlclose(Handle);
+            return Address;
+            #endif
+        }
+    }
+
+    // Hooks the function until Removeall(), false if it can't be relocated or is already profiled.
+    inline bool Addfunction(void *Address, std::string_view Name = {})
+    {
+        using namespace Internal;
+        std::scoped_lock Guard(Lock);
+
+        if (!Entrystub)
+        {
+            if (!Createstubs()) return false;
+            Startclock = std::chrono::steady_clock::now();
+            Starttimestamp = __rdtsc();
+        }
+        for (const auto &Entry : Entries)
+            if (Entry.Hook.Savedlocation == Address && Entry.Hook.Slot) return false;
+
+        // The thunk goes near the function, so the hook never needs a relay.
+        auto &Entry = Entries.emplace_back();
+        Entry.Function = uint32_t(Names.size());
+        Entry.Thunk = Simplehook::Trampolinepool::Allocate(std::uintptr_t(Address));
+        if (!Entry.Thunk) { Entries.pop_back(); return false; }
+
+        // mov r11, &Entry; jmp [rip + 0], Entrystub
+        const uint8_t Thunk[12]{ 0x49, 0xBB };
+        const uint8_t Jump[6]{ 0xFF, 0x25 };
+        const auto Entryaddress = &Entry;
+        std::memcpy(Entry.Thunk, Thunk, 2);
+        std::memcpy(Entry.Thunk + 2, &Entryaddress, 8);
+        std::memcpy(Entry.Thunk + 10, Jump, 6);
+        std::memcpy(Entry.Thunk + 16, &Entrystub, 8);
+        Simplehook::Flushcache(Entry.Thunk, 24);
+
+        // The stub's trampoline has to be in place before the patch lets any call through.
+        if (!Entry.Hook.Prepare(Address, Entry.Thunk))
+        {
+            Simplehook::Trampolinepool::Release(Entry.Thunk);
+            Entries.pop_back();
+            return false;
+        }
+        Entry.Trampoline = Entry.Hook.Callorigin<uint8_t *>();
+        Entry.Hook.Installhook();
+
+        if (!Name.empty()) Names.emplace_back(Name);
+        else
+        {
+            #if !defined(_WIN32)
+            if (Dl_info Info{}; dladdr(Address, &Info) && Info.dli_sname && Info.dli_saddr == Address) Names.emplace_back(Info.dli_sname);
+            else
+            #endif
+            {
+                char Buffer[24]{};
+                std::snprintf(Buffer, sizeof(Buffer), "0x%llx", static_cast<unsigned long long>(std::uintptr_t(Address)));
+                Names.emplace_back(Buffer);
+            }
+        }
+        return true;
+    }
+    inline bool Addsymbol(std::string_view Specifier)
+    {
+        const auto Address = Internal::Resolve(Specifier);
+        if (!Address) return false;
+
+        // Exported names can be demangled by the reader, addresses are better off with the symbol if there is one.
+        const bool isAddress = Specifier.starts_with("0x") || Specifier.starts_with("+0x");
+        return Addfunction(Address, isAddress ? std::string_view() : Specifier.substr(Specifier.find('!') + 1));
+    }
+
+    // Comma-separated specifiers, e.g. from the environment; returns how many could be hooked.
+    inline size_t Addsymbols(std::string_view List)
+    {
+        size_t Count{};
+        while (!List.empty())
+        {
+            const auto Comma = std::min(List.find(','), List.size());
+            auto Specifier = List.substr(0, Comma);
+            List.remove_prefix(std::min(Comma + 1, List.size()));
+
+            while (!Specifier.empty() && Specifier.front() == ' ') Specifier.remove_prefix(1);
+            while (!Specifier.empty() && Specifier.back() == ' ') Specifier.remove_suffix(1);
+            if (!Specifier.empty()) Count += Addsymbol(Specifier);
+        }
+        return Count;
+    }
+
+    // Stops recording new calls, the thunks, trampolines and stubs stay around for calls that are still in flight.
+    inline void Removeall()
+    {
+        std::scoped_lock Guard(Internal::Lock);
+        for (auto &Entry : Internal::Entries) Entry.Hook.Restorehook();
+    }
+
+    // Discards what has been recorded so far, only safe while no other thread is inside a profiled function.
+    inline void Clear()
+    {
+        std::scoped_lock Guard(Internal::Lock);
+        for (const auto &Thread : Internal::Threads)
+        {
+            for (auto Chunk = Thread->First->Next.exchange(nullptr); Chunk;) delete std::exchange(Chunk, Chunk->Next.load());
+            Thread->First->Count = 0;
+            Thread->Current = Thread->First;
+            Thread->Chunks = 1;
+            Thread->Dropped = 0;
+        }
+    }
+
+    // Inclusive time only counts the outermost call when recursing, exclusive excludes profiled callees only.
+    struct Function_t { std::string_view Name; uint64_t Calls; double Inclusive, Exclusive; };
+    struct Stack_t { std::vector<uint32_t> Functions; uint64_t Calls; double Exclusive; };
+    struct Report_t { std::vector<Function_t> Functions; std::vector<Stack_t> Stacks; size_t Dropped; };
+
+    // Replays every thread's log, calls that are still running are left out. Times are in nanoseconds.
+    inline Report_t Collect()
+    {
+        using namespace Internal;
+        std::scoped_lock Guard(Lock);
+
+        const auto Elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Startclock).count();
+        const auto Ticks = double(__rdtsc() - Starttimestamp);
+        const auto Nanoseconds = Ticks > 0 ? Elapsed / Ticks : 0.0;
+
+        Report_t Report{};
+        Report.Functions.resize(Names.size());
+        for (size_t i = 0; i < Names.size(); ++i) Report.Functions[i].Name = Names[i];
+
+        // The call-tree, shared by all threads; node zero is the root.
+        struct Node_t { uint32_t Parent, Function; uint64_t Calls, Exclusive; };
+        std::vector<Node_t> Nodes{ Node_t{} };
+        std::unordered_map<uint64_t, uint32_t> Children{};
+        std::vector<uint64_t> Inclusive(Names.size()), Exclusive(Names.size());
+
+        for (const auto &Thread : Threads)
+        {
+            struct Open_t { uint32_t Node; uint64_t Start, Children; };
+            std::vector<Open_t> Stack{};
+            std::vector<uint32_t> Active(Names.size());
+
+            for (auto Chunk = Thread->First; Chunk; Chunk = Chunk->Next.load(std::memory_order_acquire))
+            {
+                const auto Count = Chunk->Count.load(std::memory_order_acquire);
+                for (uint32_t i = 0; i < Count; ++i)
+                {
+                    const auto &Event = Chunk->Events[i];
+
+                    if (!Event.isExit)
+                    {
+                        const auto Parent = Stack.empty() ? 0 : Stack.back().Node;
+                        const auto Key = (uint64_t(Parent) << 32) | Event.Function;
+                        auto Iterator = Children.find(Key);
+                        if (Iterator == Children.end())
+                        {
+                            Iterator = Children.emplace(Key, uint32_t(Nodes.size())).first;
+                            Nodes.push_back({ Parent, Event.Function, 0, 0 });
+                        }
+
+                        Stack.push_back({ Iterator->second, Event.Timestamp, 0 });
+                        ++Active[Event.Function];
+                        continue;
+                    }
+
+                    // A lost entry would be a bug in the stubs, but don't let it take the report down.
+                    if (Stack.empty() || Nodes[Stack.back().Node].Function != Event.Function) continue;
+
+                    const auto Frame = Stack.back();
+                    Stack.pop_back();
+
+                    const auto Total = Event.Timestamp - Frame.Start;
+                    const auto Self = Total > Frame.Children ? Total - Frame.Children : 0;
+                    if (!Stack.empty()) Stack.back().Children += Total;
+
+                    Nodes[Frame.Node].Calls++;
+                    Nodes[Frame.Node].Exclusive += Self;
+                    Report.Functions[Event.Function].Calls++;
+                    Exclusive[Event.Function] += Self;
+                    if (--Active[Event.Function] == 0) Inclusive[Event.Function] += Total;
+                }
+            }
+
+            Report.Dropped += Thread->Dropped;
+        }
+
+        for (size_t i = 0; i < Names.size(); ++i)
+        {
+            Report.Functions[i].Inclusive = double(Inclusive[i]) * Nanoseconds;
+            Report.Functions[i].Exclusive = double(Exclusive[i]) * Nanoseconds;
+        }
+
+        for (uint32_t i = 1; i < Nodes.size(); ++i)
+        {
+            Stack_t Stack{ {}, Nodes[i].Calls, double(Nodes[i].Exclusive) * Nanoseconds };
+            for (auto Node = i; Node; Node = Nodes[Node].Parent) Stack.Functions.push_back(Nodes[Node].Function);
+            std::reverse(Stack.Functions.begin(), Stack.Functions.end());
+            Report.Stacks.push_back(std::move(Stack));
+        }
+
+        return Report;
+    }
+
+    // "Outer;Inner <exclusive nanoseconds>" per line, as read by flamegraph.pl and speedscope.
+    inline bool Writecollapsed(const char *Filepath, const Report_t &Report)
+    {
+        const auto Filehandle = std::fopen(Filepath, "wb");
+        if (!Filehandle) return false;
+
+        for (const auto &Stack : Report.Stacks)
+        {
+            if (Stack.Exclusive < 1.0) continue;
+
+            for (size_t i = 0; i < Stack.Functions.size(); ++i)
+            {
+                const auto &Name = Report.Functions[Stack.Functions[i]].Name;
+                std::fprintf(Filehandle, "%s%.*s", i ? ";" : "", int(Name.size()), Name.data());
+            }
+            std::fprintf(Filehandle, " %llu\n", static_cast<unsigned long long>(Stack.Exclusive));
+        }
+
+        return std::fclose(Filehandle) == 0;
+    }
+}
+#endif
@@ -0,0 +1,95 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-14
+    License: MIT
+*/
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// The Quite OK Image format, lossless and a single pass; see qoiformat.org for the spec.
+namespace QOI
+{
+    namespace Internal
+    {
+        constexpr uint8_t Index = 0x00, Diff = 0x40, Luma = 0x80, Run = 0xC0, RGB = 0xFE;
+
+        inline void Writebig(uint8_t *&Cursor, uint32_t Value)
+        {
+            *Cursor++ = uint8_t(Value >> 24); *Cursor++ = uint8_t(Value >> 16);
+            *Cursor++ = uint8_t(Value >> 8); *Cursor++ = uint8_t(Value);
+        }
+    }
+
+    // 32-bit BGRA pixels as the surfaces use, written as opaque RGB since the alpha-channel is unused.
+    inline std::string Encode(const uint32_t *Pixels, uint32_t Width, uint32_t Height)
+    {
+        using namespace Internal;
+        const size_t Count = size_t(Width) * Height;
+
+        // Worst case every pixel is an RGB op, header and end-marker around it.
+        std::string Output(14 + Count * 4 + 8, '\0');
+        auto Cursor = reinterpret_cast<uint8_t *>(Output.data());
+
+        std::memcpy(Cursor, "qoif", 4); Cursor += 4;
+        Writebig(Cursor, Width);
+        Writebig(Cursor, Height);
+        *Cursor++ = 3;  // Channels.
+        *Cursor++ = 0;  // sRGB.
+
+        // Compared as 0xAARRGGBB with the alpha forced, so a run is a single compare.
+        uint32_t Seen[64]{};
+        uint32_t Previous = 0xFF000000;
+        uint32_t Runlength{};
+
+        for (size_t i = 0; i < Count; ++i)
+        {
+            const uint32_t Pixel = Pixels[i] | 0xFF000000;
+            if (Pixel == Previous)
+            {
+                if (++Runlength == 62) { *Cursor++ = Run | 61; Runlength = 0; }
+                continue;
+            }
+            if (Runlength) { *Cursor++ = uint8_t(Run | (Runlength - 1)); Runlength = 0; }
+
+            const uint8_t R = uint8_t(Pixel >> 16), G = uint8_t(Pixel >> 8), B = uint8_t(Pixel);
+            const uint32_t Slot = (R * 3 + G * 5 + B * 7 + 255 * 11) % 64;
+            if (Seen[Slot] == Pixel)
+            {
+                *Cursor++ = uint8_t(Index | Slot);
+                Previous = Pixel;
+                continue;
+            }
+            Seen[Slot] = Pixel;
+
+            // Wrapping differences, as the spec does.
+            const int8_t Dr = int8_t(R - uint8_t(Previous >> 16));
+            const int8_t Dg = int8_t(G - uint8_t(Previous >> 8));
+            const int8_t Db = int8_t(B - uint8_t(Previous));
+            const int8_t Drg = int8_t(Dr - Dg), Dbg = int8_t(Db - Dg);
+            Previous = Pixel;
+
+            if (Dr >= -2 && Dr <= 1 && Dg >= -2 && Dg <= 1 && Db >= -2 && Db <= 1)
+            {
+                *Cursor++ = uint8_t(Diff | (Dr + 2) << 4 | (Dg + 2) << 2 | (Db + 2));
+            }
+            else if (Dg >= -32 && Dg <= 31 && Drg >= -8 && Drg <= 7 && Dbg >= -8 && Dbg <= 7)
+            {
+                *Cursor++ = uint8_t(Luma | (Dg + 32));
+                *Cursor++ = uint8_t((Drg + 8) << 4 | (Dbg + 8));
+            }
+            else
+            {
+                *Cursor++ = RGB;
+                *Cursor++ = R; *Cursor++ = G; *Cursor++ = B;
+            }
+        }
+        if (Runlength) *Cursor++ = uint8_t(Run | (Runlength - 1));
+
+        std::memcpy(Cursor, "\0\0\0\0\0\0\0\1", 8); Cursor += 8;
+        Output.resize(Cursor - reinterpret_cast<uint8_t *>(Output.data()));
+        return Output;
+    }
+}
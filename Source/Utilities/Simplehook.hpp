@@ -6,17 +6,57 @@
 
 #pragma once
 #include <memory>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+#include <utility>
+#include <mutex>
 #include "Memprotect.hpp"
+#include "Lengthdecoder.hpp"
 
 // This is a really simple hook that should not be used naively.
 namespace Simplehook
 {
+    // A no-op on x86, but other threads must not see stale code elsewhere.
+    inline void Flushcache(void *Address, const size_t Length)
+    {
+        #if defined(_WIN32)
+        FlushInstructionCache(GetCurrentProcess(), Address, Length);
+        #else
+        __builtin___clear_cache(reinterpret_cast<char *>(Address), reinterpret_cast<char *>(Address) + Length);
+        #endif
+    }
+
     struct Stomphook
     {
         uint8_t Originalstub[14]{};
         void *Savedlocation{};
         void *Savedtarget{};
 
+        // The memory must be writable, see Installhook or Transaction_t.
+        void Writestub(void *Location, void *Target)
+        {
+            // Copy the original stub.
+            std::memcpy(Originalstub, Location, 14);
+
+            // Simple stomp-hooking, sites are rarely aligned so it's all bytewise.
+            if constexpr (sizeof(void *) == sizeof(uint64_t))
+            {
+                // JMP [RIP + 0], Target
+                uint8_t Stub[14]{ 0xFF, 0x25 };
+                std::memcpy(Stub + 6, &Target, sizeof(Target));
+                std::memcpy(Location, Stub, sizeof(Stub));
+            }
+            else
+            {
+                // JMP short Target
+                uint8_t Stub[5]{ 0xE9 };
+                const auto Offset = (size_t)Target - ((size_t)Location + 5);
+                std::memcpy(Stub + 1, &Offset, sizeof(Offset));
+                std::memcpy(Location, Stub, sizeof(Stub));
+            }
+        }
+
         void Installhook(void *Location = nullptr, void *Target = nullptr)
         {
             if (!Location) Location = Savedlocation;
@@ -26,23 +66,7 @@ namespace Simplehook
 
             const auto Protection = Memprotect::Unprotectrange(Location, 14);
             {
-                // Copy the original stub.
-                std::memcpy(Originalstub, Location, 14);
-
-                // Simple stomp-hooking.
-                if constexpr (sizeof(void *) == sizeof(uint64_t))
-                {
-                    // JMP [RIP + 0], Target
-                    *(uint16_t *)((uint8_t *)Location + 0) = 0x25FF;
-                    *(uint32_t *)((uint8_t *)Location + 2) = 0x000000000;
-                    *(uint64_t *)((uint8_t *)Location + 6) = (size_t)Target;
-                }
-                else
-                {
-                    // JMP short Target
-                    *(uint8_t *)((uint8_t *)Location + 0) = 0xE9;
-                    *(size_t *)((uint8_t *)Location + 1) = ((size_t)Target - ((size_t)Location + 5));
-                }
+                Writestub(Location, Target);
             }
             Memprotect::Protectrange(Location, 14, Protection);
         }
@@ -71,4 +95,379 @@ namespace Simplehook
             }
         }
     };
+
+    // Many hooks at once, the pages are opened and restored once per coalesced range instead of per hook.
+    // Nothing is written unless every page could be made writable.
+    struct Transaction_t
+    {
+        struct Pending_t { Stomphook *Hook; void *Location, *Target; bool isRemoval; };
+        std::vector<Pending_t> Pending{};
+
+        // The same defaults as Stomphook::Installhook, the saved location and target.
+        void Installhook(Stomphook &Hook, void *Location = nullptr, void *Target = nullptr)
+        {
+            if (!Location) Location = Hook.Savedlocation;
+            if (!Target) Target = Hook.Savedtarget;
+            Pending.push_back({ &Hook, Location, Target, false });
+        }
+        void Installhook(Stomphook &Hook, const std::uintptr_t Location, const std::uintptr_t Target)
+        {
+            return Installhook(Hook, reinterpret_cast<void *>(Location), reinterpret_cast<void *>(Target));
+        }
+        void Removehook(Stomphook &Hook)
+        {
+            if (Hook.Savedlocation) Pending.push_back({ &Hook, Hook.Savedlocation, nullptr, true });
+        }
+
+        // Applied in the order they were added, the instruction-cache is flushed once per range if requested.
+        bool Commit(bool shouldFlush = true)
+        {
+            Memprotect::Batch_t Batch;
+            for (const auto &Item : Pending) Batch.Add(Item.Location, 14);
+            if (!Batch.Unprotect())
+            {
+                Batch.Protect();
+                Pending.clear();
+                return false;
+            }
+
+            for (const auto &Item : Pending)
+            {
+                if (Item.isRemoval)
+                {
+                    std::memcpy(Item.Location, Item.Hook->Originalstub, 14);
+                    continue;
+                }
+
+                Item.Hook->Savedlocation = Item.Location;
+                Item.Hook->Savedtarget = Item.Target;
+                Item.Hook->Writestub(Item.Location, Item.Target);
+            }
+
+            if (shouldFlush)
+            {
+                for (const auto &Range : Batch.Saved)
+                    Flushcache(reinterpret_cast<void *>(Range.Start), Range.End - Range.Start);
+            }
+
+            Batch.Protect();
+            Pending.clear();
+            return true;
+        }
+    };
+
+    #if defined(_M_X64) || defined(__x86_64__)
+    // Executable memory within rel32-reach of the hooked code, carved into slots for the relay and trampoline.
+    namespace Trampolinepool
+    {
+        constexpr size_t Slotsize = 128;
+        constexpr size_t Chunksize = 64 * 1024;
+        constexpr std::uintptr_t Reach = 0x7FFF0000 - Chunksize;
+
+        inline std::vector<uint8_t *> Freeslots{};
+        inline std::mutex Lock{};
+
+        inline bool isNear(std::uintptr_t A, std::uintptr_t B) { return (A > B ? A - B : B - A) < Reach; }
+
+        // A new chunk as close as we can get, nullptr if the neighbourhood is full.
+        inline uint8_t *Mapchunk(std::uintptr_t Near)
+        {
+            #if defined(_WIN32)
+            SYSTEM_INFO Info{};
+            GetSystemInfo(&Info);
+            const auto Granularity = std::uintptr_t(Info.dwAllocationGranularity);
+            const auto Lowest = std::max(Near > Reach ? Near - Reach : 0, std::uintptr_t(Info.lpMinimumApplicationAddress));
+            const auto Highest = std::min(Near + Reach, std::uintptr_t(Info.lpMaximumApplicationAddress));
+
+            // Walk the regions upwards and take the first free one that's large enough.
+            MEMORY_BASIC_INFORMATION Region{};
+            for (auto Address = Lowest; Address < Highest && VirtualQuery(reinterpret_cast<void *>(Address), &Region, sizeof(Region));)
+            {
+                const auto Start = std::uintptr_t(Region.BaseAddress), End = Start + Region.RegionSize;
+                const auto Candidate = (std::max(Start, Lowest) + Granularity - 1) & ~(Granularity - 1);
+
+                if (Region.State == MEM_FREE && Candidate + Chunksize <= End && Candidate < Highest)
+                    if (const auto Chunk = VirtualAlloc(reinterpret_cast<void *>(Candidate), Chunksize, MEM_RESERVE | MEM_COMMIT, PAGE_EXECUTE_READWRITE))
+                        return static_cast<uint8_t *>(Chunk);
+
+                Address = End;
+            }
+            return nullptr;
+            #else
+            // mmap only takes the address as a hint, so try the gaps closest to the code first.
+            std::vector<std::uintptr_t> Candidates{};
+            {
+                std::scoped_lock Guard(Memprotect::Regions::Lock);
+                Memprotect::Regions::Refresh();
+
+                std::uintptr_t Previous = 0x10000;
+                const auto Consider = [&](std::uintptr_t Start, std::uintptr_t End)
+                {
+                    if (End < Start + Chunksize) return;
+                    const auto Wanted = Near & ~std::uintptr_t(Chunksize - 1);
+                    Candidates.push_back(std::clamp(Wanted, Start, End - Chunksize));
+                };
+                for (const auto &Region : Memprotect::Regions::Index)
+                {
+                    if (Region.Start > Previous) Consider(Previous, Region.Start);
+                    Previous = std::max(Previous, Region.End);
+                }
+                Consider(Previous, 0x7FFFFFFFF000);
+            }
+            std::sort(Candidates.begin(), Candidates.end(), [&](auto A, auto B) { return (A > Near ? A - Near : Near - A) < (B > Near ? B - Near : Near - B); });
+
+            for (const auto Candidate : Candidates)
+            {
+                if (!isNear(Candidate, Near)) break;
+
+                const auto Chunk = mmap(reinterpret_cast<void *>(Candidate), Chunksize, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (Chunk == MAP_FAILED) continue;
+
+                if (isNear(std::uintptr_t(Chunk), Near))
+                {
+                    Memprotect::Invalidate();
+                    return static_cast<uint8_t *>(Chunk);
+                }
+                munmap(Chunk, Chunksize);
+            }
+            return nullptr;
+            #endif
+        }
+
+        inline uint8_t *Allocate(std::uintptr_t Near)
+        {
+            std::scoped_lock Guard(Lock);
+
+            // Newest chunks are at the back, and usually the ones closest to the next hook.
+            for (auto Slot = Freeslots.rbegin(); Slot != Freeslots.rend(); ++Slot)
+            {
+                if (!isNear(std::uintptr_t(*Slot), Near)) continue;
+
+                const auto Result = *Slot;
+                *Slot = Freeslots.back();
+                Freeslots.pop_back();
+                return Result;
+            }
+
+            const auto Chunk = Mapchunk(Near);
+            if (!Chunk) return nullptr;
+
+            for (size_t Offset = Chunksize - Slotsize; Offset > 0; Offset -= Slotsize) Freeslots.push_back(Chunk + Offset);
+            return Chunk;
+        }
+        inline void Release(uint8_t *Slot)
+        {
+            std::scoped_lock Guard(Lock);
+            Freeslots.push_back(Slot);
+        }
+    }
+
+    // Jumps to the target like Stomphook, but the overwritten instructions are moved to a trampoline so the
+    // original stays callable while hooked. Only the first five bytes are replaced, with a JMP rel32.
+    struct Trampolinehook
+    {
+        uint8_t Originalstub[20]{};
+        uint8_t Stolen{};
+        void *Savedlocation{};
+        void *Savedtarget{};
+        uint8_t *Slot{};
+        bool isPatched{};
+
+        // The slot is the relay to the target, if it's out of reach, followed by the trampoline.
+        static constexpr size_t Relaysize = 16;
+
+        // Only valid while hooked, e.g. Callorigin<int (*)(int)>()(42).
+        template <typename T> T Callorigin() const
+        {
+            return reinterpret_cast<T>(Slot + Relaysize);
+        }
+
+        // Whole instructions until there's room for the JMP, then a jump back to the rest of the function.
+        static bool Relocate(const uint8_t *Source, uint8_t *Output, size_t Capacity, uint8_t &Stolen)
+        {
+            const auto Writeabsolute = [](uint8_t *At, uint8_t Modrm, std::uintptr_t Target)
+            {
+                // JMP/CALL [RIP + 0], Target
+                const uint8_t Stub[6]{ 0xFF, Modrm, 0, 0, 0, 0 };
+                std::memcpy(At, Stub, sizeof(Stub));
+                std::memcpy(At + 6, &Target, sizeof(Target));
+            };
+
+            std::uintptr_t Branchtargets[5]{};
+            size_t Written{}, Branches{};
+            for (Stolen = 0; Stolen < 5;)
+            {
+                const auto Instruction = Lengthdecoder::Decode(Source + Stolen);
+                if (!Instruction.Length || Instruction.Kind == Lengthdecoder::Instruction_t::Loop) return false;
+                if (Written + 32 > Capacity) return false;
+
+                const auto Next = std::uintptr_t(Source) + Stolen + Instruction.Length;
+                const auto Out = Output + Written;
+
+                if (Instruction.Branch)
+                {
+                    int32_t Relative{};
+                    if (Instruction.Branchsize == 1) Relative = int8_t(Source[Stolen + Instruction.Branch]);
+                    else std::memcpy(&Relative, Source + Stolen + Instruction.Branch, sizeof(Relative));
+
+                    const auto Target = Next + std::intptr_t(Relative);
+                    Branchtargets[Branches++] = Target;
+
+                    // The relocated branches are absolute as the target may be out of the pool's reach.
+                    if (Instruction.Kind == Lengthdecoder::Instruction_t::Call)
+                    {
+                        // CALL [RIP + 2]; JMP +8; Target
+                        Writeabsolute(Out, 0x15, Target);
+                        std::memmove(Out + 8, Out + 6, 8);
+                        std::memcpy(Out + 2, "\x02\x00\x00\x00\xEB\x08", 6);
+                        Written += 16;
+                    }
+                    else if (Instruction.Kind == Lengthdecoder::Instruction_t::Conditional)
+                    {
+                        // The inverse condition skips over the absolute jump.
+                        Out[0] = uint8_t(0x70 | (Instruction.Condition ^ 1));
+                        Out[1] = 14;
+                        Writeabsolute(Out + 2, 0x25, Target);
+                        Written += 16;
+                    }
+                    else
+                    {
+                        Writeabsolute(Out, 0x25, Target);
+                        Written += 14;
+                    }
+                }
+                else
+                {
+                    std::memcpy(Out, Source + Stolen, Instruction.Length);
+
+                    if (Instruction.Displacement)
+                    {
+                        int32_t Displacement{};
+                        std::memcpy(&Displacement, Source + Stolen + Instruction.Displacement, sizeof(Displacement));
+
+                        const auto Target = std::intptr_t(Next) + Displacement;
+                        const auto Adjusted = Target - std::intptr_t(Out + Instruction.Length);
+                        if (Adjusted != int32_t(Adjusted)) return false;
+
+                        const auto Narrowed = int32_t(Adjusted);
+                        std::memcpy(Out + Instruction.Displacement, &Narrowed, sizeof(Narrowed));
+                    }
+                    Written += Instruction.Length;
+                }
+
+                Stolen += Instruction.Length;
+
+                // A function shorter than the JMP is only hookable if it's followed by padding.
+                if (Instruction.isTerminator)
+                {
+                    for (; Stolen < 5; ++Stolen)
+                        if (Source[Stolen] != 0xCC && Source[Stolen] != 0x90) return false;
+                    break;
+                }
+            }
+
+            // Branching back into the bytes that are about to be overwritten can't be fixed up.
+            for (size_t i = 0; i < Branches; ++i)
+                if (Branchtargets[i] > std::uintptr_t(Source) && Branchtargets[i] < std::uintptr_t(Source) + Stolen) return false;
+
+            Writeabsolute(Output + Written, 0x25, std::uintptr_t(Source) + Stolen);
+            return true;
+        }
+
+        // The trampoline without patching the function, so Callorigin can be published before any call arrives.
+        bool Prepare(void *Location = nullptr, void *Target = nullptr)
+        {
+            if (!Location) Location = Savedlocation;
+            if (!Target) Target = Savedtarget;
+            if (Slot || !Location || !Target) return false;
+
+            const auto Site = static_cast<uint8_t *>(Location);
+            Slot = Trampolinepool::Allocate(std::uintptr_t(Site));
+            if (!Slot) return false;
+
+            if (!Relocate(Site, Slot + Relaysize, Trampolinepool::Slotsize - Relaysize, Stolen))
+            {
+                Trampolinepool::Release(Slot);
+                Slot = nullptr;
+                return false;
+            }
+
+            // The patch jumps straight to the target if it's in reach, otherwise through the relay.
+            if (!Trampolinepool::isNear(std::uintptr_t(Target), std::uintptr_t(Site)))
+            {
+                // JMP [RIP + 0], Target
+                const uint8_t Relay[6]{ 0xFF, 0x25 };
+                std::memcpy(Slot, Relay, sizeof(Relay));
+                std::memcpy(Slot + 6, &Target, sizeof(Target));
+            }
+            Flushcache(Slot, Trampolinepool::Slotsize);
+
+            Savedlocation = Location;
+            Savedtarget = Target;
+            return true;
+        }
+
+        // Prepares the trampoline unless that's already done, then patches the function.
+        bool Installhook(void *Location = nullptr, void *Target = nullptr)
+        {
+            if (isPatched || (!Slot && !Prepare(Location, Target))) return false;
+
+            const auto Site = static_cast<uint8_t *>(Savedlocation);
+            const auto isNear = Trampolinepool::isNear(std::uintptr_t(Savedtarget), std::uintptr_t(Site));
+            const auto Destination = isNear ? std::uintptr_t(Savedtarget) : std::uintptr_t(Slot);
+
+            // JMP rel32, the rest of the stolen bytes are never executed.
+            uint8_t Patch[sizeof(Originalstub)];
+            std::memset(Patch, 0xCC, sizeof(Patch));
+            const auto Relative = int32_t(std::intptr_t(Destination) - std::intptr_t(Site + 5));
+            Patch[0] = 0xE9;
+            std::memcpy(Patch + 1, &Relative, sizeof(Relative));
+
+            const auto Protection = Memprotect::Unprotectrange(Site, Stolen);
+            {
+                std::memcpy(Originalstub, Site, Stolen);
+                std::memcpy(Site, Patch, Stolen);
+            }
+            Memprotect::Protectrange(Site, Stolen, Protection);
+            Flushcache(Site, Stolen);
+
+            isPatched = true;
+            return true;
+        }
+        bool Installhook(const std::uintptr_t Location, const std::uintptr_t Target)
+        {
+            return Installhook(reinterpret_cast<void *>(Location), reinterpret_cast<void *>(Target));
+        }
+
+        // Puts the original bytes back but hands the slot to the caller instead of the pool, for when other
+        // threads may still be inside the trampoline; keeping it forever is always safe.
+        uint8_t *Restorehook()
+        {
+            if (!Slot) return nullptr;
+
+            if (isPatched)
+            {
+                const auto Protection = Memprotect::Unprotectrange(Savedlocation, Stolen);
+                {
+                    std::memcpy(Savedlocation, Originalstub, Stolen);
+                }
+                Memprotect::Protectrange(Savedlocation, Stolen, Protection);
+                Flushcache(Savedlocation, Stolen);
+                isPatched = false;
+            }
+
+            return std::exchange(Slot, nullptr);
+        }
+
+        // Threads still inside the trampoline must have left it before the slot is reused.
+        bool Removehook()
+        {
+            const auto Released = Restorehook();
+            if (!Released) return false;
+
+            Trampolinepool::Release(Released);
+            return true;
+        }
+    };
+    #endif
 }
@@ -0,0 +1,401 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-04
+    License: MIT
+*/
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <string>
+#include <vector>
+#include <cmath>
+
+// Minimal TrueType reader, quadratic glyf-outlines only (no CFF, hinting or kerning).
+namespace Truetype
+{
+    // Glyph coverage, the offset is from the pen-position on the baseline to the top-left pixel.
+    struct Bitmap_t { std::vector<uint8_t> Pixels; int32_t Width, Height, Offsetx, Offsety; };
+
+    struct Font_t
+    {
+        std::basic_string<uint8_t> Data{};
+        uint32_t Cmap{}, Loca{}, Glyf{}, Hmtx{};
+        uint16_t Glyphcount{}, Longmetrics{}, Unitsperem{};
+        int16_t Ascent{}, Descent{}, Linegap{}, Indexformat{};
+
+        // Big-endian readers, out-of-range reads return zero rather than fault on a broken file.
+        uint8_t U8(size_t Offset) const { return Offset < Data.size() ? Data[Offset] : 0; }
+        uint16_t U16(size_t Offset) const { return uint16_t(U8(Offset) << 8 | U8(Offset + 1)); }
+        uint32_t U32(size_t Offset) const { return uint32_t(U16(Offset)) << 16 | U16(Offset + 2); }
+        int16_t I16(size_t Offset) const { return int16_t(U16(Offset)); }
+
+        bool isValid() const { return Glyf && Loca && Cmap && Hmtx && Unitsperem; }
+
+        // Takes ownership of the file, returns false if it's not something we can render.
+        bool Load(std::basic_string<uint8_t> &&Buffer)
+        {
+            Data = std::move(Buffer);
+            const auto Version = U32(0);
+            if(Version != 0x00010000 && Version != 0x74727565) return false;
+
+            uint32_t Head{}, Hhea{}, Maxp{};
+            for(uint32_t i = 0, Tables = U16(4); i < Tables; ++i)
+            {
+                const auto Record = 12 + i * 16;
+                const auto Offset = U32(Record + 8);
+                if(Offset + U32(Record + 12) > Data.size()) return false;
+
+                switch(U32(Record))
+                {
+                    case 0x636D6170: Cmap = Offset; break; // cmap
+                    case 0x676C7966: Glyf = Offset; break; // glyf
+                    case 0x6C6F6361: Loca = Offset; break; // loca
+                    case 0x686D7478: Hmtx = Offset; break; // hmtx
+                    case 0x68656164: Head = Offset; break; // head
+                    case 0x68686561: Hhea = Offset; break; // hhea
+                    case 0x6D617870: Maxp = Offset; break; // maxp
+                }
+            }
+            if(!Head || !Hhea || !Maxp) return false;
+
+            Unitsperem = U16(Head + 18);
+            Indexformat = I16(Head + 50);
+            Ascent = I16(Hhea + 4);
+            Descent = I16(Hhea + 6);
+            Linegap = I16(Hhea + 8);
+            Longmetrics = U16(Hhea + 34);
+            Glyphcount = U16(Maxp + 4);
+
+            // Prefer the full Unicode map, then the BMP.
+            uint32_t Best{};
+            for(uint32_t i = 0, Count = U16(Cmap + 2); i < Count; ++i)
+            {
+                const auto Record = Cmap + 4 + i * 8;
+                const auto Platform = U16(Record), Encoding = U16(Record + 2);
+                const auto Subtable = Cmap + U32(Record + 4);
+                const auto Format = U16(Subtable);
+
+                if(Format == 12 && ((Platform == 3 && Encoding == 10) || Platform == 0)) { Best = Subtable; break; }
+                if(Format == 4 && ((Platform == 3 && Encoding == 1) || Platform == 0)) Best = Subtable;
+            }
+            Cmap = Best;
+
+            return isValid();
+        }
+
+        // Pixels per font-unit for a given line-height (ascent to descent).
+        float Scale(float Pixelheight) const
+        {
+            return Pixelheight / float(Ascent - Descent);
+        }
+
+        uint32_t Glyphindex(uint32_t Codepoint) const
+        {
+            if(U16(Cmap) == 12)
+            {
+                uint32_t Low = 0, High = U32(Cmap + 12);
+                while(Low < High)
+                {
+                    const auto Middle = (Low + High) / 2;
+                    const auto Group = Cmap + 16 + Middle * 12;
+                    if(Codepoint < U32(Group)) High = Middle;
+                    else if(Codepoint > U32(Group + 4)) Low = Middle + 1;
+                    else return U32(Group + 8) + Codepoint - U32(Group);
+                }
+                return 0;
+            }
+
+            if(Codepoint > 0xFFFF) return 0;
+            const auto Segments = U16(Cmap + 6) / 2u;
+            const auto Endcodes = Cmap + 14, Startcodes = Endcodes + Segments * 2 + 2;
+            const auto Deltas = Startcodes + Segments * 2, Rangeoffsets = Deltas + Segments * 2;
+
+            for(uint32_t i = 0; i < Segments; ++i)
+            {
+                if(U16(Endcodes + i * 2) < Codepoint) continue;
+                if(U16(Startcodes + i * 2) > Codepoint) return 0;
+
+                const auto Rangeoffset = U16(Rangeoffsets + i * 2);
+                if(!Rangeoffset) return uint16_t(Codepoint + U16(Deltas + i * 2));
+
+                const auto Glyph = U16(Rangeoffsets + i * 2 + Rangeoffset + (Codepoint - U16(Startcodes + i * 2)) * 2);
+                return Glyph ? uint16_t(Glyph + U16(Deltas + i * 2)) : 0;
+            }
+            return 0;
+        }
+
+        // In font-units.
+        uint16_t Advance(uint32_t Glyph) const
+        {
+            if(!Longmetrics) return 0;
+            return U16(Hmtx + std::min<uint32_t>(Glyph, Longmetrics - 1) * 4);
+        }
+
+        // Offset into glyf, or zero for empty glyphs such as space.
+        uint32_t Glyphoffset(uint32_t Glyph) const
+        {
+            if(Glyph >= Glyphcount) return 0;
+
+            uint32_t Start, End;
+            if(Indexformat == 0) { Start = U16(Loca + Glyph * 2) * 2u; End = U16(Loca + Glyph * 2 + 2) * 2u; }
+            else { Start = U32(Loca + Glyph * 4); End = U32(Loca + Glyph * 4 + 4); }
+            return Start == End ? 0 : Glyf + Start;
+        }
+
+        // Outline as line-segments in pixels with y down, the curves are flattened.
+        struct Line_t { float x0, y0, x1, y1; };
+        struct Transform_t { float xx, xy, yx, yy, dx, dy; };
+        void Outline(uint32_t Glyph, const Transform_t &Transform, std::vector<Line_t> &Lines, uint32_t Depth = 0) const
+        {
+            const auto Offset = Glyphoffset(Glyph);
+            if(!Offset || Depth > 8) return;
+
+            const auto Contours = I16(Offset);
+            if(Contours < 0)
+            {
+                // Composite, each component is placed with its own transform.
+                auto Cursor = Offset + 10;
+                for(uint16_t Flags = 0x20; Flags & 0x20;)
+                {
+                    Flags = U16(Cursor);
+                    const auto Component = U16(Cursor + 2);
+                    Cursor += 4;
+
+                    float dx, dy;
+                    if(Flags & 0x01) { dx = I16(Cursor); dy = I16(Cursor + 2); Cursor += 4; }
+                    else { dx = int8_t(U8(Cursor)); dy = int8_t(U8(Cursor + 1)); Cursor += 2; }
+
+                    float xx = 1, xy = 0, yx = 0, yy = 1;
+                    if(Flags & 0x08) { xx = yy = I16(Cursor) / 16384.0f; Cursor += 2; }
+                    else if(Flags & 0x40) { xx = I16(Cursor) / 16384.0f; yy = I16(Cursor + 2) / 16384.0f; Cursor += 4; }
+                    else if(Flags & 0x80)
+                    {
+                        xx = I16(Cursor) / 16384.0f; xy = I16(Cursor + 2) / 16384.0f;
+                        yx = I16(Cursor + 4) / 16384.0f; yy = I16(Cursor + 6) / 16384.0f;
+                        Cursor += 8;
+                    }
+
+                    // Point-matching (no ARGS_ARE_XY_VALUES) is rare enough to ignore.
+                    if(!(Flags & 0x02)) dx = dy = 0;
+
+                    const Transform_t Combined
+                    {
+                        Transform.xx * xx + Transform.yx * xy, Transform.xy * xx + Transform.yy * xy,
+                        Transform.xx * yx + Transform.yx * yy, Transform.xy * yx + Transform.yy * yy,
+                        Transform.xx * dx + Transform.yx * dy + Transform.dx, Transform.xy * dx + Transform.yy * dy + Transform.dy
+                    };
+                    Outline(Component, Combined, Lines, Depth + 1);
+                }
+                return;
+            }
+
+            // Simple glyph, decode the packed flags and coordinates.
+            struct Point_t { float x, y; bool isOncurve; };
+            const auto Pointcount = Contours ? U16(Offset + 10 + (Contours - 1) * 2) + 1u : 0u;
+            std::vector<Point_t> Points(Pointcount);
+
+            auto Cursor = Offset + 10 + Contours * 2;
+            Cursor += 2 + U16(Cursor);
+
+            std::vector<uint8_t> Flags(Pointcount);
+            for(uint32_t i = 0; i < Pointcount;)
+            {
+                const auto Flag = U8(Cursor++);
+                auto Repeat = (Flag & 0x08) ? U8(Cursor++) + 1u : 1u;
+                while(Repeat-- && i < Pointcount) Flags[i++] = Flag;
+            }
+
+            int32_t Value{};
+            for(uint32_t i = 0; i < Pointcount; ++i)
+            {
+                if(Flags[i] & 0x02) { Value += (Flags[i] & 0x10) ? U8(Cursor) : -U8(Cursor); Cursor += 1; }
+                else if(!(Flags[i] & 0x10)) { Value += I16(Cursor); Cursor += 2; }
+                Points[i].x = float(Value);
+                Points[i].isOncurve = Flags[i] & 0x01;
+            }
+            Value = 0;
+            for(uint32_t i = 0; i < Pointcount; ++i)
+            {
+                if(Flags[i] & 0x04) { Value += (Flags[i] & 0x20) ? U8(Cursor) : -U8(Cursor); Cursor += 1; }
+                else if(!(Flags[i] & 0x20)) { Value += I16(Cursor); Cursor += 2; }
+                Points[i].y = float(Value);
+            }
+
+            // Into pixel-space, y grows downwards.
+            for(auto &Point : Points)
+            {
+                const auto x = Point.x, y = Point.y;
+                Point.x = Transform.xx * x + Transform.yx * y + Transform.dx;
+                Point.y = -(Transform.xy * x + Transform.yy * y + Transform.dy);
+            }
+
+            const auto Line = [&](float x0, float y0, float x1, float y1) { Lines.push_back({ x0, y0, x1, y1 }); };
+            const auto Curve = [&](float x0, float y0, float cx, float cy, float x1, float y1)
+            {
+                // Enough segments to keep the error well below a pixel.
+                const auto Deviation = std::hypot(x0 - 2 * cx + x1, y0 - 2 * cy + y1);
+                const auto Segments = std::clamp(int32_t(std::sqrt(Deviation * 2.0f)) + 1, 1, 16);
+
+                float px = x0, py = y0;
+                for(int32_t i = 1; i <= Segments; ++i)
+                {
+                    const auto t = float(i) / Segments, u = 1.0f - t;
+                    const auto nx = u * u * x0 + 2 * u * t * cx + t * t * x1;
+                    const auto ny = u * u * y0 + 2 * u * t * cy + t * t * y1;
+                    Line(px, py, nx, ny);
+                    px = nx; py = ny;
+                }
+            };
+
+            // Consecutive off-curve points have an implied on-curve point between them.
+            uint32_t First = 0;
+            for(int32_t c = 0; c < Contours; ++c)
+            {
+                const auto Last = std::min<uint32_t>(U16(Offset + 10 + c * 2), Pointcount - 1);
+                if(Last < First) break;
+                const auto Count = Last - First + 1;
+                const auto At = [&](uint32_t i) -> const Point_t & { return Points[First + i % Count]; };
+
+                // Start on an on-curve point, or between two off-curve ones.
+                uint32_t Start = 0;
+                while(Start < Count && !At(Start).isOncurve) ++Start;
+                float sx, sy;
+                if(Start == Count) { Start = 0; sx = (At(0).x + At(1).x) * 0.5f; sy = (At(0).y + At(1).y) * 0.5f; }
+                else { sx = At(Start).x; sy = At(Start).y; }
+
+                float px = sx, py = sy;
+                bool hasControl = false; float cx{}, cy{};
+                for(uint32_t i = 1; i <= Count; ++i)
+                {
+                    const auto &Point = At(Start + i);
+                    if(Point.isOncurve)
+                    {
+                        if(hasControl) Curve(px, py, cx, cy, Point.x, Point.y);
+                        else Line(px, py, Point.x, Point.y);
+                        px = Point.x; py = Point.y; hasControl = false;
+                    }
+                    else
+                    {
+                        if(hasControl)
+                        {
+                            const auto mx = (cx + Point.x) * 0.5f, my = (cy + Point.y) * 0.5f;
+                            Curve(px, py, cx, cy, mx, my);
+                            px = mx; py = my;
+                        }
+                        cx = Point.x; cy = Point.y; hasControl = true;
+                    }
+                }
+                if(hasControl) Curve(px, py, cx, cy, sx, sy);
+                else if(px != sx || py != sy) Line(px, py, sx, sy);
+
+                First = Last + 1;
+            }
+        }
+
+        // Non-zero winding is approximated by accumulating signed area, which is exact for well-formed fonts.
+        Bitmap_t Rasterize(uint32_t Glyph, float Scale) const
+        {
+            const auto Offset = Glyphoffset(Glyph);
+            if(!Offset) return {};
+
+            // The bounds from the header with a pixel of margin, so lines never touch the edge.
+            const auto x0 = int32_t(std::floor(I16(Offset + 2) * Scale)) - 1;
+            const auto y0 = int32_t(std::floor(-I16(Offset + 8) * Scale)) - 1;
+            const auto x1 = int32_t(std::ceil(I16(Offset + 6) * Scale)) + 1;
+            const auto y1 = int32_t(std::ceil(-I16(Offset + 4) * Scale)) + 1;
+            if(x1 <= x0 || y1 <= y0) return {};
+
+            std::vector<Line_t> Lines;
+            Outline(Glyph, { Scale, 0, 0, Scale, 0, 0 }, Lines);
+
+            Bitmap_t Bitmap{ {}, x1 - x0, y1 - y0, x0, y0 };
+            std::vector<float> Accumulation(size_t(Bitmap.Width) * Bitmap.Height + 2, 0.0f);
+
+            for(auto Line : Lines)
+            {
+                Line = { Line.x0 - x0, Line.y0 - y0, Line.x1 - x0, Line.y1 - y0 };
+                if(Line.y0 == Line.y1) continue;
+
+                const float Direction = Line.y0 < Line.y1 ? 1.0f : -1.0f;
+                if(Direction < 0) Line = { Line.x1, Line.y1, Line.x0, Line.y0 };
+
+                const auto Slope = (Line.x1 - Line.x0) / (Line.y1 - Line.y0);
+                auto x = Line.x0 + std::max(0.0f, -Line.y0) * Slope;
+                const auto Rowfirst = std::max(0, int32_t(Line.y0));
+                const auto Rowlast = std::min(Bitmap.Height, int32_t(std::ceil(Line.y1)));
+
+                for(int32_t y = Rowfirst; y < Rowlast; ++y)
+                {
+                    const auto Row = Accumulation.data() + size_t(y) * Bitmap.Width;
+                    const auto dy = std::min(y + 1.0f, Line.y1) - std::max(float(y), Line.y0);
+                    const auto xnext = x + Slope * dy;
+                    const auto d = dy * Direction;
+
+                    const auto Left = std::clamp(std::min(x, xnext), 0.0f, float(Bitmap.Width - 1));
+                    const auto Right = std::clamp(std::max(x, xnext), 0.0f, float(Bitmap.Width - 1));
+                    const auto Leftfloor = std::floor(Left), Rightceil = std::ceil(Right);
+                    const auto Lefti = int32_t(Leftfloor), Righti = int32_t(Rightceil);
+
+                    if(Righti <= Lefti + 1)
+                    {
+                        // Within a single pixel, split the area by the midpoint.
+                        const auto Middle = 0.5f * (Left + Right) - Leftfloor;
+                        Row[Lefti] += d - d * Middle;
+                        Row[Lefti + 1] += d * Middle;
+                    }
+                    else
+                    {
+                        const auto Inverse = 1.0f / (Right - Left);
+                        const auto Leftfraction = Left - Leftfloor;
+                        const auto Firstarea = 0.5f * Inverse * (1.0f - Leftfraction) * (1.0f - Leftfraction);
+                        const auto Rightfraction = Right - Rightceil + 1.0f;
+                        const auto Lastarea = 0.5f * Inverse * Rightfraction * Rightfraction;
+
+                        Row[Lefti] += d * Firstarea;
+                        if(Righti == Lefti + 2)
+                        {
+                            Row[Lefti + 1] += d * (1.0f - Firstarea - Lastarea);
+                        }
+                        else
+                        {
+                            const auto Secondarea = Inverse * (1.5f - Leftfraction);
+                            Row[Lefti + 1] += d * (Secondarea - Firstarea);
+                            for(int32_t i = Lefti + 2; i < Righti - 1; ++i) Row[i] += d * Inverse;
+                            const auto Penultimate = Secondarea + Inverse * (Righti - Lefti - 3);
+                            Row[Righti - 1] += d * (1.0f - Penultimate - Lastarea);
+                        }
+                        Row[Righti] += d * Lastarea;
+                    }
+
+                    x = xnext;
+                }
+            }
+
+            // Every row sums to zero, so one running total covers the whole bitmap.
+            Bitmap.Pixels.resize(size_t(Bitmap.Width) * Bitmap.Height);
+            float Total{};
+            for(size_t i = 0; i < Bitmap.Pixels.size(); ++i)
+            {
+                Total += Accumulation[i];
+                Bitmap.Pixels[i] = uint8_t(std::min(std::abs(Total), 1.0f) * 255.0f + 0.5f);
+            }
+
+            return Bitmap;
+        }
+    };
+
+    // Next codepoint from UTF-8, malformed input yields U+FFFD.
+    inline uint32_t Decodeutf8(std::string_view &String)
+    {
+        const auto Lead = uint8_t(String[0]);
+        const uint32_t Length = Lead < 0x80 ? 1 : (Lead >> 5) == 0x06 ? 2 : (Lead >> 4) == 0x0E ? 3 : (Lead >> 3) == 0x1E ? 4 : 0;
+        if(!Length || Length > String.size()) { String.remove_prefix(1); return 0xFFFD; }
+
+        uint32_t Codepoint = Length == 1 ? Lead : Lead & (0x7F >> Length);
+        for(uint32_t i = 1; i < Length; ++i) Codepoint = (Codepoint << 6) | (uint8_t(String[i]) & 0x3F);
+        String.remove_prefix(Length);
+        return Codepoint;
+    }
+}
@@ -8,6 +8,8 @@
 #include <memory>
 #include <cassert>
 #include <cstdarg>
+#include <cstdio>
+#include <string>
 #include <string_view>
 
 namespace Internal
@@ -19,9 +21,14 @@ namespace Internal
     constexpr int32_t Defaultsize = 512;
     #endif
 
-    inline int32_t va(char *Buffer, const int32_t Size, const std::string_view Format, const std::va_list Varlist)
+    // NOTE(tcn): The list is consumed by vsnprintf on *nix, so we work on a copy to allow retrying.
+    inline int32_t va(char *Buffer, const int32_t Size, const std::string_view Format, std::va_list Varlist)
     {
-        return std::vsnprintf(Buffer, Size, Format.data(), Varlist);
+        std::va_list Copy;
+        va_copy(Copy, Varlist);
+        const auto Result = std::vsnprintf(Buffer, Size, Format.data(), Copy);
+        va_end(Copy);
+        return Result;
     }
 }
 
@@ -38,7 +45,7 @@ inline std::string va(std::string_view Format, ...)
         Size = Internal::va(Buffer.get(), Internal::Defaultsize, Format, Varlist);
 
         // If the size is larger, we need to allocate again =(
-        if (Size > Internal::Defaultsize)
+        if (Size >= Internal::Defaultsize)
         {
             Size += 1;  // Returned length + null.
             Buffer = std::make_unique<char[]>(Size);
@@ -67,7 +74,7 @@ inline std::string va(const char *Format, ...)
         Size = Internal::va(Buffer.get(), Internal::Defaultsize, Format, Varlist);
 
         // If the size is larger, we need to allocate again =(
-        if (Size > Internal::Defaultsize)
+        if (Size >= Internal::Defaultsize)
         {
             Size += 1;  // Returned length + null.
             Buffer = std::make_unique<char[]>(Size);
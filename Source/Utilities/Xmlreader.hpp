@@ -0,0 +1,214 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-09
+    License: MIT
+*/
+
+#pragma once
+#include <memory_resource>
+#include <system_error>
+#include <string_view>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
+// Pull-tokenizer for the subset of XML the markup uses, no DOM and no allocations; everything points into the input.
+namespace XML
+{
+    struct Token_t
+    {
+        enum Kind_t : uint8_t { Open, Close, Text, End, Malformed } Kind{};
+        std::string_view Name{};    // Open and Close.
+        std::string_view Content{}; // Raw attributes for Open, raw characters for Text.
+        bool isSelfclosing{};       // Open, there will be no Close.
+        bool isEscaped{};           // Text, false for CDATA.
+    };
+
+    struct Reader_t
+    {
+        std::string_view Input;
+        size_t Position{};
+
+        explicit Reader_t(std::string_view Input) : Input(Input) {}
+
+        // Declarations, comments and doctypes are skipped; whitespace between elements is returned as text.
+        Token_t Next()
+        {
+            while (true)
+            {
+                if (Position >= Input.size()) return { Token_t::End };
+
+                if (Input[Position] != '<')
+                {
+                    const auto End = std::min(Input.find('<', Position), Input.size());
+                    const auto Text = Input.substr(Position, End - Position);
+                    Position = End;
+                    return { Token_t::Text, {}, Text, false, true };
+                }
+
+                const auto Rest = Input.substr(Position);
+                if (Rest.starts_with("<!--")) { if (!Skippast("-->")) return { Token_t::Malformed }; continue; }
+                if (Rest.starts_with("<?")) { if (!Skippast("?>")) return { Token_t::Malformed }; continue; }
+                if (Rest.starts_with("<![CDATA["))
+                {
+                    const auto End = Input.find("]]>", Position + 9);
+                    if (End == std::string_view::npos) return { Token_t::Malformed };
+
+                    const auto Text = Input.substr(Position + 9, End - Position - 9);
+                    Position = End + 3;
+                    return { Token_t::Text, {}, Text, false, false };
+                }
+                if (Rest.starts_with("<!")) { if (!Skippast(">")) return { Token_t::Malformed }; continue; }
+
+                if (Rest.starts_with("</"))
+                {
+                    const auto End = Input.find('>', Position);
+                    if (End == std::string_view::npos) return { Token_t::Malformed };
+
+                    const auto Name = Trim(Input.substr(Position + 2, End - Position - 2));
+                    Position = End + 1;
+                    return { Token_t::Close, Name };
+                }
+
+                // The name ends at whitespace, the attributes at the first '>' outside of quotes.
+                auto Cursor = Position + 1;
+                while (Cursor < Input.size() && !isSpace(Input[Cursor]) && Input[Cursor] != '>' && Input[Cursor] != '/') ++Cursor;
+                const auto Name = Input.substr(Position + 1, Cursor - Position - 1);
+
+                const auto Attributes = Cursor;
+                for (char Quote = 0; Cursor < Input.size(); ++Cursor)
+                {
+                    const auto Char = Input[Cursor];
+                    if (Quote) { if (Char == Quote) Quote = 0; }
+                    else if (Char == '"' || Char == '\'') Quote = Char;
+                    else if (Char == '>') break;
+                }
+                if (Cursor >= Input.size() || Name.empty()) return { Token_t::Malformed };
+
+                const bool isSelfclosing = Input[Cursor - 1] == '/';
+                const auto Content = Input.substr(Attributes, Cursor - Attributes - isSelfclosing);
+                Position = Cursor + 1;
+                return { Token_t::Open, Name, Content, isSelfclosing };
+            }
+        }
+
+    private:
+        bool Skippast(std::string_view Terminator)
+        {
+            const auto End = Input.find(Terminator, Position);
+            Position = End == std::string_view::npos ? Input.size() : End + Terminator.size();
+            return End != std::string_view::npos;
+        }
+    public:
+        static bool isSpace(char Char) { return Char == ' ' || Char == '\t' || Char == '\n' || Char == '\r'; }
+        static std::string_view Trim(std::string_view String)
+        {
+            while (!String.empty() && isSpace(String.front())) String.remove_prefix(1);
+            while (!String.empty() && isSpace(String.back())) String.remove_suffix(1);
+            return String;
+        }
+    };
+
+    // Walks the raw attributes of an Open token, false when there are no more.
+    struct Attribute_t { std::string_view Name, Value; };
+    inline bool Nextattribute(std::string_view &Span, Attribute_t &Output)
+    {
+        Span = Reader_t::Trim(Span);
+        const auto Equals = Span.find('=');
+        if (Equals == std::string_view::npos) return false;
+
+        const auto Open = Span.find_first_of("\"'", Equals);
+        if (Open == std::string_view::npos) return false;
+        const auto Close = Span.find(Span[Open], Open + 1);
+        if (Close == std::string_view::npos) return false;
+
+        Output.Name = Reader_t::Trim(Span.substr(0, Equals));
+        Output.Value = Span.substr(Open + 1, Close - Open - 1);
+        Span.remove_prefix(Close + 1);
+        return true;
+    }
+
+    // Entities and CRLF, only allocates if there's something to replace.
+    inline std::string_view Unescape(std::string_view Raw, std::pmr::memory_resource *Resource)
+    {
+        if (Raw.find_first_of("&\r") == std::string_view::npos) return Raw;
+
+        const auto Buffer = (char *)Resource->allocate(Raw.size(), 1);
+        size_t Length{};
+
+        for (size_t i = 0; i < Raw.size(); ++i)
+        {
+            if (Raw[i] == '\r')
+            {
+                Buffer[Length++] = '\n';
+                if (i + 1 < Raw.size() && Raw[i + 1] == '\n') ++i;
+                continue;
+            }
+
+            const auto End = Raw[i] == '&' ? Raw.find(';', i) : std::string_view::npos;
+            if (End == std::string_view::npos) { Buffer[Length++] = Raw[i]; continue; }
+
+            const auto Entity = Raw.substr(i + 1, End - i - 1);
+            uint32_t Codepoint{};
+            if (Entity == "lt") Codepoint = '<';
+            else if (Entity == "gt") Codepoint = '>';
+            else if (Entity == "amp") Codepoint = '&';
+            else if (Entity == "quot") Codepoint = '"';
+            else if (Entity == "apos") Codepoint = '\'';
+            else if (Entity.size() > 1 && Entity[0] == '#')
+            {
+                const bool isHex = Entity[1] == 'x' || Entity[1] == 'X';
+                const auto Digits = Entity.substr(isHex ? 2 : 1);
+                if (std::from_chars(Digits.data(), Digits.data() + Digits.size(), Codepoint, isHex ? 16 : 10).ptr != Digits.data() + Digits.size()) Codepoint = 0;
+            }
+
+            // Unknown entities are kept as written, codepoints are never longer than the reference.
+            if (!Codepoint || Codepoint > 0x10FFFF) { Buffer[Length++] = Raw[i]; continue; }
+            if (Codepoint < 0x80) Buffer[Length++] = char(Codepoint);
+            else if (Codepoint < 0x800)
+            {
+                Buffer[Length++] = char(0xC0 | (Codepoint >> 6));
+                Buffer[Length++] = char(0x80 | (Codepoint & 0x3F));
+            }
+            else if (Codepoint < 0x10000)
+            {
+                Buffer[Length++] = char(0xE0 | (Codepoint >> 12));
+                Buffer[Length++] = char(0x80 | ((Codepoint >> 6) & 0x3F));
+                Buffer[Length++] = char(0x80 | (Codepoint & 0x3F));
+            }
+            else
+            {
+                Buffer[Length++] = char(0xF0 | (Codepoint >> 18));
+                Buffer[Length++] = char(0x80 | ((Codepoint >> 12) & 0x3F));
+                Buffer[Length++] = char(0x80 | ((Codepoint >> 6) & 0x3F));
+                Buffer[Length++] = char(0x80 | (Codepoint & 0x3F));
+            }
+            i = End;
+        }
+
+        return { Buffer, Length };
+    }
+
+    // Leading number like strtof/strtoul, so "93.05%" is 93.05; unsigned accepts 0x-prefixed hex.
+    inline float Tofloat(std::string_view Value)
+    {
+        Value = Reader_t::Trim(Value);
+        if (!Value.empty() && Value.front() == '+') Value.remove_prefix(1);
+
+        float Result{};
+        std::from_chars(Value.data(), Value.data() + Value.size(), Result);
+        return Result;
+    }
+    inline uint32_t Touint(std::string_view Value)
+    {
+        Value = Reader_t::Trim(Value);
+        if (!Value.empty() && Value.front() == '+') Value.remove_prefix(1);
+
+        const bool isHex = Value.size() > 1 && Value[0] == '0' && (Value[1] == 'x' || Value[1] == 'X');
+        if (isHex) Value.remove_prefix(2);
+
+        uint32_t Result{};
+        if (std::from_chars(Value.data(), Value.data() + Value.size(), Result, isHex ? 16 : 10).ec == std::errc::result_out_of_range) Result = UINT32_MAX;
+        return Result;
+    }
+}
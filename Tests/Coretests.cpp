@@ -0,0 +1,480 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-17
+    License: MIT
+*/
+
+#include "Test.hpp"
+#include "Fixtures.hpp"
+#include <Stdinclude.hpp>
+#include <Core/Animation.hpp>
+#include <Core/Timers.hpp>
+#include <Core/Lists.hpp>
+#include <filesystem>
+#include <random>
+
+// Written once per run, the asset-cache keys on the path so these persist between runs in the build-directory.
+static std::string Writeblueprint(std::string_view Name, const std::string &Content)
+{
+    const auto Directory = std::filesystem::temp_directory_path() / "Appcore_tests";
+    std::filesystem::create_directories(Directory);
+
+    const auto Filepath = (Directory / Name).string();
+    FS::Writefile(Filepath, Content);
+    return Filepath;
+}
+
+// Arenas and the asset-cache, reloading and running frames shouldn't touch the general heap once warmed up.
+static void Allocationtests()
+{
+    constexpr point2_t Windowsize{ 640, 480 };
+    constexpr vec4_t Boundingbox{ 0.0f, 0.0f, float(Windowsize.x), float(Windowsize.y) };
+
+    const auto Context = std::make_unique<Context_t>();
+    const Context_t::Bind_t Bound(*Context);
+    Context->Resizesurface(Windowsize);
+
+    uint32_t Statechanges{}, Timerfired{};
+    Context->Namedcallbacks[Hash::FNV1a_32("Test::onState")] = [&](Element_t &, const void *) -> bool { ++Statechanges; return false; };
+    Context->Namedcallbacks[Hash::FNV1a_32("Test::Timer")] = [&](Element_t &, const void *) -> bool { return ++Timerfired; };
+
+    for(const uint32_t Nodecount : { 100U, 5000U })
+    {
+        const auto Filepath = Writeblueprint(va("Synthetic_%u.xml", Nodecount), Fixtures::Syntheticblueprint(Nodecount, "Test"));
+
+        // The first parse fills the cache and the arenas, the second grows whatever the cached path needs.
+        for(int i = 0; i < 2; ++i)
+        {
+            Context->Framearena.Reset();
+            CHECK(Parseblueprint(Boundingbox, Filepath, &Context->Nodetree, &Context->Classes, &Context->Callbacks));
+        }
+
+        Test::Run(va("Arena/reload/%u", Nodecount), [&]()
+        {
+            const auto Allocations = Test::Countallocations([&]()
+            {
+                Context->Framearena.Reset();
+                CHECK(Parseblueprint(Boundingbox, Filepath, &Context->Nodetree, &Context->Classes, &Context->Callbacks));
+            });
+            CHECK(Context->Nodetree.Size == Nodecount);
+            CHECK(Allocations == 0);
+        });
+
+        // An edit misses the cache, so the markup is read, serialized and stored again; the writes are outside the count.
+        Test::Run(va("Arena/edit/%u", Nodecount), [&]()
+        {
+            const auto Original = Fixtures::Syntheticblueprint(Nodecount, "Test");
+            auto Edited = Original;
+            Edited.replace(Edited.find("0xE3E5E8FF"), 10, "0xE3E5E8FE");
+
+            const auto Reload = [&](const std::string &Content)
+            {
+                FS::Writefile(Filepath, Content);
+                return Test::Countallocations([&]()
+                {
+                    Context->Framearena.Reset();
+                    CHECK(Parseblueprint(Boundingbox, Filepath, &Context->Nodetree, &Context->Classes, &Context->Callbacks));
+                });
+            };
+
+            // Both versions once, so the arenas grow to the uncached path.
+            Reload(Edited);
+            Reload(Original);
+
+            CHECK(Reload(Edited) == 0);
+            CHECK(Context->Nodetree.Size == Nodecount);
+            CHECK(Reload(Original) == 0);
+        });
+
+        // Hit-testing keeps its scratch in the context, so events don't draw from the frame either.
+        Test::Run(va("Arena/input/%u", Nodecount), [&]()
+        {
+            const auto Sweep = [&]()
+            {
+                Mouseinput_t Input{};
+                for(int16_t y = 0; y < Windowsize.y; y += 7)
+                {
+                    Input.Position = { int16_t(y * 4 % Windowsize.x), y };
+                    Input.Pressed.isLeftclicked = y % 3 == 0;
+                    Input.Released.isLeftclicked = y % 3 == 1;
+                    Processinput(Input, Context->Nodetree, Context->Callbacks);
+                }
+            };
+
+            // The scratch grows to the deepest path once.
+            Sweep();
+            Context->Framearena.Reset();
+            const auto Allocations = Test::Countallocations(Sweep);
+            CHECK(Allocations == 0);
+            CHECK(Context->Framearena.Used() == 0);
+            CHECK(Statechanges != 0);
+        });
+
+        // Everything the main-loop does per frame, after a pass to warm the layers and tracks.
+        Test::Run(va("Arena/frame/%u", Nodecount), [&]()
+        {
+            for(uint32_t i = 1; i < std::min(Nodecount, 64U); ++i)
+            {
+                // Keep each quad's alpha so the culled spans, and thus the frame's arena use, stay the same between frames.
+                Animation::Tweencolour(Context->Nodetree[i], 0x33669900 | ((i - 1) % 4 & 1 ? 0xFF : 0x80), 10.0f, Animation::Easing_t(i % Animation::Easingcount));
+                Timers::Schedule(Hash::FNV1a_32("Test::Timer"), Context->Nodetree[i], 1, 1);
+            }
+
+            auto Virtualtime = Timers::Clock();
+            const auto Frame = [&](int32_t Shrink)
+            {
+                Context->Framearena.Reset();
+                Context->Resizesurface({ int16_t(Windowsize.x - Shrink), int16_t(Windowsize.y - Shrink) });
+                Relayoutnodes({ 0.0f, 0.0f, float(Windowsize.x - Shrink), float(Windowsize.y - Shrink) }, &Context->Nodetree, &Context->Classes);
+                Timers::Advance(Virtualtime += 16);
+                Animation::Advance(1.0f / 60, Context->Classes);
+                Rendernodes(Context->Surface, Context->Nodetree, Context->Classes);
+            };
+
+            // Fractional edges change the culled spans with the size, so the first pass grows the arena to the largest frame.
+            const auto Resizing = [&]() { for(int32_t i = 0; i < 16; ++i) Frame(i * 4); };
+            Resizing();
+            const auto Allocations = Test::Countallocations(Resizing);
+            CHECK(Allocations == 0);
+            CHECK(Timerfired != 0);
+
+            Animation::Clear();
+            Timers::Clear();
+        });
+    }
+}
+
+// Quarter-pixel areas, exact in fixed-point, must lay out, hit-test and render the same in both geometry builds.
+static void Geometrytests()
+{
+    Test::Run("Geometry/fixedpoint", []()
+    {
+        // Rounded to nearest like the scalar path, so within half a step of the float.
+        std::mt19937 Generator(1337);
+        std::uniform_real_distribution<float> Coordinate(-8000.0f, 8000.0f);
+        for(int n = 0; n < 1024; ++n)
+        {
+            vec4_t Area;
+            for(auto &Value : Area.Raw) Value = Coordinate(Generator);
+
+            const auto Roundtrip = Fixedpoint::Unpack(Fixedpoint::Pack(Area));
+            for(int i = 0; i < 4; ++i)
+            {
+                CHECK(Roundtrip.Raw[i] == float(std::lrint(Area.Raw[i] * Fixedpoint::Scale)) / Fixedpoint::Scale);
+                CHECK(std::abs(Roundtrip.Raw[i] - Area.Raw[i]) <= 0.5f / Fixedpoint::Scale);
+            }
+        }
+
+        // Saturates rather than wraps.
+        const auto Clamped = Fixedpoint::Pack({ -1e6f, 1e6f, 8192.0f, -8192.0f });
+        CHECK(Clamped.x0 == INT16_MIN);
+        CHECK(Clamped.y0 == INT16_MAX);
+        CHECK(Clamped.x1 == INT16_MAX);
+        CHECK(Clamped.y1 == INT16_MIN);
+    });
+
+    // A white child at [10.25, 20.25] to [210.25, 220.25] on a black root.
+    constexpr point2_t Windowsize{ 400, 400 };
+    const auto Context = std::make_unique<Context_t>();
+    const Context_t::Bind_t Bound(*Context);
+    Context->Resizesurface(Windowsize);
+
+    const auto Filepath = Writeblueprint("Quarterpixel.xml",
+        "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\" ?>\n"
+        "<Class Name=\"Root\"><Background Colour=\"0x000000FF\"></Background><Size Width=\"100%\" Height=\"100%\"></Size></Class>\n"
+        "<Class Name=\"Child\"><Background Colour=\"0xFFFFFFFF\"></Background><Size Width=\"50%\" Height=\"50%\"></Size>"
+        "<Offset Left=\"2.5625%\" Top=\"5.0625%\"></Offset></Class>\n"
+        "<Node Class=\"Root\"><Node Class=\"Child\"><onState>Test::onState</onState></Node></Node>\n");
+
+    uint32_t Statechanges{};
+    Context->Namedcallbacks[Hash::FNV1a_32("Test::onState")] = [&](Element_t &, const void *) -> bool { ++Statechanges; return false; };
+
+    Context->Framearena.Reset();
+    const vec4_t Boundingbox{ 0.0f, 0.0f, float(Windowsize.x), float(Windowsize.y) };
+    CHECK(Parseblueprint(Boundingbox, Filepath, &Context->Nodetree, &Context->Classes, &Context->Callbacks));
+    CHECK(Context->Nodetree.Size == 2);
+    if(Context->Nodetree.Size != 2) return;
+
+    Test::Run("Geometry/layout", [&]()
+    {
+        const vec4_t Area = Context->Nodetree[1].Area;
+        CHECK(std::abs(Area.x0 - 10.25f) < 0.001f);
+        CHECK(std::abs(Area.y0 - 20.25f) < 0.001f);
+        CHECK(std::abs(Area.x1 - 210.25f) < 0.001f);
+        CHECK(std::abs(Area.y1 - 220.25f) < 0.001f);
+    });
+
+    // Whole pixels either side of each quarter-pixel edge.
+    Test::Run("Geometry/hittest", [&]()
+    {
+        const auto isHit = [&](int16_t x, int16_t y)
+        {
+            Mouseinput_t Input{};
+            Input.Position = { x, y };
+            Processinput(Input, Context->Nodetree, Context->Callbacks);
+            return bool(Context->Nodetree[1].State.isHoveredover);
+        };
+
+        CHECK(!isHit(10, 100));
+        CHECK(isHit(11, 100));
+        CHECK(isHit(210, 100));
+        CHECK(!isHit(211, 100));
+        CHECK(!isHit(100, 20));
+        CHECK(isHit(100, 21));
+        CHECK(isHit(100, 220));
+        CHECK(!isHit(100, 221));
+        CHECK(Statechanges != 0);
+    });
+
+    // Edge pixels are covered by the fraction of the child inside them.
+    Test::Run("Geometry/render", [&]()
+    {
+        Context->Framearena.Reset();
+        Rendernodes(Context->Surface, Context->Nodetree, Context->Classes);
+
+        const auto Intensity = [&](int32_t x, int32_t y) { return int32_t(Context->Surface.Pixels[y * Context->Surface.Width + x] & 0xFF); };
+        CHECK(Intensity(9, 100) == 0);
+        CHECK(std::abs(Intensity(10, 100) - 191) <= 4);
+        CHECK(Intensity(100, 100) == 255);
+        CHECK(std::abs(Intensity(210, 100) - 64) <= 4);
+        CHECK(Intensity(211, 100) == 0);
+        CHECK(std::abs(Intensity(100, 20) - 191) <= 4);
+        CHECK(std::abs(Intensity(100, 220) - 64) <= 4);
+    });
+}
+
+// Only nodes a tween actually moved or restyled are reported, so an idle or settled tween doesn't cost a redraw.
+static void Animationtests()
+{
+    const auto Context = std::make_unique<Context_t>();
+    const Context_t::Bind_t Bound(*Context);
+
+    const auto Filepath = Writeblueprint("Synthetic_16.xml", Fixtures::Syntheticblueprint(16, "Test"));
+    Context->Framearena.Reset();
+    CHECK(Parseblueprint({ 0.0f, 0.0f, 400.0f, 400.0f }, Filepath, &Context->Nodetree, &Context->Classes, &Context->Callbacks));
+    if(Context->Nodetree.Size != 16) return;
+
+    auto &Nodetree = Context->Nodetree;
+    const auto isChanged = [](std::initializer_list<Nodeid_t> Expected)
+    {
+        const auto Changed = Animation::Changed();
+        return std::vector<Nodeid_t>(Changed.begin(), Changed.end()) == std::vector<Nodeid_t>(Expected);
+    };
+
+    Test::Run("Animation/changed", [&]()
+    {
+        Animation::Tweenarea(Nodetree[1], { 1.0f, 2.0f, 3.0f, 4.0f }, 0.1f, Animation::Linear);
+        Animation::Tweencolour(Nodetree[1], 0x11223344, 0.1f, Animation::Linear);
+        Animation::Tweenopacity(Nodetree[2], 1.0f, 0.1f);
+
+        // Node 2 already is fully opaque.
+        CHECK(Animation::Advance(0.05f, Context->Classes));
+        CHECK(isChanged({ 1 }));
+
+        CHECK(Animation::Advance(0.05f, Context->Classes));
+        CHECK(isChanged({ 1 }));
+        const vec4_t Area = Nodetree[1].Area;
+        CHECK(Area.x0 == 1.0f && Area.y0 == 2.0f && Area.x1 == 3.0f && Area.y1 == 4.0f);
+        CHECK(Animation::Find(Nodetree[1])->Colour == 0x11223344);
+
+        // Everything finished, the colour is kept as an override.
+        CHECK(!Animation::Advance(0.05f, Context->Classes));
+        CHECK(isChanged({}));
+        CHECK(Animation::Find(Nodetree[1]));
+        CHECK(!Animation::Find(Nodetree[2]));
+        Animation::Clear();
+    });
+
+    // The first tween's tracks are dropped without being written, the rest keep their place.
+    Test::Run("Animation/replace", [&]()
+    {
+        for(Nodeid_t i = 3; i < 8; ++i) Animation::Tweenarea(Nodetree[i], { 0.0f, 0.0f, 10.0f, 10.0f }, 1.0f, Animation::Linear);
+        Animation::Tweenarea(Nodetree[5], { 0.0f, 0.0f, 20.0f, 20.0f }, 0.5f, Animation::Linear);
+
+        CHECK(Animation::Advance(0.25f, Context->Classes));
+        CHECK(isChanged({ 3, 4, 6, 7, 5 }));
+
+        CHECK(Animation::Advance(0.25f, Context->Classes));
+        CHECK(vec4_t(Nodetree[5].Area).x1 == 20.0f);
+        CHECK(Animation::Advance(0.5f, Context->Classes));
+        CHECK(vec4_t(Nodetree[3].Area).x1 == 10.0f);
+        CHECK(vec4_t(Nodetree[7].Area).y1 == 10.0f);
+        CHECK(!Animation::Advance(0.1f, Context->Classes));
+        Animation::Clear();
+    });
+}
+
+// The pool only depends on how many items fit, and every slot stays reachable wherever the list is scrolled to.
+static void Listtests()
+{
+    constexpr point2_t Windowsize{ 640, 480 };
+    constexpr vec4_t Boundingbox{ 0.0f, 0.0f, float(Windowsize.x), float(Windowsize.y) };
+
+    const auto Context = std::make_unique<Context_t>();
+    const Context_t::Bind_t Bound(*Context);
+    Context->Resizesurface(Windowsize);
+    auto &Nodetree = Context->Nodetree;
+
+    uint32_t Misbound{}, Listsize{};
+    Context->Namedcallbacks[Hash::FNV1a_32("Test::onBind")] = [&](Element_t &This, const void *Argument) -> bool
+    {
+        Misbound += Lists::Itemindex(This) != *(const uint32_t *)Argument;
+        return false;
+    };
+    Context->Namedcallbacks[Hash::FNV1a_32("Test::onState")] = [](Element_t &, const void *) -> bool { return false; };
+
+    // The template-root of the slot currently showing the item.
+    const auto Findslot = [&](Nodeid_t List, uint32_t Item) -> Element_t *
+    {
+        for(Nodeid_t Wrapper = Nodetree[List].Child_1; Wrapper; Wrapper = Nodetree[Wrapper].Child_2)
+            if(Lists::Itemindex(Nodetree[Wrapper + 1]) == Item) return &Nodetree[Wrapper + 1];
+        return nullptr;
+    };
+
+    for(const uint32_t Itemcount : { 1000U, 1000000U })
+    {
+        const auto Filepath = Writeblueprint(va("Synthetic_list_%u.xml", Itemcount), Fixtures::Listblueprint(Itemcount, "Test"));
+        Context->Framearena.Reset();
+        CHECK(Parseblueprint(Boundingbox, Filepath, &Nodetree, &Context->Classes, &Context->Callbacks));
+        CHECK(Lists::Containers().size() == 1);
+        if(Lists::Containers().size() != 1) return;
+        const auto List = Lists::Containers()[0];
+
+        Test::Run(va("Lists/pool/%u", Itemcount), [&]()
+        {
+            CHECK(!Listsize || Nodetree.Size == Listsize);
+            Listsize = Nodetree.Size;
+
+            Lists::Scroll(Nodetree, List, float(Itemcount / 2), false);
+            Lists::Scroll(Nodetree, List, 0.37f);
+            CHECK(Misbound == 0);
+        });
+
+        // Rolled towards the user, the list under the pointer moves towards the end.
+        Test::Run(va("Lists/wheel/%u", Itemcount), [&]()
+        {
+            Lists::Scroll(Nodetree, List, 0.0f, false);
+            Processinput({ { int16_t(Windowsize.x / 2), int16_t(Windowsize.y / 2) }, {}, {}, -1 }, Nodetree, Context->Callbacks);
+
+            const auto Item = Findslot(List, uint32_t(Lists::Wheelstep));
+            CHECK(Item);
+            if(!Item) return;
+
+            const vec4_t Listarea = Nodetree[List].Area, Itemarea = Item->Area;
+            CHECK(std::abs(Itemarea.y0 - (Listarea.y0 + (Listarea.y1 - Listarea.y0) * 0.005f)) <= 1.0f);
+        });
+
+        // At the end some slots are unbound, the ones chained after them must still be hit.
+        Test::Run(va("Lists/last/%u", Itemcount), [&]()
+        {
+            Lists::Scroll(Nodetree, List, float(Itemcount), false);
+            Relayoutnodes(Boundingbox, &Nodetree, &Context->Classes);
+
+            const auto Item = Findslot(List, Itemcount - 1);
+            CHECK(Item);
+            if(!Item) return;
+
+            const vec4_t Area = Item->Area;
+            Mouseinput_t Input{};
+            Input.Position = { int16_t((Area.x0 + Area.x1) / 2), int16_t((Area.y0 + Area.y1) / 2) };
+            Processinput(Input, Nodetree, Context->Callbacks);
+            CHECK(Item->State.isHoveredover);
+        });
+    }
+}
+
+// Replays step the wheel by the trace, an idle wheel mustn't catch up to the steady clock when scheduled.
+static void Timertests()
+{
+    const auto Context = std::make_unique<Context_t>();
+    const Context_t::Bind_t Bound(*Context);
+
+    uint32_t Fired{};
+    Element_t Target{};
+    Context->Namedcallbacks[Hash::FNV1a_32("Test::Timer")] = [&](Element_t &, const void *) -> bool { ++Fired; return false; };
+
+    Test::Run("Timers/virtual", [&]()
+    {
+        Timers::Usevirtualclock();
+        Timers::Schedule(Hash::FNV1a_32("Test::Timer"), Target, 10);
+        CHECK(Timers::Nextdeadline() == 10);
+        CHECK(Timers::Advance(9) == 0);
+        CHECK(Timers::Advance(10) == 1);
+
+        Timers::Advance(25);
+        Timers::Schedule(Hash::FNV1a_32("Test::Timer"), Target, 10);
+        CHECK(Timers::Nextdeadline() == 35);
+        CHECK(Timers::Advance(35) == 1 && Fired == 2);
+    });
+}
+
+// Markup that doesn't fit the arrays is rejected rather than overflowing them.
+static void Blueprinttests()
+{
+    const auto Context = std::make_unique<Context_t>();
+    const Context_t::Bind_t Bound(*Context);
+    constexpr vec4_t Boundingbox{ 0.0f, 0.0f, 400.0f, 400.0f };
+
+    Test::Run("Blueprint/children", [&]()
+    {
+        std::string Blueprint = "<Class Name=\"Root\"></Class><Node Class=\"Root\">";
+        for(uint32_t i = 0; i < 4; ++i) Blueprint += "<Node Class=\"Root\"></Node>";
+
+        const auto Fits = Writeblueprint("Children_4.xml", Blueprint + "</Node>");
+        Context->Framearena.Reset();
+        CHECK(Parseblueprint(Boundingbox, Fits, &Context->Nodetree, &Context->Classes, &Context->Callbacks));
+
+        const auto Overflows = Writeblueprint("Children_5.xml", Blueprint + "<Node Class=\"Root\"></Node></Node>");
+        Context->Framearena.Reset();
+        CHECK(!Parseblueprint(Boundingbox, Overflows, &Context->Nodetree, &Context->Classes, &Context->Callbacks));
+    });
+
+    Test::Run("Blueprint/classes", [&]()
+    {
+        std::string Blueprint;
+        for(uint32_t i = 0; i < Maxclasses; ++i) Blueprint += va("<Class Name=\"Class::%u\"></Class>", i);
+
+        const auto Fits = Writeblueprint("Classes_255.xml", Blueprint + "<Node></Node>");
+        Context->Framearena.Reset();
+        CHECK(Parseblueprint(Boundingbox, Fits, &Context->Nodetree, &Context->Classes, &Context->Callbacks));
+
+        const auto Overflows = Writeblueprint("Classes_256.xml", Blueprint + "<Class Name=\"Class::255\"></Class><Node></Node>");
+        Context->Framearena.Reset();
+        CHECK(!Parseblueprint(Boundingbox, Overflows, &Context->Nodetree, &Context->Classes, &Context->Callbacks));
+    });
+
+    // The pools are added after the markup is read, and need room for their nodes and the wrappers' class.
+    Test::Run("Blueprint/lists", [&]()
+    {
+        const auto Listmarkup = [](uint32_t Overscan, uint32_t Classcount)
+        {
+            std::string Blueprint = va("<Class Name=\"List\"><Size Width=\"100%%\" Height=\"100%%\"></Size><List Count=\"100\" Overscan=\"%u\"></List></Class>"
+                                       "<Class Name=\"Item\"><Size Width=\"100%%\" Height=\"10%%\"></Size></Class>", Overscan);
+            for(uint32_t i = 2; i < Classcount; ++i) Blueprint += va("<Class Name=\"Class::%u\"></Class>", i);
+            return Blueprint + "<Node Class=\"List\"><Node Class=\"Item\"></Node></Node>";
+        };
+
+        const auto Fits = Writeblueprint("List_fits.xml", Listmarkup(2, Maxclasses - 1));
+        Context->Framearena.Reset();
+        CHECK(Parseblueprint(Boundingbox, Fits, &Context->Nodetree, &Context->Classes, &Context->Callbacks));
+        CHECK(Lists::Containers().size() == 1);
+
+        const auto Nodes = Writeblueprint("List_nodes.xml", Listmarkup(Maxnodes, 2));
+        Context->Framearena.Reset();
+        CHECK(!Parseblueprint(Boundingbox, Nodes, &Context->Nodetree, &Context->Classes, &Context->Callbacks));
+
+        const auto Classes = Writeblueprint("List_classes.xml", Listmarkup(2, Maxclasses));
+        Context->Framearena.Reset();
+        CHECK(!Parseblueprint(Boundingbox, Classes, &Context->Nodetree, &Context->Classes, &Context->Callbacks));
+    });
+}
+
+void Coretests()
+{
+    Allocationtests();
+    Geometrytests();
+    Animationtests();
+    Timertests();
+    Listtests();
+    Blueprinttests();
+}
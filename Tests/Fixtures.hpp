@@ -0,0 +1,67 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-19
+    License: MIT
+*/
+
+#pragma once
+#include <Utilities/Variadicstring.hpp>
+#include <string_view>
+#include <cstdint>
+#include <string>
+
+// Synthetic blueprints shared by Appcore_tests and Appcore_bench, the callbacks are named Scope::onState and Scope::onBind.
+namespace Fixtures
+{
+    // Every node is split into quadrants, so the tree is as balanced as the child-slots allow.
+    inline std::string Syntheticblueprint(uint32_t Nodecount, std::string_view Scope, std::string_view Font = {})
+    {
+        std::string Blueprint = "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\" ?>\n"
+            "<Class Name=\"Root\"><Background Colour=\"0xE3E5E8FF\"></Background><Size Width=\"100%\" Height=\"100%\"></Size></Class>\n";
+
+        for(uint32_t i = 0; i < 4; ++i)
+        {
+            Blueprint += va("<Class Name=\"Quad::%u\"><Background Colour=\"0x%06X%02X\" Border=\"0x11111155\" Radius=\"2\"></Background>"
+                            "<Size Width=\"50%%\" Height=\"50%%\"></Size><Offset Left=\"%u%%\" Top=\"%u%%\"></Offset>",
+                            i, 0x404040 + i * 0x202020, i & 1 ? 0xFF : 0x80, (i & 1) * 50, (i >> 1) * 50);
+
+            if(!Font.empty()) Blueprint += va("<Text Font=\"%.*s\" Size=\"12\">Quadrant %u</Text>", int(Font.size()), Font.data(), i);
+            Blueprint += "</Class>\n";
+        }
+
+        // Children of node N are 4N + 1..4, emitted depth-first like the parser expects.
+        const auto Emit = [&](const auto &Self, uint32_t Index) -> void
+        {
+            Blueprint += va("<Node Class=\"%s\">", Index ? va("Quad::%u", (Index - 1) % 4).c_str() : "Root");
+            if(Index % 4 == 1) Blueprint += va("<onState>%.*s::onState</onState>", int(Scope.size()), Scope.data());
+
+            for(uint32_t i = 1; i <= 4; ++i)
+                if(Index * 4 + i < Nodecount)
+                    Self(Self, Index * 4 + i);
+
+            Blueprint += "</Node>\n";
+        };
+        Emit(Emit, 0);
+
+        return Blueprint;
+    }
+
+    // A library-style view of 4.5% items with a 0.5% gap, so twenty fit at a time whatever the count.
+    inline std::string Listblueprint(uint32_t Itemcount, std::string_view Scope)
+    {
+        const auto Name = int(Scope.size());
+        return va("<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\" ?>\n"
+                  "<Class Name=\"Root\"><Background Colour=\"0xE3E5E8FF\"></Background><Size Width=\"100%%\" Height=\"100%%\"></Size></Class>\n"
+                  "<Class Name=\"Library\"><Size Width=\"100%%\" Height=\"90%%\"></Size><Offset Top=\"5%%\"></Offset>"
+                  "<List Count=\"%u\" Overscan=\"2\" onBind=\"%.*s::onBind\"></List></Class>\n"
+                  "<Class Name=\"Item\"><Background Colour=\"0x606060FF\" Border=\"0x11111155\" Radius=\"4\"></Background>"
+                  "<Size Width=\"98%%\" Height=\"4.5%%\"></Size><Offset Left=\"1%%\" Top=\"0.5%%\"></Offset></Class>\n"
+                  "<Class Name=\"Item::Icon\"><Background Colour=\"0xA0A0A0FF\"></Background>"
+                  "<Size Width=\"3%%\" Height=\"80%%\"></Size><Offset Left=\"1%%\" Top=\"10%%\"></Offset></Class>\n"
+                  "<Class Name=\"Item::Title\"><Background Colour=\"0x808080FF\"></Background>"
+                  "<Size Width=\"60%%\" Height=\"50%%\"></Size><Offset Left=\"6%%\" Top=\"25%%\"></Offset></Class>\n"
+                  "<Node Class=\"Root\"><Node Class=\"Library\"><Node Class=\"Item\"><onState>%.*s::onState</onState>"
+                  "<Node Class=\"Item::Icon\"/><Node Class=\"Item::Title\"/></Node></Node></Node>\n",
+                  Itemcount, Name, Scope.data(), Name, Scope.data());
+    }
+}
@@ -0,0 +1,51 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-17
+    License: MIT
+*/
+
+#pragma once
+#include <string_view>
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+
+// Minimal harness, a failed check is printed and the run continues; the exit-code tells CTest.
+namespace Test
+{
+    inline std::string_view Filter{};
+    inline uint32_t Failures{};
+
+    // Incremented by the replaced global operator new, see Testmain.cpp.
+    inline std::atomic<uint64_t> Allocations{};
+
+    inline void Check(bool Condition, const char *Expression, const char *File, int Line)
+    {
+        if(Condition) return;
+        std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", File, Line, Expression);
+        ++Failures;
+    }
+
+    template<typename F> void Run(std::string_view Name, F &&Body)
+    {
+        if(!Filter.empty() && Name.find(Filter) == std::string_view::npos) return;
+
+        const auto Previous = Failures;
+        Body();
+        std::fprintf(stderr, "%-48.*s %s\n", int(Name.size()), Name.data(), Failures == Previous ? "ok" : "FAILED");
+    }
+
+    // Trips to the general heap made by the body.
+    template<typename F> uint64_t Countallocations(F &&Body)
+    {
+        const auto Initial = Allocations.load(std::memory_order_relaxed);
+        Body();
+        return Allocations.load(std::memory_order_relaxed) - Initial;
+    }
+}
+
+#define CHECK(Expression) Test::Check(bool(Expression), #Expression, __FILE__, __LINE__)
+
+// Groups of tests, defined per file.
+void Coretests();
+void Utilitytests();
@@ -0,0 +1,58 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-17
+    License: MIT
+*/
+
+#include "Test.hpp"
+#include <cstdlib>
+#include <new>
+
+// Count every trip to the general heap, reloads and frames are expected to make none.
+void *operator new(size_t Size)
+{
+    Test::Allocations.fetch_add(1, std::memory_order_relaxed);
+    if(auto Pointer = std::malloc(Size ? Size : 1)) return Pointer;
+    throw std::bad_alloc();
+}
+void *operator new(size_t Size, std::align_val_t Alignment)
+{
+    Test::Allocations.fetch_add(1, std::memory_order_relaxed);
+
+    #if defined(_WIN32)
+    if(auto Pointer = _aligned_malloc(Size ? Size : 1, size_t(Alignment))) return Pointer;
+    #else
+    if(auto Pointer = std::aligned_alloc(size_t(Alignment), (Size + size_t(Alignment) - 1) & ~(size_t(Alignment) - 1))) return Pointer;
+    #endif
+
+    throw std::bad_alloc();
+}
+void *operator new[](size_t Size) { return operator new(Size); }
+void *operator new[](size_t Size, std::align_val_t Alignment) { return operator new(Size, Alignment); }
+void operator delete(void *Pointer) noexcept { std::free(Pointer); }
+void operator delete(void *Pointer, size_t) noexcept { std::free(Pointer); }
+void operator delete[](void *Pointer) noexcept { std::free(Pointer); }
+void operator delete[](void *Pointer, size_t) noexcept { std::free(Pointer); }
+#if defined(_WIN32)
+void operator delete(void *Pointer, std::align_val_t) noexcept { _aligned_free(Pointer); }
+void operator delete(void *Pointer, size_t, std::align_val_t) noexcept { _aligned_free(Pointer); }
+void operator delete[](void *Pointer, std::align_val_t) noexcept { _aligned_free(Pointer); }
+void operator delete[](void *Pointer, size_t, std::align_val_t) noexcept { _aligned_free(Pointer); }
+#else
+void operator delete(void *Pointer, std::align_val_t) noexcept { std::free(Pointer); }
+void operator delete(void *Pointer, size_t, std::align_val_t) noexcept { std::free(Pointer); }
+void operator delete[](void *Pointer, std::align_val_t) noexcept { std::free(Pointer); }
+void operator delete[](void *Pointer, size_t, std::align_val_t) noexcept { std::free(Pointer); }
+#endif
+
+// Usage: Appcore_tests [Filter], non-zero exit if any check failed.
+int main(int argc, char **argv)
+{
+    if(argc > 1) Test::Filter = argv[1];
+
+    Coretests();
+    Utilitytests();
+
+    if(Test::Failures) std::fprintf(stderr, "%u checks failed\n", Test::Failures);
+    return Test::Failures ? 1 : 0;
+}
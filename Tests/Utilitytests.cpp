@@ -0,0 +1,201 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-19
+    License: MIT
+*/
+
+#include "Test.hpp"
+#include <Stdinclude.hpp>
+#include <Utilities/Simplehook.hpp>
+#include <Utilities/Profiler.hpp>
+#include <initializer_list>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+// Only ever called through a pointer, so it stays out-of-line and the hook sees every call.
+static Simplehook::Trampolinehook Trampolined;
+static uint32_t Hookable(uint32_t Value) { return (Value ^ (Value >> 15)) * 2654435761U; }
+static uint32_t Trampolinedetour(uint32_t Value) { return Trampolined.Callorigin<uint32_t (*)(uint32_t)>()(Value) + 1; }
+static uint32_t Profiled(uint32_t Value) { return (Value ^ (Value >> 13)) * 2246822519U; }
+
+// Hand-assembled prologues, relocated into a buffer close enough for the RIP-relative operands to reach.
+alignas(16) static uint8_t Source[64];
+alignas(16) static uint8_t Output[128];
+
+template <typename T> static T Read(const uint8_t *At)
+{
+    T Value;
+    std::memcpy(&Value, At, sizeof(Value));
+    return Value;
+}
+
+static bool Relocate(std::initializer_list<uint8_t> Bytes, uint8_t &Stolen)
+{
+    std::memset(Source, 0xCC, sizeof(Source));
+    std::memset(Output, 0x00, sizeof(Output));
+    std::memcpy(Source, Bytes.begin(), Bytes.size());
+    return Simplehook::Trampolinehook::Relocate(Source, Output, sizeof(Output), Stolen);
+}
+
+// Where a RIP-relative operand or rel32 branch at the offset points, from the end of its instruction.
+static std::uintptr_t Resolve(const uint8_t *Instruction, size_t Offset, size_t Length)
+{
+    return std::uintptr_t(Instruction + Length) + std::intptr_t(Read<int32_t>(Instruction + Offset));
+}
+
+static void Decodertests()
+{
+    Test::Run("Lengthdecoder/lengths", []()
+    {
+        struct Vector_t { std::vector<uint8_t> Bytes; uint8_t Length; };
+        const Vector_t Vectors[]
+        {
+            { { 0x55 }, 1 },                                                        // push rbp
+            { { 0x48, 0x89, 0xE5 }, 3 },                                            // mov rbp, rsp
+            { { 0x48, 0x83, 0xEC, 0x28 }, 4 },                                      // sub rsp, 0x28
+            { { 0x48, 0x81, 0xEC, 0x00, 0x01, 0x00, 0x00 }, 7 },                    // sub rsp, 0x100
+            { { 0xF3, 0x0F, 0x1E, 0xFA }, 4 },                                      // endbr64
+            { { 0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00 }, 6 },                          // nop word [rax + rax]
+            { { 0x48, 0xB8, 1, 2, 3, 4, 5, 6, 7, 8 }, 10 },                         // mov rax, imm64
+            { { 0x66, 0xB8, 1, 2 }, 4 },                                            // mov ax, imm16
+            { { 0x48, 0x8B, 0x44, 0x24, 0x08 }, 5 },                                // mov rax, [rsp + 8]
+            { { 0xF6, 0xC1, 0x01 }, 3 },                                            // test cl, 1
+            { { 0xF7, 0xD8 }, 2 },                                                  // neg eax
+            { { 0xC5, 0xF8, 0x77 }, 3 },                                            // vzeroupper
+            { { 0xC4, 0xE2, 0x79, 0x18, 0x44, 0x24, 0x08 }, 7 },                    // vbroadcastss xmm0, [rsp + 8]
+            { { 0x06 }, 0 },                                                        // push es, invalid in 64-bit
+        };
+
+        for (const auto &[Bytes, Length] : Vectors)
+        {
+            std::memset(Source, 0xCC, sizeof(Source));
+            std::memcpy(Source, Bytes.data(), Bytes.size());
+            CHECK(Lengthdecoder::Decode(Source).Length == Length);
+        }
+    });
+
+    Test::Run("Lengthdecoder/operands", []()
+    {
+        const uint8_t Lea[]{ 0x48, 0x8D, 0x05, 0x10, 0x00, 0x00, 0x00 };
+        const auto Riprelative = Lengthdecoder::Decode(Lea);
+        CHECK(Riprelative.Length == 7 && Riprelative.Displacement == 3 && !Riprelative.Branch);
+
+        const uint8_t Jz[]{ 0x74, 0x10 };
+        const auto Short = Lengthdecoder::Decode(Jz);
+        CHECK(Short.Length == 2 && Short.Branch == 1 && Short.Branchsize == 1);
+        CHECK(Short.Kind == Lengthdecoder::Instruction_t::Conditional && Short.Condition == 4 && !Short.isTerminator);
+
+        const uint8_t Jnz[]{ 0x0F, 0x85, 0x00, 0x01, 0x00, 0x00 };
+        const auto Near = Lengthdecoder::Decode(Jnz);
+        CHECK(Near.Length == 6 && Near.Branch == 2 && Near.Branchsize == 4 && Near.Condition == 5);
+
+        const uint8_t Call[]{ 0xE8, 0x00, 0x01, 0x00, 0x00 };
+        const auto Relative = Lengthdecoder::Decode(Call);
+        CHECK(Relative.Length == 5 && Relative.Kind == Lengthdecoder::Instruction_t::Call && !Relative.isTerminator);
+
+        const uint8_t Jmp[]{ 0xEB, 0xFE }, Ret[]{ 0xC3 }, Loop[]{ 0xE2, 0x00 };
+        CHECK(Lengthdecoder::Decode(Jmp).isTerminator && Lengthdecoder::Decode(Jmp).Kind == Lengthdecoder::Instruction_t::Jump);
+        CHECK(Lengthdecoder::Decode(Ret).Length == 1 && Lengthdecoder::Decode(Ret).isTerminator);
+        CHECK(Lengthdecoder::Decode(Loop).Kind == Lengthdecoder::Instruction_t::Loop);
+    });
+}
+
+static void Hooktests()
+{
+    // Stolen instructions are followed by an absolute jump back to the rest of the original.
+    const auto isJumpback = [](const uint8_t *At, std::uintptr_t Target)
+    {
+        return At[0] == 0xFF && At[1] == 0x25 && Read<int32_t>(At + 2) == 0 && Read<std::uintptr_t>(At + 6) == Target;
+    };
+
+    Test::Run("Trampolinehook/relocate/riprelative", [&]()
+    {
+        // lea rax, [rip + 0x10]
+        uint8_t Stolen{};
+        CHECK(Relocate({ 0x48, 0x8D, 0x05, 0x10, 0x00, 0x00, 0x00 }, Stolen));
+        CHECK(Stolen == 7);
+        CHECK(Output[0] == 0x48 && Output[1] == 0x8D && Output[2] == 0x05);
+        CHECK(Resolve(Output, 3, 7) == std::uintptr_t(Source) + 7 + 0x10);
+        CHECK(isJumpback(Output + 7, std::uintptr_t(Source) + 7));
+
+        // nop; nop; mov eax, [rip - 0x20]
+        CHECK(Relocate({ 0x90, 0x90, 0x8B, 0x05, 0xE0, 0xFF, 0xFF, 0xFF }, Stolen));
+        CHECK(Stolen == 8);
+        CHECK(Resolve(Output + 2, 2, 6) == std::uintptr_t(Source) + 8 - 0x20);
+        CHECK(isJumpback(Output + 8, std::uintptr_t(Source) + 8));
+    });
+
+    Test::Run("Trampolinehook/relocate/branches", [&]()
+    {
+        // jz +0x10; mov rax, rcx becomes jnz over an absolute jump, then the copied mov.
+        uint8_t Stolen{};
+        CHECK(Relocate({ 0x74, 0x10, 0x48, 0x89, 0xC8 }, Stolen));
+        CHECK(Stolen == 5);
+        CHECK(Output[0] == 0x75 && Output[1] == 14);
+        CHECK(isJumpback(Output + 2, std::uintptr_t(Source) + 2 + 0x10));
+        CHECK(Output[16] == 0x48 && Output[17] == 0x89 && Output[18] == 0xC8);
+        CHECK(isJumpback(Output + 19, std::uintptr_t(Source) + 5));
+
+        // call +0x100 becomes call [rip + 2]; jmp +8; Target
+        CHECK(Relocate({ 0xE8, 0x00, 0x01, 0x00, 0x00 }, Stolen));
+        CHECK(Stolen == 5);
+        CHECK(Output[0] == 0xFF && Output[1] == 0x15 && Read<int32_t>(Output + 2) == 2);
+        CHECK(Output[6] == 0xEB && Output[7] == 0x08);
+        CHECK(Read<std::uintptr_t>(Output + 8) == std::uintptr_t(Source) + 5 + 0x100);
+        CHECK(isJumpback(Output + 16, std::uintptr_t(Source) + 5));
+
+        // jmp rel32 ends the function and becomes an absolute jump.
+        CHECK(Relocate({ 0xE9, 0x00, 0x02, 0x00, 0x00 }, Stolen));
+        CHECK(isJumpback(Output, std::uintptr_t(Source) + 5 + 0x200));
+
+        // Branching back into the stolen bytes, or too short without padding, can't be relocated.
+        CHECK(!Relocate({ 0x74, 0x01, 0x90, 0x90, 0x90, 0x90 }, Stolen));
+        CHECK(!Relocate({ 0xC3, 0x55, 0x48, 0x89, 0xE5 }, Stolen));
+        CHECK(!Relocate({ 0xE2, 0x10, 0x90, 0x90, 0x90 }, Stolen));
+    });
+
+    Test::Run("Trampolinehook/call", []()
+    {
+        uint32_t (*volatile Hookedfunction)(uint32_t) = &Hookable;
+        const auto Expected = Hookable(1337);
+
+        CHECK(Trampolined.Installhook((void *)&Hookable, (void *)&Trampolinedetour));
+        CHECK(Hookedfunction(1337) == Expected + 1);
+        CHECK(Trampolined.Callorigin<uint32_t (*)(uint32_t)>()(1337) == Expected);
+
+        CHECK(Trampolined.Removehook());
+        CHECK(Hookedfunction(1337) == Expected);
+    });
+
+    // Calls still in flight go through the entry's trampoline, so removing must neither clear nor recycle it.
+    Test::Run("Profiler/remove", []()
+    {
+        uint32_t (*volatile Profiledfunction)(uint32_t) = &Profiled;
+        const auto Expected = Profiled(42);
+
+        CHECK(Profiler::Addfunction((void *)&Profiled, "Profiled"));
+        CHECK(Profiledfunction(42) == Expected);
+        const auto Trampoline = Profiler::Internal::Entries.back().Trampoline;
+
+        Profiler::Removeall();
+        CHECK(Profiler::Internal::Entries.back().Trampoline == Trampoline);
+        CHECK(reinterpret_cast<uint32_t (*)(uint32_t)>(Trampoline)(42) == Expected);
+
+        CHECK(Trampolined.Installhook((void *)&Hookable, (void *)&Trampolinedetour));
+        CHECK(Trampolined.Callorigin<uint8_t *>() != Trampoline);
+        Trampolined.Removehook();
+
+        const auto Report = Profiler::Collect();
+        CHECK(Report.Functions.size() == 1 && Report.Functions[0].Calls == 1);
+        Profiler::Clear();
+    });
+}
+#endif
+
+void Utilitytests()
+{
+    #if defined(_M_X64) || defined(__x86_64__)
+    Decodertests();
+    Hooktests();
+    #endif
+}
@@ -0,0 +1,186 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-14
+    License: MIT
+*/
+
+#include <Stdinclude.hpp>
+#include <Utilities/QOI.hpp>
+#include <Utilities/Filesystem.hpp>
+#include <Utilities/Variadicstring.hpp>
+#include <filesystem>
+#include <charconv>
+#include <cstdio>
+
+using Clock = std::chrono::steady_clock;
+
+// One blueprint at every size, parsed once and re-laid out per size.
+struct Job_t
+{
+    std::string Filepath;
+    double Parse{}, Render{}, Encode{};
+    uint32_t Written{};
+    bool isFailed{};
+};
+
+// "1280x720", false if it's not a size the surface can hold.
+static bool Parsesize(std::string_view Text, point2_t &Output)
+{
+    int Width{}, Height{};
+    const auto Separator = Text.find('x');
+    if(Separator == std::string_view::npos) return false;
+    if(std::from_chars(Text.data(), Text.data() + Separator, Width).ptr != Text.data() + Separator) return false;
+    if(std::from_chars(Text.data() + Separator + 1, Text.data() + Text.size(), Height).ptr != Text.data() + Text.size()) return false;
+    if(Width < 1 || Height < 1 || Width > INT16_MAX || Height > INT16_MAX) return false;
+
+    Output = { int16_t(Width), int16_t(Height) };
+    return true;
+}
+
+// Variants tend to share a filename in different directories, so the directories are part of the name.
+static std::string Outputname(std::string_view Filepath, point2_t Size)
+{
+    if(const auto Extension = Filepath.find_last_of('.'); Extension != std::string_view::npos && Extension > Filepath.find_last_of("/\\") + 1)
+        Filepath = Filepath.substr(0, Extension);
+    while(!Filepath.empty() && (Filepath.front() == '.' || Filepath.front() == '/' || Filepath.front() == '\\')) Filepath.remove_prefix(1);
+
+    std::string Name(Filepath);
+    for(auto &Char : Name) if(Char == '/' || Char == '\\' || Char == ':') Char = '_';
+    return Name + va("_%ux%u.qoi", Size.x, Size.y);
+}
+
+static double Milliseconds(Clock::time_point Start, Clock::time_point End)
+{
+    return std::chrono::duration<double, std::milli>(End - Start).count();
+}
+
+static void Renderjob(Context_t &Context, Job_t &Job, const std::vector<point2_t> &Sizes, const std::string &Outputdir)
+{
+    // Nothing from the last blueprint is referenced any more.
+    Context.Framearena.Reset();
+
+    auto Timestamp = Clock::now();
+    const vec4_t First{ 0.0f, 0.0f, float(Sizes.front().x), float(Sizes.front().y) };
+    if(!Parseblueprint(First, Job.Filepath, &Context.Nodetree, &Context.Classes, &Context.Callbacks))
+    {
+        Job.isFailed = true;
+        return;
+    }
+    Job.Parse = Milliseconds(Timestamp, Clock::now());
+
+    for(size_t i = 0; i < Sizes.size(); ++i)
+    {
+        const auto Size = Sizes[i];
+        Timestamp = Clock::now();
+
+        if(i) Relayoutnodes({ 0.0f, 0.0f, float(Size.x), float(Size.y) }, &Context.Nodetree, &Context.Classes);
+        Context.Resizesurface(Size);
+        Rendernodes(Context.Surface, Context.Nodetree, Context.Classes);
+
+        const auto Rendered = Clock::now();
+        Job.Render += Milliseconds(Timestamp, Rendered);
+
+        const auto Image = QOI::Encode(Context.Surface.Pixels, Context.Surface.Width, Context.Surface.Height);
+        if(FS::Writefile(Outputdir + "/" + Outputname(Job.Filepath, Size), Image)) Job.Written++;
+        else Job.isFailed = true;
+        Job.Encode += Milliseconds(Rendered, Clock::now());
+    }
+}
+
+// Appcore_render [-j Threads] [-o Outputdir] [-s WxH]... <Blueprint.xml | @Listfile>...
+int main(int argc, char **argv)
+{
+    std::vector<point2_t> Sizes{};
+    std::vector<Job_t> Jobs{};
+    std::string Outputdir{ "." };
+    uint32_t Threadcount = std::max(std::thread::hardware_concurrency(), 1U);
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string_view Argument{ argv[i] };
+        const bool hasValue = i + 1 < argc;
+
+        if(Argument == "-j" && hasValue) Threadcount = std::clamp(std::atoi(argv[++i]), 1, 256);
+        else if(Argument == "-o" && hasValue) Outputdir = argv[++i];
+        else if(Argument == "-s" && hasValue)
+        {
+            if(!Parsesize(argv[++i], Sizes.emplace_back()))
+            {
+                std::fprintf(stderr, "Invalid size %s, expected e.g. 1280x720\n", argv[i]);
+                return 1;
+            }
+        }
+        else if(Argument.starts_with("@"))
+        {
+            // One blueprint per line, for lists longer than the command-line allows.
+            const auto Buffer = FS::Readfile(Argument.substr(1));
+            if(Buffer.empty())
+            {
+                std::fprintf(stderr, "Could not read the list %s\n", argv[i] + 1);
+                return 1;
+            }
+
+            std::string_view Lines{ (const char *)Buffer.data(), Buffer.size() };
+            while(!Lines.empty())
+            {
+                const auto End = std::min(Lines.find('\n'), Lines.size());
+                auto Line = Lines.substr(0, End);
+                Lines.remove_prefix(std::min(End + 1, Lines.size()));
+
+                while(!Line.empty() && (Line.back() == '\r' || Line.back() == ' ')) Line.remove_suffix(1);
+                if(!Line.empty()) Jobs.push_back({ std::string(Line) });
+            }
+        }
+        else if(!Argument.starts_with("-")) Jobs.push_back({ std::string(Argument) });
+        else
+        {
+            std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if(Jobs.empty())
+    {
+        std::fprintf(stderr, "Usage: Appcore_render [-j Threads] [-o Outputdir] [-s WxH]... <Blueprint.xml | @Listfile>...\n");
+        return 1;
+    }
+    if(Sizes.empty()) Sizes.push_back({ 1280, 720 });
+
+    std::error_code Error{};
+    std::filesystem::create_directories(Outputdir, Error);
+
+    // Each worker owns a context, so they share nothing but the job-counter and the asset-cache.
+    const auto Start = Clock::now();
+    std::atomic<size_t> Nextjob{};
+    std::vector<std::thread> Workers{};
+    Threadcount = uint32_t(std::min<size_t>(Threadcount, Jobs.size()));
+
+    for(uint32_t i = 0; i < Threadcount; ++i)
+    {
+        Workers.emplace_back([&]()
+        {
+            const auto Context = std::make_unique<Context_t>();
+            const Context_t::Bind_t Bound(*Context);
+
+            for(auto Index = Nextjob++; Index < Jobs.size(); Index = Nextjob++)
+                Renderjob(*Context, Jobs[Index], Sizes, Outputdir);
+        });
+    }
+    for(auto &Worker : Workers) Worker.join();
+    const auto Elapsed = Milliseconds(Start, Clock::now());
+
+    // Per-file times are summed over the sizes.
+    uint32_t Written{}, Failed{};
+    for(const auto &Job : Jobs)
+    {
+        Written += Job.Written;
+        Failed += Job.isFailed;
+
+        if(Job.isFailed) std::printf("%-48s FAILED, %u of %zu written\n", Job.Filepath.c_str(), Job.Written, Sizes.size());
+        else std::printf("%-48s parse %8.3f ms  render %8.3f ms  encode %8.3f ms\n", Job.Filepath.c_str(), Job.Parse, Job.Render, Job.Encode);
+    }
+
+    std::printf("%u snapshots of %zu blueprints in %.3f s on %u threads, %.1f per second\n",
+                Written, Jobs.size(), Elapsed / 1000.0, Threadcount, Written / (Elapsed / 1000.0));
+    return Failed ? 2 : 0;
+}
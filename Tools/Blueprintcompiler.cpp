@@ -0,0 +1,124 @@
+/*
+    Initial author: Convery (tcn@ayria.se)
+    Started: 2019-10-08
+    License: MIT
+*/
+
+#include <Stdinclude.hpp>
+#include <Core/Blueprint.hpp>
+#include <Utilities/Logging.hpp>
+#include <Utilities/Filesystem.hpp>
+#include <Utilities/Variadicstring.hpp>
+#include <cstdio>
+
+// Shortest text that reads back as the same float.
+static std::string Floatliteral(float Value)
+{
+    if(std::isnan(Value) || std::isinf(Value)) return "0.0f";
+
+    char Buffer[32]{};
+    std::snprintf(Buffer, sizeof(Buffer), "%.9g", Value);
+    std::string Literal{ Buffer };
+    if(Literal.find_first_of(".e") == std::string::npos) Literal += ".0";
+    return Literal + "f";
+}
+
+// Octal escapes as they can't swallow the characters after them.
+static std::string Stringliteral(std::string_view String)
+{
+    std::string Literal{ "std::string_view(\"" };
+    for(const auto Char : String)
+    {
+        if(Char == '"' || Char == '\\') { Literal += '\\'; Literal += Char; }
+        else if(uint8_t(Char) < 0x20 || uint8_t(Char) >= 0x7F)
+        {
+            char Buffer[8]{};
+            std::snprintf(Buffer, sizeof(Buffer), "\\%03o", uint8_t(Char));
+            Literal += Buffer;
+        }
+        else Literal += Char;
+    }
+    return Literal + va("\", %zu)", String.size());
+}
+
+// Blueprintcompiler <Markup.xml> <Output.hpp> <Name>, the tables end up in Blueprint::<Name>::Compiled.
+int main(int argc, char **argv)
+{
+    if(argc != 4)
+    {
+        Logging::Print('E', "Usage: Blueprintcompiler <Markup.xml> <Output.hpp> <Name>");
+        return 1;
+    }
+
+    const std::string_view Filepath{ argv[1] }, Outputpath{ argv[2] }, Name{ argv[3] };
+    const auto Filename = Filepath.substr(Filepath.find_last_of("/\\") + 1);
+
+    const auto Context = std::make_unique<Context_t>();
+    const Context_t::Bind_t Bound(*Context);
+    auto &Nodes = Context->Nodetree;
+    auto &Classes = Context->Classes;
+    std::pmr::vector<Blueprint::Callbacknames_t> Callbackhashes{ &Context->Framearena };
+    Hashmap::Flat<std::string_view> Callbacknames;
+
+    if(!Blueprint::Readmarkup(Filepath, &Nodes, &Classes, &Callbackhashes, &Callbacknames))
+    {
+        Logging::Print('E', va("Could not read the blueprint %.*s", int(Filepath.size()), Filepath.data()));
+        return 1;
+    }
+
+    std::string Output{};
+    Output += va("// Generated by Blueprintcompiler from %.*s, do not edit.\n", int(Filename.size()), Filename.data());
+    Output += "#pragma once\n#include <Core/Blueprint.hpp>\n\n";
+
+    // Sorted so the output only changes with the markup.
+    std::vector<std::pair<uint32_t, std::string_view>> Names(Callbacknames.begin(), Callbacknames.end());
+    std::sort(Names.begin(), Names.end());
+
+    Output += "// Every callback named in the markup must be in the including file's Registeredcallbacks.\n";
+    for(const auto &[Callbackhash, Callbackname] : Names)
+    {
+        Output += va("static_assert(Blueprint::isRegistered(Registeredcallbacks, 0x%08XU), \"%.*s: the callback '%.*s' is not registered\");\n",
+                     Callbackhash, int(Filename.size()), Filename.data(), int(Callbackname.size()), Callbackname.data());
+    }
+
+    Output += va("\nnamespace Blueprint::%.*s\n{\n", int(Name.size()), Name.data());
+    Output += "    constexpr Style_t Styles[] =\n    {\n";
+    for(uint32_t i = 0; i < Classes.Size; ++i)
+    {
+        const auto &Size = std::get<vec2_t>(Classes[i][Hash::FNV1a_32("Size")]);
+        const auto &Offset = std::get<vec2_t>(Classes[i][Hash::FNV1a_32("Offset")]);
+        const auto &Background = std::get<Attributes::Background>(Classes[i][Hash::FNV1a_32("Background")]);
+        const auto &Text = std::get<Attributes::Text>(Classes[i][Hash::FNV1a_32("Text")]);
+        const auto &List = std::get<Attributes::List>(Classes[i][Hash::FNV1a_32("List")]);
+
+        Output += va("        { { %s, %s }, { %s, %s },\n", Floatliteral(Size.x).c_str(), Floatliteral(Size.y).c_str(),
+                     Floatliteral(Offset.x).c_str(), Floatliteral(Offset.y).c_str());
+        Output += va("          { 0x%08XU, 0x%08XU, %s, %s, %s },\n", Background.Colour, Background.Border, Floatliteral(Background.Radius).c_str(),
+                     Floatliteral(Background.Borderwidth).c_str(), Stringliteral(Background.Image).c_str());
+        Output += va("          { %s, %s, %s, 0x%08XU },\n", Stringliteral(Text.String).c_str(), Stringliteral(Text.Font).c_str(),
+                     Floatliteral(Text.Size).c_str(), Text.Colour);
+        Output += va("          { %uU, %uU, 0x%08XU, %s } },\n", List.Count, List.Overscan, List.onBind, List.isEnabled ? "true" : "false");
+    }
+    if(!Classes.Size) Output += "        {}\n";
+    Output += "    };\n\n";
+
+    Output += "    constexpr Node_t Nodes[] =\n    {\n";
+    for(uint32_t i = 0; i < Nodes.Size; ++i)
+    {
+        const auto &Node = Nodes[i];
+        Output += va("        { %u, %u, %u, %u, %u, { 0x%08XU, 0x%08XU } },\n", Node.Child_1, Node.Child_2, Node.Child_3, Node.Child_4,
+                     Node.StyleID, Callbackhashes[i].onFrame, Callbackhashes[i].onState);
+    }
+    if(!Nodes.Size) Output += "        {}\n";
+    Output += "    };\n\n";
+
+    Output += va("    constexpr Compiled_t Compiled{ std::span(Nodes, %u), std::span(Styles, %u) };\n}\n", Nodes.Size, Classes.Size);
+
+    if(!FS::Writefile(std::string(Outputpath), Output))
+    {
+        Logging::Print('E', va("Could not write %.*s", int(Outputpath.size()), Outputpath.data()));
+        return 1;
+    }
+
+    return 0;
+}